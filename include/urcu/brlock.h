@@ -0,0 +1,122 @@
+#ifndef _URCU_BRLOCK_H
+#define _URCU_BRLOCK_H
+
+/*
+ * urcu/brlock.h
+ *
+ * Userspace RCU library - Big-reader lock with RCU-assisted fast path
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <urcu/compiler.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The big-reader lock is a reader-writer lock for read-mostly data
+ * which must be updated in place, where RCU copy-update is impractical.
+ *
+ * Readers increment a per-CPU counter after checking, within a RCU
+ * read-side critical section, that no writer is active. The reader
+ * fast path costs the RCU read-side lock of the flavor, one atomic
+ * increment (uatomic_inc) of the counter of its CPU, and
+ * cmm_smp_mb__after_uatomic_inc(); unlock is an atomic decrement
+ * between two memory barriers. Each counter has its own cache line,
+ * written by the readers running on its CPU, so readers on different
+ * CPUs do not share a written cache line. A writer raises its flag and
+ * waits for a grace period, after which every reader either observed
+ * the flag or has published its counter increment. The writer then
+ * waits for the per-CPU counters to drain.
+ *
+ * Writers are expensive (a grace period each), so this lock suits
+ * data which is updated rarely.
+ *
+ * Threads taking the lock must be registered RCU reader threads, and
+ * must *not* take it from within a RCU read-side critical section
+ * (the reader slow path and the writer block). QSBR threads must be
+ * online. A read-side section may contain RCU read-side critical
+ * sections, but a writer must not wait for a grace period while a
+ * reader could be waiting for it.
+ */
+struct cds_brlock;
+
+/*
+ * _cds_brlock_new - API used by cds_brlock_new wrapper. Do not use
+ * directly.
+ */
+extern
+struct cds_brlock *_cds_brlock_new(const struct rcu_flavor_struct *flavor);
+
+/*
+ * cds_brlock_new - allocate a big-reader lock.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the brlock
+ * header.
+ */
+static inline
+struct cds_brlock *cds_brlock_new(void)
+{
+	return _cds_brlock_new(&rcu_flavor);
+}
+
+/*
+ * cds_brlock_destroy - free a big-reader lock, which must not be held.
+ */
+extern
+void cds_brlock_destroy(struct cds_brlock *brlock);
+
+/*
+ * cds_brlock_read_lock - take the lock for reading.
+ *
+ * Returns a cookie which must be passed to cds_brlock_read_unlock(). The
+ * lock can be released from another thread.
+ */
+extern
+unsigned int cds_brlock_read_lock(struct cds_brlock *brlock);
+
+/*
+ * cds_brlock_read_unlock - release a read-side lock.
+ * @cookie: value returned by the matching cds_brlock_read_lock().
+ */
+extern
+void cds_brlock_read_unlock(struct cds_brlock *brlock, unsigned int cookie);
+
+/*
+ * cds_brlock_write_lock - take the lock for writing.
+ *
+ * Waits for a grace period, then for all readers to release the lock.
+ */
+extern
+void cds_brlock_write_lock(struct cds_brlock *brlock);
+
+/*
+ * cds_brlock_write_unlock - release the write-side lock.
+ */
+extern
+void cds_brlock_write_unlock(struct cds_brlock *brlock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_BRLOCK_H */
@@ -30,9 +30,17 @@
 #include <urcu/rculfqueue.h>
 #include <urcu/rculfstack.h>
 #include <urcu/rculfhash.h>
+#include <urcu/rculfhash-shard.h>
+#include <urcu/rculfhash-replica.h>
+#include <urcu/rculfhash-snapshot.h>
 #include <urcu/wfqueue.h>
 #include <urcu/wfcqueue.h>
 #include <urcu/wfstack.h>
 #include <urcu/lfstack.h>
+#include <urcu/rcuslab.h>
+#include <urcu/rcuarena.h>
+#include <urcu/rcuarray.h>
+#include <urcu/hazptr.h>
+#include <urcu/brlock.h>
 
 #endif /* _URCU_CDS_H */
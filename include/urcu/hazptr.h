@@ -0,0 +1,227 @@
+#ifndef _URCU_HAZPTR_H
+#define _URCU_HAZPTR_H
+
+/*
+ * urcu/hazptr.h
+ *
+ * Userspace RCU library - Hazard pointers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Hazard pointers complement RCU for the few references which must be
+ * held across blocking operations: holding such a reference within a
+ * RCU read-side critical section would stall all grace periods.
+ *
+ * A reader typically finds an object within a RCU read-side critical
+ * section, protects it with cds_hp_protect_rcu(), and then exits the
+ * critical section. The object stays valid until the hazard pointer is
+ * cleared with cds_hp_clear(). Objects can also be protected outside
+ * of any RCU read-side critical section with cds_hp_protect(), which
+ * re-validates the source pointer.
+ *
+ * Updaters retire objects with cds_hp_retire(), which behaves like
+ * call_rcu(): the callback is invoked once a grace period has elapsed
+ * *and* no hazard pointer refers to the object. Retired objects are
+ * handed to the call_rcu worker, which scans the hazard pointers in
+ * batches rather than once per object.
+ */
+
+/* Number of hazard pointers per record. */
+#define CDS_HP_NR_SLOTS	4
+
+struct cds_hp_domain;
+
+/*
+ * cds_hp_record: a set of hazard pointers owned by one thread at a
+ * time. Records are never freed before their domain, and are recycled
+ * between threads by cds_hp_record_acquire()/cds_hp_record_release().
+ */
+struct cds_hp_record {
+	void *slot[CDS_HP_NR_SLOTS];
+	struct cds_hp_record *next;	/* domain record list */
+	int active;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+/*
+ * cds_hp_head: embedded in objects retired through cds_hp_retire().
+ */
+struct cds_hp_head {
+	struct rcu_head rcu;
+	struct cds_hp_head *next;	/* retired list */
+	struct cds_hp_domain *domain;
+	const void *ptr;		/* address protected by readers */
+	void (*func)(struct cds_hp_head *head);
+};
+
+/*
+ * _cds_hp_domain_create - API used by cds_hp_domain_create wrapper.
+ * Do not use directly.
+ */
+extern
+struct cds_hp_domain *_cds_hp_domain_create(
+			const struct rcu_flavor_struct *flavor);
+
+/*
+ * cds_hp_domain_create - create a hazard pointer domain.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the hazard
+ * pointer header.
+ */
+static inline
+struct cds_hp_domain *cds_hp_domain_create(void)
+{
+	return _cds_hp_domain_create(&rcu_flavor);
+}
+
+/*
+ * cds_hp_domain_destroy - destroy a hazard pointer domain.
+ * @domain: the domain to destroy.
+ *
+ * All records must have been released. Waits for all retired objects
+ * to be reclaimed (see cds_hp_barrier()).
+ * Return 0 on success, -EBUSY if a record is still in use.
+ */
+extern
+int cds_hp_domain_destroy(struct cds_hp_domain *domain);
+
+/*
+ * cds_hp_record_acquire - get a hazard pointer record for the caller.
+ * @domain: the domain.
+ *
+ * All slots of the returned record are cleared. Return NULL on
+ * allocation failure.
+ */
+extern
+struct cds_hp_record *cds_hp_record_acquire(struct cds_hp_domain *domain);
+
+/*
+ * cds_hp_record_release - give a record back to its domain.
+ * @rec: the record, whose slots must all be cleared.
+ */
+extern
+void cds_hp_record_release(struct cds_hp_record *rec);
+
+/*
+ * cds_hp_retire - reclaim an object once no reader can access it.
+ * @domain: the domain.
+ * @head: structure embedded in the object.
+ * @ptr: address of the object, as protected by readers.
+ * @func: reclaim callback, invoked from the call_rcu worker.
+ *
+ * The object must already be unpublished. @func is invoked after a
+ * grace period, and only once no hazard pointer of @domain holds @ptr.
+ * Should be called from a registered RCU read-side thread, like
+ * call_rcu().
+ */
+extern
+void cds_hp_retire(struct cds_hp_domain *domain, struct cds_hp_head *head,
+		const void *ptr, void (*func)(struct cds_hp_head *head));
+
+/*
+ * cds_hp_barrier - wait for all retired objects to be reclaimed.
+ * @domain: the domain.
+ *
+ * Keeps scanning until every retired object has been reclaimed, and
+ * therefore waits for the hazard pointers protecting them to be
+ * cleared. Should *not* be called from a RCU read-side critical section
+ * nor from a call_rcu thread context.
+ */
+extern
+void cds_hp_barrier(struct cds_hp_domain *domain);
+
+/*
+ * cds_hp_protect_rcu - protect an object found under RCU.
+ * @rec: the hazard pointer record.
+ * @slot: slot index, smaller than CDS_HP_NR_SLOTS.
+ * @ptr: the object, obtained with rcu_dereference() within the current
+ *       RCU read-side critical section.
+ *
+ * Must be called within a RCU read-side critical section. The object
+ * stays valid after the end of the critical section, until the slot is
+ * cleared or reused. No memory barrier is needed: cds_hp_retire()
+ * waits for a grace period before scanning, which orders the store
+ * before the scan.
+ */
+static inline
+void cds_hp_protect_rcu(struct cds_hp_record *rec, unsigned int slot,
+		void *ptr)
+{
+	CMM_STORE_SHARED(rec->slot[slot], ptr);
+}
+
+/*
+ * cds_hp_protect - protect the object referenced by *@pptr.
+ * @rec: the hazard pointer record.
+ * @slot: slot index, smaller than CDS_HP_NR_SLOTS.
+ * @pptr: RCU-published pointer to the object.
+ *
+ * Can be called outside of RCU read-side critical sections. Returns the
+ * protected object, which stays valid until the slot is cleared or
+ * reused, or NULL if *@pptr is NULL.
+ */
+static inline
+void *cds_hp_protect(struct cds_hp_record *rec, unsigned int slot,
+		void **pptr)
+{
+	void *ptr, *check;
+
+	ptr = CMM_LOAD_SHARED(*pptr);
+	for (;;) {
+		CMM_STORE_SHARED(rec->slot[slot], ptr);
+		/* Store hazard pointer before re-reading the source. */
+		cmm_smp_mb();
+		check = CMM_LOAD_SHARED(*pptr);
+		if (caa_likely(check == ptr))
+			break;
+		ptr = check;
+	}
+	/* Order following dereferences after the source validation. */
+	cmm_smp_read_barrier_depends();
+	return ptr;
+}
+
+/*
+ * cds_hp_clear - drop the protection held by a slot.
+ * @rec: the hazard pointer record.
+ * @slot: slot index, smaller than CDS_HP_NR_SLOTS.
+ */
+static inline
+void cds_hp_clear(struct cds_hp_record *rec, unsigned int slot)
+{
+	/* Order prior accesses to the object before the release. */
+	cmm_smp_mb();
+	CMM_STORE_SHARED(rec->slot[slot], NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_HAZPTR_H */
@@ -45,6 +45,7 @@
 #define rcu_init			rcu_init_bp
 #define rcu_exit			rcu_exit_bp
 #define synchronize_rcu			synchronize_rcu_bp
+#define rcu_get_gp_stats		rcu_get_gp_stats_bp
 #define rcu_reader			rcu_reader_bp
 #define rcu_gp				rcu_gp_bp
 
@@ -51,6 +51,7 @@
 #define rcu_init			rcu_init_memb
 #define rcu_exit			rcu_exit_memb
 #define synchronize_rcu			synchronize_rcu_memb
+#define rcu_get_gp_stats		rcu_get_gp_stats_memb
 #define rcu_reader			rcu_reader_memb
 #define rcu_gp				rcu_gp_memb
 
@@ -98,6 +99,7 @@
 #define rcu_init			rcu_init_sig
 #define rcu_exit			rcu_exit_sig
 #define synchronize_rcu			synchronize_rcu_sig
+#define rcu_get_gp_stats		rcu_get_gp_stats_sig
 #define rcu_reader			rcu_reader_sig
 #define rcu_gp				rcu_gp_sig
 
@@ -145,6 +147,7 @@
 #define rcu_init			rcu_init_mb
 #define rcu_exit			rcu_exit_mb
 #define synchronize_rcu			synchronize_rcu_mb
+#define rcu_get_gp_stats		rcu_get_gp_stats_mb
 #define rcu_reader			rcu_reader_mb
 #define rcu_gp				rcu_gp_mb
 
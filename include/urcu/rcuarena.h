@@ -0,0 +1,149 @@
+#ifndef _URCU_RCUARENA_H
+#define _URCU_RCUARENA_H
+
+/*
+ * urcu/rcuarena.h
+ *
+ * Userspace RCU library - RCU generation arena allocator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <stddef.h>
+#include <urcu/compiler.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * An arena holds the objects of one generation of a data structure
+ * which is built, published, then replaced and released as a whole,
+ * e.g. an index rebuilt periodically:
+ *
+ *	arena = cds_arena_create(0);
+ *	(build the new generation, allocating from arena)
+ *	old = rcu_xchg_pointer(&index, new);
+ *	cds_arena_retire(old->arena, NULL, NULL);
+ *
+ * Objects are bump-allocated from large regions, and are never freed
+ * one by one: retiring the arena releases all its regions with a
+ * single call_rcu once the generation is unpublished, instead of one
+ * free and one call_rcu per object.
+ */
+struct cds_arena;
+
+struct cds_arena_stats {
+	unsigned long nr_objects;	/* objects allocated */
+	unsigned long nr_regions;	/* regions allocated */
+	size_t bytes_used;		/* bytes allocated, padding included */
+	size_t bytes_reserved;		/* bytes of all regions */
+};
+
+/*
+ * cds_arena_release_fct - called once a retired arena is unused.
+ * @arena: the arena, whose objects can still be accessed.
+ * @priv: private data passed to cds_arena_retire().
+ *
+ * Called from a call_rcu worker thread, after the grace period and
+ * before the regions are freed, e.g. to release resources referenced
+ * by the objects.
+ */
+typedef void (*cds_arena_release_fct)(struct cds_arena *arena, void *priv);
+
+/*
+ * _cds_arena_create - API used by cds_arena_create wrapper.
+ * Do not use directly.
+ */
+extern
+struct cds_arena *_cds_arena_create(size_t region_size,
+			const struct rcu_flavor_struct *flavor);
+
+/*
+ * cds_arena_create - create an arena.
+ * @region_size: size of the regions objects are allocated from, in
+ *               bytes, 0 for the default (1 MiB). Larger objects get a
+ *               region of their own.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the arena header.
+ */
+static inline
+struct cds_arena *cds_arena_create(size_t region_size)
+{
+	return _cds_arena_create(region_size, &rcu_flavor);
+}
+
+/*
+ * cds_arena_alloc - allocate an object from an arena.
+ * @arena: the arena.
+ * @size: size of the object, in bytes.
+ * @align: alignment of the object (power of two, 0 for pointer
+ *         alignment).
+ *
+ * Can be called concurrently from several threads: allocation is
+ * lock-free, except when a region is exhausted. The object content is
+ * undefined. Return NULL if memory cannot be allocated or align is not
+ * a power of two.
+ */
+extern
+void *cds_arena_alloc(struct cds_arena *arena, size_t size, size_t align);
+
+/*
+ * cds_arena_get_stats - read the allocation counters of an arena.
+ * @arena: the arena.
+ * @stats: filled with the counters.
+ *
+ * Counters of allocations concurrent with the call may or may not be
+ * included.
+ */
+extern
+void cds_arena_get_stats(struct cds_arena *arena,
+			struct cds_arena_stats *stats);
+
+/*
+ * cds_arena_destroy - free an arena and all its objects immediately.
+ * @arena: the arena.
+ *
+ * No thread may use the arena or its objects concurrently, RCU readers
+ * included.
+ */
+extern
+void cds_arena_destroy(struct cds_arena *arena);
+
+/*
+ * cds_arena_retire - free an arena and all its objects after a grace
+ * period.
+ * @arena: the arena, whose objects are no longer reachable by new RCU
+ *         readers.
+ * @release: called after the grace period, before freeing, or NULL.
+ * @priv: private data passed to release.
+ *
+ * No object may be allocated from the arena after this call. Should be
+ * called from a registered RCU read-side thread, like call_rcu().
+ */
+extern
+void cds_arena_retire(struct cds_arena *arena, cds_arena_release_fct release,
+			void *priv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCUARENA_H */
@@ -0,0 +1,220 @@
+#ifndef _URCU_RCUARRAY_H
+#define _URCU_RCUARRAY_H
+
+/*
+ * urcu/rcuarray.h
+ *
+ * Userspace RCU library - RCU copy-on-write array
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <stddef.h>
+#include <pthread.h>
+#include <urcu/compiler.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A read-mostly array of fixed-size elements, e.g. a list of hooks or
+ * observers. Readers get a snapshot of the array, and iterate over its
+ * contiguous elements without chasing a pointer per element. Updaters
+ * copy the array, modify the copy, and publish it with
+ * rcu_xchg_pointer(); the previous snapshot is freed with call_rcu.
+ * Updates are serialized by a mutex internal to the array. Several
+ * modifications can be published at once, as a single copy, between
+ * cds_rcu_array_update_begin() and cds_rcu_array_update_commit().
+ */
+
+/* Snapshot of the array content: never modified once published. */
+struct cds_rcu_array_snap {
+	size_t nr;			/* number of elements */
+	size_t alloc;			/* number of elements allocated */
+	struct rcu_head head;		/* freeing after a grace period */
+	char elems[] __attribute__((aligned(2 * sizeof(void *))));
+};
+
+struct cds_rcu_array {
+	struct cds_rcu_array_snap *snap;	/* shared (RCU) */
+	size_t elem_size;
+	const struct rcu_flavor_struct *flavor;
+	pthread_mutex_t lock;			/* serializes updates */
+};
+
+/* Update in progress, see cds_rcu_array_update_begin(). */
+struct cds_rcu_array_update {
+	struct cds_rcu_array *array;
+	struct cds_rcu_array_snap *copy;	/* private until commit */
+};
+
+/*
+ * cds_rcu_array_read - get the current snapshot of an array.
+ * @array: the array.
+ *
+ * The snapshot, never NULL, stays valid until the end of the RCU
+ * read-side critical section. Call with rcu_read_lock held.
+ */
+static inline
+struct cds_rcu_array_snap *cds_rcu_array_read(struct cds_rcu_array *array)
+{
+	return rcu_dereference(array->snap);
+}
+
+/*
+ * cds_rcu_array_get - element of a snapshot.
+ * @array: the array.
+ * @snap: snapshot of the array, or copy of an update.
+ * @index: element index, lower than snap->nr.
+ */
+static inline
+void *cds_rcu_array_get(struct cds_rcu_array *array,
+		struct cds_rcu_array_snap *snap, size_t index)
+{
+	return snap->elems + index * array->elem_size;
+}
+
+/*
+ * cds_rcu_array_for_each - iterate over the elements of a snapshot.
+ * @snap: snapshot of the array.
+ * @pos: pointer to the element type, whose size must be the element
+ *       size of the array.
+ */
+#define cds_rcu_array_for_each(snap, pos)				\
+	for (pos = (__typeof__(pos)) (snap)->elems;			\
+		pos < (__typeof__(pos)) (snap)->elems + (snap)->nr;	\
+		pos++)
+
+/*
+ * _cds_rcu_array_create - API used by cds_rcu_array_create wrapper.
+ * Do not use directly.
+ */
+extern
+struct cds_rcu_array *_cds_rcu_array_create(size_t elem_size,
+		const struct rcu_flavor_struct *flavor);
+
+/*
+ * cds_rcu_array_create - create an empty array.
+ * @elem_size: size of the elements, in bytes.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the array header.
+ */
+static inline
+struct cds_rcu_array *cds_rcu_array_create(size_t elem_size)
+{
+	return _cds_rcu_array_create(elem_size, &rcu_flavor);
+}
+
+/*
+ * cds_rcu_array_destroy - free an array and its current snapshot.
+ * @array: the array.
+ *
+ * No reader or updater may use the array concurrently. Snapshots
+ * replaced earlier are freed by call_rcu, independently.
+ */
+extern
+void cds_rcu_array_destroy(struct cds_rcu_array *array);
+
+/*
+ * cds_rcu_array_update_begin - start modifying an array.
+ * @array: the array.
+ * @update: update to initialize.
+ *
+ * Takes the update mutex of the array, and copies the current snapshot
+ * into update->copy, which the update functions below modify, and which
+ * can be read with cds_rcu_array_get() and cds_rcu_array_for_each().
+ * Must be followed by cds_rcu_array_update_commit() or
+ * cds_rcu_array_update_abort(). Return 0, or -ENOMEM, in which case
+ * the mutex is not held.
+ */
+extern
+int cds_rcu_array_update_begin(struct cds_rcu_array *array,
+		struct cds_rcu_array_update *update);
+
+/*
+ * cds_rcu_array_update_insert - insert an element in the copy.
+ * @update: the update.
+ * @index: index of the new element, at most update->copy->nr.
+ * @elem: element to copy into the array.
+ *
+ * Return 0, or -ENOMEM, in which case the copy is unchanged.
+ */
+extern
+int cds_rcu_array_update_insert(struct cds_rcu_array_update *update,
+		size_t index, const void *elem);
+
+/*
+ * cds_rcu_array_update_remove - remove an element from the copy.
+ * @update: the update.
+ * @index: index of the element, lower than update->copy->nr.
+ */
+extern
+void cds_rcu_array_update_remove(struct cds_rcu_array_update *update,
+		size_t index);
+
+/*
+ * cds_rcu_array_update_commit - publish the copy.
+ * @update: the update.
+ *
+ * Readers see either the previous snapshot or the copy, never a mix.
+ * The previous snapshot is freed with call_rcu. Releases the update
+ * mutex. Should be called from a registered RCU read-side thread, like
+ * call_rcu().
+ */
+extern
+void cds_rcu_array_update_commit(struct cds_rcu_array_update *update);
+
+/*
+ * cds_rcu_array_update_abort - drop the copy, and release the mutex.
+ * @update: the update.
+ */
+extern
+void cds_rcu_array_update_abort(struct cds_rcu_array_update *update);
+
+/*
+ * cds_rcu_array_add - append an element.
+ * @array: the array.
+ * @elem: element to copy into the array.
+ *
+ * Same as an update appending a single element. Return 0 or -ENOMEM.
+ */
+extern
+int cds_rcu_array_add(struct cds_rcu_array *array, const void *elem);
+
+/*
+ * cds_rcu_array_del - remove the first element matching a key.
+ * @array: the array.
+ * @match: returns non-zero if the element matches the key.
+ * @key: key passed to match.
+ *
+ * Same as an update removing a single element. Return 0, -ENOENT if
+ * no element matches, or -ENOMEM.
+ */
+extern
+int cds_rcu_array_del(struct cds_rcu_array *array,
+		int (*match)(const void *elem, const void *key),
+		const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCUARRAY_H */
@@ -0,0 +1,221 @@
+#ifndef _URCU_RCULFHASH_REPLICA_H
+#define _URCU_RCULFHASH_REPLICA_H
+
+/*
+ * urcu/rculfhash-replica.h
+ *
+ * Userspace RCU library - NUMA-Replicated RCU Hash Table
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <urcu/rculfhash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A replicated hash table is meant for read-mostly maps which are
+ * looked up from every CPU. It keeps one cds_lfht replica per NUMA
+ * node, each holding its own copy of every entry. Readers look up the
+ * replica of the node of the CPU they run on, so that lookups do not
+ * touch remote memory for nodes (as long as the copy hook allocates
+ * them on the requested node).
+ *
+ * Updates are serialized by a writer mutex, and applied to each
+ * replica in turn, in replica order. Replaced and removed copies are
+ * released with the free hook after a grace period.
+ *
+ * Consistency: each replica goes through the same sequence of states,
+ * and all replicas are identical whenever no update is in progress.
+ * While an update is in progress, readers on different nodes may
+ * observe different states: a reader of a replica already updated sees
+ * the new entry, while a reader of a later replica still sees the old
+ * one, even if it started later. Once an update function returns,
+ * lookups on every node see its effect.
+ *
+ * Entries have unique keys. The replicas must only be modified through
+ * the cds_lfht_replica functions, but can be traversed with the
+ * regular cds_lfht iterators, e.g. on cds_lfht_replica_local().
+ *
+ * The bucket tables of each replica are allocated by the memory
+ * management backend of cds_lfht, and follow the default placement
+ * policy of the system.
+ */
+struct cds_lfht_replica;
+
+/*
+ * cds_lfht_replica_copy_fct - allocate the copy of an entry.
+ * @node: the node passed to the update function.
+ * @numa_node: NUMA node of the replica which will hold the copy.
+ * @priv: private data given at table creation.
+ *
+ * Returns a node initialized with the same key and value as @node,
+ * preferably allocated on @numa_node (e.g. with numa_alloc_onnode()),
+ * or NULL if memory cannot be allocated.
+ */
+typedef struct cds_lfht_node *(*cds_lfht_replica_copy_fct)(
+		struct cds_lfht_node *node, int numa_node, void *priv);
+
+/*
+ * cds_lfht_replica_free_fct - release a copy of an entry, once no
+ * reader can hold a reference to it.
+ */
+typedef void (*cds_lfht_replica_free_fct)(struct cds_lfht_node *node,
+		void *priv);
+
+/*
+ * _cds_lfht_replica_new - API used by cds_lfht_replica_new wrapper. Do
+ * not use directly.
+ */
+extern
+struct cds_lfht_replica *_cds_lfht_replica_new(unsigned long nr_replicas,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			cds_lfht_replica_copy_fct copy,
+			cds_lfht_replica_free_fct free_node,
+			void *priv,
+			const struct cds_lfht_mm_type *mm,
+			const struct rcu_flavor_struct *flavor,
+			pthread_attr_t *attr);
+
+/*
+ * cds_lfht_replica_new - allocate a replicated hash table.
+ * @nr_replicas: number of replicas, 0 for one per NUMA node of the
+ *               system. CPUs of NUMA node n use replica n modulo
+ *               nr_replicas.
+ * @copy: hook allocating the copies of the entries.
+ * @free_node: hook releasing the copies of the entries.
+ * @priv: private data passed to the hooks.
+ *
+ * The other arguments are those of cds_lfht_new(), and apply to each
+ * replica.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the hash table
+ * header.
+ */
+static inline
+struct cds_lfht_replica *cds_lfht_replica_new(unsigned long nr_replicas,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			cds_lfht_replica_copy_fct copy,
+			cds_lfht_replica_free_fct free_node,
+			void *priv,
+			pthread_attr_t *attr)
+{
+	return _cds_lfht_replica_new(nr_replicas, init_size,
+			min_nr_alloc_buckets, max_nr_buckets, flags, copy,
+			free_node, priv, NULL, &rcu_flavor, attr);
+}
+
+/*
+ * cds_lfht_replica_destroy - destroy a replicated hash table.
+ *
+ * Removes the remaining entries, releases their copies, and destroys
+ * the replicas. No other thread may use the table concurrently. Same
+ * constraints as cds_lfht_destroy().
+ * Return 0 on success, negative error value on error.
+ */
+extern
+int cds_lfht_replica_destroy(struct cds_lfht_replica *map,
+		pthread_attr_t **attr);
+
+/*
+ * cds_lfht_replica_nr_replicas - number of replicas of the table.
+ */
+extern
+unsigned long cds_lfht_replica_nr_replicas(struct cds_lfht_replica *map);
+
+/*
+ * cds_lfht_replica_get - get a replica, given its index.
+ */
+extern
+struct cds_lfht *cds_lfht_replica_get(struct cds_lfht_replica *map,
+		unsigned long index);
+
+/*
+ * cds_lfht_replica_local - get the replica of the NUMA node of the
+ * current CPU.
+ */
+extern
+struct cds_lfht *cds_lfht_replica_local(struct cds_lfht_replica *map);
+
+/*
+ * cds_lfht_replica_lookup - lookup a key in the local replica.
+ *
+ * Call with rcu_read_lock held. Threads calling this API need to be
+ * registered RCU read-side threads. The node found is the copy of the
+ * local replica, and is valid until the end of the read-side critical
+ * section.
+ */
+extern
+void cds_lfht_replica_lookup(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_iter *iter);
+
+/*
+ * cds_lfht_replica_add_unique - add a copy of node to every replica,
+ * unless the key is already present.
+ * @node: the entry to copy. It is not added to the table, and is left
+ *        to the caller.
+ *
+ * Return 0 on success, -EEXIST if the key is present, -ENOMEM if a
+ * copy could not be allocated (no replica is then modified).
+ *
+ * Call without rcu_read_lock held, from a registered RCU thread: waits
+ * for a grace period when copies are released.
+ */
+extern
+int cds_lfht_replica_add_unique(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *node);
+
+/*
+ * cds_lfht_replica_add_replace - add a copy of node to every replica,
+ * replacing the entry of the same key, if any.
+ *
+ * Return 0 on success, -ENOMEM if a copy could not be allocated (no
+ * replica is then modified). The replaced copies are released after a
+ * grace period. Same constraints as cds_lfht_replica_add_unique().
+ */
+extern
+int cds_lfht_replica_add_replace(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *node);
+
+/*
+ * cds_lfht_replica_del - remove the entry of a key from every replica.
+ *
+ * Return 0 on success, -ENOENT if the key is not present. The removed
+ * copies are released after a grace period. Same constraints as
+ * cds_lfht_replica_add_unique().
+ */
+extern
+int cds_lfht_replica_del(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCULFHASH_REPLICA_H */
@@ -0,0 +1,227 @@
+#ifndef _URCU_RCULFHASH_SHARD_H
+#define _URCU_RCULFHASH_SHARD_H
+
+/*
+ * urcu/rculfhash-shard.h
+ *
+ * Userspace RCU library - Sharded Lock-Free RCU Hash Table
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <urcu/rculfhash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A sharded hash table routes each hash value to one of 2^shard_order
+ * independent cds_lfht instances, selected by the high bits of the
+ * product of the hash by a constant, so that hash values of 32 bits on
+ * 64-bit architectures are spread over all shards too (the bucket index
+ * of each shard uses the low bits of the hash). Every shard has its
+ * own resize mutex, item counters and resize operations, so the resizes
+ * of a very large table are spread over many small ones, and only
+ * concern the shard whose chains grew.
+ *
+ * The API mirrors cds_lfht, with the same RCU read-side and thread
+ * registration requirements. Nodes are regular struct cds_lfht_node,
+ * and cds_lfht_shard_get() gives access to the shard of a hash value
+ * for the cds_lfht operations not wrapped here. Traversals visit the
+ * shards in order, so they are not atomic across shards.
+ */
+struct cds_lfht_shard;
+
+/* cds_lfht_shard_iter: Used to track state while traversing the shards. */
+struct cds_lfht_shard_iter {
+	struct cds_lfht_iter iter;
+	unsigned long index;		/* current shard */
+};
+
+static inline
+struct cds_lfht_node *cds_lfht_shard_iter_get_node(
+		struct cds_lfht_shard_iter *iter)
+{
+	return iter->iter.node;
+}
+
+struct cds_lfht_shard_stats {
+	unsigned long nr_shards;
+	unsigned long nr_buckets;	/* sum of the shard sizes */
+	unsigned long min_shard_buckets;
+	unsigned long max_shard_buckets;
+	long approx_count;		/* sum of the shard approximate counts */
+};
+
+/*
+ * _cds_lfht_shard_new - API used by cds_lfht_shard_new wrapper. Do not
+ * use directly.
+ */
+extern
+struct cds_lfht_shard *_cds_lfht_shard_new(unsigned int shard_order,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			const struct cds_lfht_mm_type *mm,
+			const struct rcu_flavor_struct *flavor,
+			pthread_attr_t *attr);
+
+/*
+ * cds_lfht_shard_new - allocate a sharded hash table.
+ * @shard_order: allocate 2^shard_order shards.
+ *
+ * The other arguments are those of cds_lfht_new(), and apply to each
+ * shard.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the hash table
+ * header.
+ */
+static inline
+struct cds_lfht_shard *cds_lfht_shard_new(unsigned int shard_order,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			pthread_attr_t *attr)
+{
+	return _cds_lfht_shard_new(shard_order, init_size,
+			min_nr_alloc_buckets, max_nr_buckets, flags, NULL,
+			&rcu_flavor, attr);
+}
+
+/*
+ * cds_lfht_shard_destroy - destroy a sharded hash table.
+ *
+ * Return 0 on success, -EPERM if any shard is not empty, in which case
+ * no shard is destroyed. Same constraints as cds_lfht_destroy().
+ */
+extern
+int cds_lfht_shard_destroy(struct cds_lfht_shard *map, pthread_attr_t **attr);
+
+/*
+ * cds_lfht_shard_get - get the shard which holds a hash value.
+ */
+extern
+struct cds_lfht *cds_lfht_shard_get(struct cds_lfht_shard *map,
+		unsigned long hash);
+
+/*
+ * cds_lfht_shard_lookup, cds_lfht_shard_next_duplicate,
+ * cds_lfht_shard_add, cds_lfht_shard_add_unique,
+ * cds_lfht_shard_add_replace, cds_lfht_shard_replace,
+ * cds_lfht_shard_del - same as the cds_lfht functions, on the shard of
+ * the hash value (for del, of the node).
+ */
+extern
+void cds_lfht_shard_lookup(struct cds_lfht_shard *map, unsigned long hash,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_shard_iter *iter);
+
+extern
+void cds_lfht_shard_next_duplicate(struct cds_lfht_shard *map,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_shard_iter *iter);
+
+extern
+void cds_lfht_shard_add(struct cds_lfht_shard *map, unsigned long hash,
+		struct cds_lfht_node *node);
+
+extern
+struct cds_lfht_node *cds_lfht_shard_add_unique(struct cds_lfht_shard *map,
+		unsigned long hash, cds_lfht_match_fct match,
+		const void *key, struct cds_lfht_node *node);
+
+extern
+struct cds_lfht_node *cds_lfht_shard_add_replace(struct cds_lfht_shard *map,
+		unsigned long hash, cds_lfht_match_fct match,
+		const void *key, struct cds_lfht_node *node);
+
+extern
+int cds_lfht_shard_replace(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *old_iter, unsigned long hash,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *new_node);
+
+extern
+int cds_lfht_shard_del(struct cds_lfht_shard *map, struct cds_lfht_node *node);
+
+/*
+ * cds_lfht_shard_first - get the first node of the first non-empty
+ * shard.
+ * cds_lfht_shard_next - get the next node, moving on to the following
+ * shards.
+ *
+ * Call with rcu_read_lock held.
+ */
+extern
+void cds_lfht_shard_first(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *iter);
+
+extern
+void cds_lfht_shard_next(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *iter);
+
+/*
+ * cds_lfht_shard_resize - force the resize of every shard to new_size
+ * buckets. Same constraints as cds_lfht_resize().
+ */
+extern
+void cds_lfht_shard_resize(struct cds_lfht_shard *map,
+		unsigned long new_size);
+
+/*
+ * cds_lfht_shard_count_nodes - sum of cds_lfht_count_nodes() over the
+ * shards. Call with rcu_read_lock held.
+ */
+extern
+void cds_lfht_shard_count_nodes(struct cds_lfht_shard *map,
+		long *approx_before,
+		unsigned long *count,
+		long *approx_after);
+
+/*
+ * cds_lfht_shard_get_stats - aggregate the shard sizes and approximate
+ * item counts (maintained with CDS_LFHT_ACCOUNTING).
+ */
+extern
+void cds_lfht_shard_get_stats(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_stats *stats);
+
+#define cds_lfht_shard_for_each(map, iter, node)			\
+	for (cds_lfht_shard_first(map, iter),				\
+			node = cds_lfht_shard_iter_get_node(iter);	\
+		node != NULL;						\
+		cds_lfht_shard_next(map, iter),				\
+			node = cds_lfht_shard_iter_get_node(iter))
+
+#define cds_lfht_shard_for_each_entry(map, iter, pos, member)		\
+	for (cds_lfht_shard_first(map, iter),				\
+			pos = caa_container_of(cds_lfht_shard_iter_get_node(iter), \
+					__typeof__(*(pos)), member);	\
+		cds_lfht_shard_iter_get_node(iter) != NULL;		\
+		cds_lfht_shard_next(map, iter),				\
+			pos = caa_container_of(cds_lfht_shard_iter_get_node(iter), \
+					__typeof__(*(pos)), member))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCULFHASH_SHARD_H */
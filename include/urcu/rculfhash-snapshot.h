@@ -0,0 +1,123 @@
+#ifndef _URCU_RCULFHASH_SNAPSHOT_H
+#define _URCU_RCULFHASH_SNAPSHOT_H
+
+/*
+ * urcu/rculfhash-snapshot.h
+ *
+ * Userspace RCU library - Lock-Free RCU Hash Table snapshots
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <stddef.h>
+#include <urcu/rculfhash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A snapshot file holds the hash value and a serialized copy of each
+ * node of a table, in table traversal order (increasing reverse hash),
+ * and the number of buckets of the table. It contains no pointer, so
+ * it can be loaded by another process. Numbers are stored in the byte
+ * order of the machine, and loading checks that it matches, as well as
+ * the size of unsigned long.
+ *
+ * Loading a snapshot presizes the table, then links each node right
+ * after the previous one, as nodes come in list order: neither hash
+ * functions nor chain walks are needed to place them.
+ */
+
+/*
+ * cds_lfht_snapshot_serialize_fct - serialize the key and value of a node.
+ * @node: the node to serialize.
+ * @buf: output buffer.
+ * @len: size of the output buffer.
+ * @priv: private data passed to cds_lfht_snapshot_save().
+ *
+ * Returns the size of the serialized node. If it is larger than len,
+ * nothing needs to be written: the hook is called again with a buffer
+ * large enough. Returns a negative value on error.
+ */
+typedef long (*cds_lfht_snapshot_serialize_fct)(struct cds_lfht_node *node,
+		void *buf, size_t len, void *priv);
+
+/*
+ * cds_lfht_snapshot_deserialize_fct - allocate a node from its
+ * serialized form.
+ * @hash: hash value of the node.
+ * @buf: serialized node, only valid during the call.
+ * @len: size of the serialized node.
+ * @priv: private data passed to cds_lfht_snapshot_load().
+ *
+ * Returns the node to add to the table, or NULL on error.
+ */
+typedef struct cds_lfht_node *(*cds_lfht_snapshot_deserialize_fct)(
+		unsigned long hash, const void *buf, size_t len, void *priv);
+
+/*
+ * cds_lfht_snapshot_save - write the nodes of a table to a file.
+ * @ht: the hash table.
+ * @fd: file descriptor of a regular file, written from its start.
+ * @batch: number of nodes between read-side lock yields, 0 never to
+ *         yield.
+ * @serialize: hook serializing each node.
+ * @priv: private data passed to the hook.
+ *
+ * The table is traversed with a cursor yielding the RCU read-side lock
+ * every "batch" nodes (see cds_lfht_cursor_first()), so saving a large
+ * table does not hold back grace periods. Nodes added or removed
+ * during the save may or may not be written; the other nodes are
+ * written exactly once.
+ *
+ * Call without rcu_read_lock held, from a registered RCU read-side
+ * thread. Returns the number of nodes written, or a negative error
+ * value (-errno of a failed write, or -EINVAL if the serialize hook
+ * fails).
+ */
+extern
+long cds_lfht_snapshot_save(struct cds_lfht *ht, int fd, unsigned long batch,
+		cds_lfht_snapshot_serialize_fct serialize, void *priv);
+
+/*
+ * cds_lfht_snapshot_load - add the nodes of a snapshot file to a table.
+ * @ht: the hash table, usually empty.
+ * @fd: file descriptor of the snapshot file, which is mapped in memory.
+ * @deserialize: hook allocating each node.
+ * @priv: private data passed to the hook.
+ *
+ * The table is first grown to the number of buckets it had when saved.
+ * The calling thread must be the only updater of the table during the
+ * load, but lookups may run concurrently, and see the nodes as they are
+ * added. Resizes wait for the end of the load.
+ *
+ * Call without rcu_read_lock held. Returns the number of nodes added,
+ * or a negative error value: -EINVAL if the file is not a snapshot, was
+ * saved on an incompatible machine or is truncated, -ENOMEM if the
+ * deserialize hook fails, or -errno if the file cannot be mapped. On
+ * error, the nodes already added are left in the table.
+ */
+extern
+long cds_lfht_snapshot_load(struct cds_lfht *ht, int fd,
+		cds_lfht_snapshot_deserialize_fct deserialize, void *priv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCULFHASH_SNAPSHOT_H */
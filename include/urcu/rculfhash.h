@@ -73,6 +73,22 @@ struct cds_lfht_node *cds_lfht_iter_get_node(struct cds_lfht_iter *iter)
 	return iter->node;
 }
 
+/*
+ * cds_lfht_cursor: Used to traverse the whole table over several RCU
+ * read-side critical sections. See cds_lfht_cursor_first().
+ */
+struct cds_lfht_cursor {
+	struct cds_lfht_iter iter;
+	unsigned long batch;		/* nodes between yields, 0 for none */
+	unsigned long count;		/* nodes since the last yield */
+};
+
+static inline
+struct cds_lfht_node *cds_lfht_cursor_get_node(struct cds_lfht_cursor *cursor)
+{
+	return cursor->iter.node;
+}
+
 struct cds_lfht;
 
 /*
@@ -114,6 +130,13 @@ struct cds_lfht_mm_type {
 extern const struct cds_lfht_mm_type cds_lfht_mm_order;
 extern const struct cds_lfht_mm_type cds_lfht_mm_chunk;
 extern const struct cds_lfht_mm_type cds_lfht_mm_mmap;
+/*
+ * Same as cds_lfht_mm_mmap, with bucket nodes of 8 bytes (half of
+ * struct cds_lfht_node on 64-bit architectures, no saving on 32-bit
+ * ones): the reverse hash of a bucket is derived from its position in
+ * the bucket table.
+ */
+extern const struct cds_lfht_mm_type cds_lfht_mm_mmap_compact;
 
 /*
  * _cds_lfht_new - API used by cds_lfht_new wrapper. Do not use directly.
@@ -207,6 +230,23 @@ void cds_lfht_count_nodes(struct cds_lfht *ht,
 		unsigned long *count,
 		long *split_count_after);
 
+/*
+ * cds_lfht_get_buckets - get the size of the bucket table.
+ * @ht: the hash table.
+ * @nr_buckets: (output) number of buckets.
+ * @nr_alloc_buckets: (output) number of bucket nodes allocated, which
+ *                    is at least the minimum number of allocated buckets
+ *                    of the memory backend.
+ * @bucket_node_size: (output) size of a bucket node, in bytes.
+ *
+ * The values may be stale if the table is resized concurrently.
+ */
+extern
+void cds_lfht_get_buckets(struct cds_lfht *ht,
+		unsigned long *nr_buckets,
+		unsigned long *nr_alloc_buckets,
+		size_t *bucket_node_size);
+
 /*
  * cds_lfht_lookup - lookup a node by key.
  * @ht: the hash table.
@@ -277,6 +317,52 @@ void cds_lfht_first(struct cds_lfht *ht, struct cds_lfht_iter *iter);
 extern
 void cds_lfht_next(struct cds_lfht *ht, struct cds_lfht_iter *iter);
 
+/*
+ * cds_lfht_cursor_first - start a traversal that can yield the RCU
+ *                         read-side lock.
+ * @ht: the hash table.
+ * @cursor: First node, if exists (output).
+ *          cursor->iter.node set to NULL if the table is empty.
+ * @batch: number of nodes between yields, 0 never to yield.
+ *
+ * Unlike cds_lfht_first()/cds_lfht_next(), a cursor traversal of a large
+ * table does not hold back grace periods for its whole duration: every
+ * "batch" nodes, cds_lfht_cursor_next() releases and re-acquires the RCU
+ * read-side lock (reporting a quiescent state for QSBR), then looks up
+ * the position following the last node returned, using the reverse hash
+ * ordering of the table. A cursor never yields between nodes with the
+ * same hash value.
+ *
+ * Nodes present in the table for the whole traversal are returned
+ * exactly once, even across concurrent resizes. Nodes added or removed
+ * during the traversal may or may not be returned.
+ *
+ * Call with rcu_read_lock held, outside of any nested read-side
+ * critical section, so the yields release the read-side lock.
+ * Threads calling this API need to be registered RCU read-side threads.
+ * This function acts as a rcu_dereference() to read the node pointer.
+ */
+extern
+void cds_lfht_cursor_first(struct cds_lfht *ht,
+		struct cds_lfht_cursor *cursor, unsigned long batch);
+
+/*
+ * cds_lfht_cursor_next - get the next node of a cursor traversal.
+ * @ht: the hash table.
+ * @cursor: input: current cursor.
+ *          output: next node, if exists. cursor->iter.node set to NULL
+ *          if the cursor was pointing to the last table node.
+ *
+ * May release and re-acquire the RCU read-side lock: the node returned
+ * by a previous call can only be used until the next call.
+ * Call with rcu_read_lock held, outside of any nested read-side
+ * critical section.
+ * Threads calling this API need to be registered RCU read-side threads.
+ * This function acts as a rcu_dereference() to read the node pointer.
+ */
+extern
+void cds_lfht_cursor_next(struct cds_lfht *ht, struct cds_lfht_cursor *cursor);
+
 /*
  * cds_lfht_add - add a node to the hash table.
  * @ht: the hash table.
@@ -454,6 +540,92 @@ int cds_lfht_is_node_deleted(struct cds_lfht_node *node);
 extern
 void cds_lfht_resize(struct cds_lfht *ht, unsigned long new_size);
 
+/*
+ * cds_lfht_resize_done_fct - called when an asynchronous resize ends.
+ * @ht: the hash table.
+ * @size: number of buckets of the table after the resize.
+ * @priv: private data passed to cds_lfht_resize_async().
+ *
+ * Called from the resize worker thread, registered as RCU read-side
+ * thread, outside of any RCU read-side critical section. size may
+ * differ from the requested size if another resize or an automatic
+ * resize changed the target in the meantime, or if the table is being
+ * destroyed.
+ */
+typedef void (*cds_lfht_resize_done_fct)(struct cds_lfht *ht,
+		unsigned long size, void *priv);
+
+/*
+ * cds_lfht_resize_async - resize a hash table in the background
+ * @ht: the hash table.
+ * @new_size: update to this hash table size, rounded up to a power of 2.
+ * @done: called once the resize is over, or NULL.
+ * @priv: private data passed to done.
+ *
+ * Queue the resize on the resize worker thread, which is started on
+ * first use for tables created without CDS_LFHT_AUTO_RESIZE, and
+ * return without waiting for the resize mutex. Can be called from a
+ * RCU read-side critical section. Return 0, -ENOMEM if the resize
+ * cannot be queued, or -EBUSY if cds_lfht_destroy() is in progress.
+ * cds_lfht_destroy() waits for queued resizes.
+ */
+extern
+int cds_lfht_resize_async(struct cds_lfht *ht, unsigned long new_size,
+		cds_lfht_resize_done_fct done, void *priv);
+
+/*
+ * cds_lfht_reserve - prepare a hash table for a number of nodes
+ * @ht: the hash table.
+ * @nr_nodes: number of nodes expected in the table.
+ *
+ * Grow the table in the background (see cds_lfht_resize_async()) to
+ * the size automatic resize would give it for nr_nodes nodes, and keep
+ * automatic resize (CDS_LFHT_AUTO_RESIZE with CDS_LFHT_ACCOUNTING) from
+ * shrinking it below that size until the table holds nr_nodes nodes.
+ * A later call replaces the reservation; nr_nodes 0 cancels it. Never
+ * shrinks the table. Return 0, -ENOMEM if the resize cannot be
+ * queued, in which case the reservation still holds, or -EBUSY if
+ * cds_lfht_destroy() is in progress.
+ */
+extern
+int cds_lfht_reserve(struct cds_lfht *ht, unsigned long nr_nodes);
+
+/*
+ * cds_lfht_bloom_enable - filter lookups of absent keys.
+ * @ht: the hash table.
+ * @bits_per_node: filter bits per node (1 to 64). Controls the memory
+ *                 overhead and the false positive rate.
+ * @nr_hashes: number of bits set per node (1 to 16), 0 for the value
+ *             minimizing false positives (about 0.69 * bits_per_node).
+ *
+ * Keeps a blocked Bloom filter of the hash values of the nodes, which
+ * cds_lfht_lookup() tests before walking the hash chain, so that most
+ * lookups of absent keys touch a single cache line of the filter
+ * instead of the chain. With 10 bits per node, at most about 1% of the
+ * lookups of absent keys still walk the chain. Adds set the bits of
+ * their node. Removals cannot clear them: the filter is rebuilt,
+ * without the removed nodes, on each resize of the table, and by the
+ * resize worker once removals reach half the number of nodes the filter
+ * is sized for. The filter is sized after the
+ * number of buckets (or the approximate node count with
+ * CDS_LFHT_ACCOUNTING, if larger), so tables with long hash chains and
+ * no automatic resize have more false positives.
+ *
+ * Calling it again changes the parameters. Return 0 on success,
+ * -EINVAL if a parameter is out of range, -ENOMEM on allocation
+ * failure. Same constraints as cds_lfht_resize().
+ */
+extern
+int cds_lfht_bloom_enable(struct cds_lfht *ht, unsigned int bits_per_node,
+		unsigned int nr_hashes);
+
+/*
+ * cds_lfht_bloom_disable - stop filtering lookups, and free the filter.
+ * Same constraints as cds_lfht_resize().
+ */
+extern
+void cds_lfht_bloom_disable(struct cds_lfht *ht);
+
 /*
  * Note: it is safe to perform element removal (del), replacement, or
  * any hash table update operation during any of the following hash
@@ -467,6 +639,13 @@ void cds_lfht_resize(struct cds_lfht *ht, unsigned long new_size);
 		cds_lfht_next(ht, iter),				\
 			node = cds_lfht_iter_get_node(iter))
 
+#define cds_lfht_for_each_cursor(ht, cursor, batch, node)		\
+	for (cds_lfht_cursor_first(ht, cursor, batch),			\
+			node = cds_lfht_cursor_get_node(cursor);	\
+		node != NULL;						\
+		cds_lfht_cursor_next(ht, cursor),			\
+			node = cds_lfht_cursor_get_node(cursor))
+
 #define cds_lfht_for_each_duplicate(ht, hash, match, key, iter, node)	\
 	for (cds_lfht_lookup(ht, hash, match, key, iter),		\
 			node = cds_lfht_iter_get_node(iter);		\
@@ -483,6 +662,15 @@ void cds_lfht_resize(struct cds_lfht *ht, unsigned long new_size);
 			pos = caa_container_of(cds_lfht_iter_get_node(iter), \
 					__typeof__(*(pos)), member))
 
+#define cds_lfht_for_each_entry_cursor(ht, cursor, batch, pos, member)	\
+	for (cds_lfht_cursor_first(ht, cursor, batch),			\
+			pos = caa_container_of(cds_lfht_cursor_get_node(cursor), \
+					__typeof__(*(pos)), member);	\
+		cds_lfht_cursor_get_node(cursor) != NULL;		\
+		cds_lfht_cursor_next(ht, cursor),			\
+			pos = caa_container_of(cds_lfht_cursor_get_node(cursor), \
+					__typeof__(*(pos)), member))
+
 #define cds_lfht_for_each_entry_duplicate(ht, hash, match, key,		\
 				iter, pos, member)			\
 	for (cds_lfht_lookup(ht, hash, match, key, iter),		\
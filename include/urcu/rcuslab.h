@@ -0,0 +1,154 @@
+#ifndef _URCU_RCUSLAB_H
+#define _URCU_RCUSLAB_H
+
+/*
+ * urcu/rcuslab.h
+ *
+ * Userspace RCU library - RCU-aware slab allocator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Include this file _after_ including your URCU flavor.
+ */
+
+#include <stddef.h>
+#include <urcu/compiler.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The slab cache hands out fixed-size objects from per-thread
+ * magazines. Objects freed with cds_slab_free_rcu() are gathered into
+ * a per-thread magazine which is handed to call_rcu as a whole once
+ * full: a single grace period is awaited for a batch of objects, and
+ * the call_rcu worker returns the magazine to the depot of the CPU
+ * which freed them. Allocation and free only touch thread-local
+ * state in the common case.
+ *
+ * Slab memory is only given back to the system by
+ * cds_slab_cache_destroy(). Objects therefore stay type-stable for the
+ * whole lifetime of the cache.
+ */
+struct cds_slab_cache;
+
+/*
+ * Slab cache creation flags.
+ *
+ * CDS_SLAB_TYPESAFE_BY_RCU: cds_slab_free() recycles the object
+ * immediately, without waiting for a grace period. RCU readers may
+ * therefore observe an object which has been freed and re-allocated
+ * for another use, but never memory of another type. Readers must
+ * re-validate the identity of the object (e.g. re-check its key) after
+ * acquiring a reference, exactly as with the Linux kernel
+ * SLAB_TYPESAFE_BY_RCU caches. Without this flag, cds_slab_free() is
+ * equivalent to cds_slab_free_rcu().
+ */
+enum {
+	CDS_SLAB_TYPESAFE_BY_RCU = (1U << 0),
+};
+
+/*
+ * _cds_slab_cache_create - API used by cds_slab_cache_create wrapper.
+ * Do not use directly.
+ */
+extern
+struct cds_slab_cache *_cds_slab_cache_create(size_t size, size_t align,
+			int flags, void (*ctor)(void *obj),
+			const struct rcu_flavor_struct *flavor);
+
+/*
+ * cds_slab_cache_create - create a slab cache.
+ * @size: size of the objects, in bytes.
+ * @align: alignment of the objects (power of two, 0 for pointer
+ *         alignment).
+ * @flags: slab cache creation flags (can be combined with bitwise or: '|').
+ *           0: no flags.
+ *           CDS_SLAB_TYPESAFE_BY_RCU: allow immediate reuse of objects
+ *                                     released by cds_slab_free().
+ * @ctor: optional constructor, invoked once on each object when it is
+ *        first carved out of a slab (not on every allocation). NULL for
+ *        none.
+ *
+ * Return NULL on error.
+ * Note: the RCU flavor must be already included before the slab header.
+ */
+static inline
+struct cds_slab_cache *cds_slab_cache_create(size_t size, size_t align,
+			int flags, void (*ctor)(void *obj))
+{
+	return _cds_slab_cache_create(size, align, flags, ctor, &rcu_flavor);
+}
+
+/*
+ * cds_slab_cache_destroy - destroy a slab cache.
+ * @cache: the slab cache to destroy.
+ *
+ * Waits for all objects queued by cds_slab_free_rcu() to reach the
+ * end of their grace period, then releases all slab memory, including
+ * objects still allocated. No thread may use the cache concurrently.
+ * Should *not* be called from a RCU read-side critical section nor from
+ * a call_rcu thread context.
+ */
+extern
+void cds_slab_cache_destroy(struct cds_slab_cache *cache);
+
+/*
+ * cds_slab_alloc - allocate an object from a slab cache.
+ * @cache: the slab cache.
+ *
+ * Return NULL if memory cannot be allocated. The content of the object
+ * is whatever the constructor (if any) or its previous user left in it.
+ */
+extern
+void *cds_slab_alloc(struct cds_slab_cache *cache);
+
+/*
+ * cds_slab_free - give an object back to its slab cache.
+ * @cache: the slab cache.
+ * @obj: the object.
+ *
+ * For caches created with CDS_SLAB_TYPESAFE_BY_RCU, the object is made
+ * available for reallocation right away. Otherwise, this is the same
+ * as cds_slab_free_rcu(). If the thread state or a magazine cannot be
+ * allocated, the object is not recycled: its memory is released by
+ * cds_slab_cache_destroy().
+ */
+extern
+void cds_slab_free(struct cds_slab_cache *cache, void *obj);
+
+/*
+ * cds_slab_free_rcu - give an object back after a grace period.
+ * @cache: the slab cache.
+ * @obj: the object, already unpublished from RCU-protected structures.
+ *
+ * The object is reallocated only after a grace period has elapsed.
+ * Frees are batched per thread: a grace period is awaited (through
+ * call_rcu) for each full magazine rather than for each object.
+ * Should be called from a registered RCU read-side thread, like
+ * call_rcu(). Out of memory, the object is not recycled, as with
+ * cds_slab_free().
+ */
+extern
+void cds_slab_free_rcu(struct cds_slab_cache *cache, void *obj);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_RCUSLAB_H */
@@ -0,0 +1,147 @@
+#ifndef _URCU_READ_PROFILE_H
+#define _URCU_READ_PROFILE_H
+
+/*
+ * urcu/read-profile.h
+ *
+ * Userspace RCU library - read-side critical section duration profiler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The profiler hooks are compiled into the outermost rcu_read_lock() and
+ * rcu_read_unlock() (rcu_thread_online(), rcu_quiescent_state() and
+ * rcu_thread_offline() for QSBR, where a section spans from one of them
+ * to the next) when RCU_READ_PROFILE is defined before including the
+ * flavor header; such applications also link against liburcu-common.
+ * Configuring the library with --enable-rcu-read-profile compiles the
+ * hooks into the library wrappers, used by callers without _LGPL_SOURCE.
+ *
+ * The hooks cost one load and one branch while the profiler is disabled
+ * at runtime. Once enabled, one section out of every "period" per thread
+ * is timed and accounted in a per-thread log2 histogram, which is merged
+ * into a histogram of exited threads when its thread exits. Sections
+ * lasting at least "threshold" nanoseconds also capture a backtrace of the
+ * rcu_read_unlock() (or QSBR state change) caller, and the longest of
+ * them are kept for urcu_read_profile_dump(). The end time is read
+ * before the section ends, but the accounting and backtraces happen
+ * after it, so that they delay neither the section nor grace periods.
+ *
+ * Setting URCU_READ_PROFILE="period[,threshold_us]" in the environment
+ * enables the profiler when the library is loaded, and dumps it to
+ * stderr when the library is unloaded.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/tls-compat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define URCU_READ_PROFILE_ENV		"URCU_READ_PROFILE"
+
+/* Bucket i counts durations within [2^i, 2^(i+1)) nanoseconds. */
+#define URCU_READ_PROFILE_NR_BUCKETS	64
+/* Number of longest over-threshold sections kept, and their depth. */
+#define URCU_READ_PROFILE_NR_SLOW	16
+#define URCU_READ_PROFILE_NR_FRAMES	16
+
+struct urcu_read_profile_hist;
+
+/* Per-thread state, only touched by its own thread. */
+struct urcu_read_profile_thread {
+	unsigned long count;		/* sections entered */
+	uint64_t start;			/* start of the timed section, 0 if none */
+	uint64_t stop;			/* end of the timed section, 0 if none */
+	struct urcu_read_profile_hist *hist;
+};
+
+struct urcu_read_profile_summary {
+	uint64_t buckets[URCU_READ_PROFILE_NR_BUCKETS];
+	uint64_t nr_samples;
+	uint64_t max_ns;
+	uint64_t nr_slow;		/* sections over the threshold */
+	unsigned int nr_threads;	/* including exited threads */
+};
+
+/* Sampling period, 0 when disabled. Written by urcu_read_profile_enable(). */
+extern unsigned long urcu_read_profile_period;
+extern DECLARE_URCU_TLS(struct urcu_read_profile_thread, urcu_read_profile_thread);
+
+extern void urcu_read_profile_sample_begin(void);
+extern void urcu_read_profile_sample_stop(void);
+extern void urcu_read_profile_sample_end(void);
+
+/*
+ * Start sampling one section out of every period (a power of two), and
+ * capture backtraces of sections lasting at least threshold_ns (0 for
+ * none). Returns 0, or -EINVAL if period is not a power of two.
+ */
+extern int urcu_read_profile_enable(unsigned long period,
+		uint64_t threshold_ns);
+/* Stop sampling. Collected data is kept. */
+extern void urcu_read_profile_disable(void);
+/* Discard the collected histograms and backtraces. */
+extern void urcu_read_profile_reset(void);
+/* Merge the histograms of all threads. */
+extern void urcu_read_profile_get(struct urcu_read_profile_summary *summary);
+/* Print per-thread histograms and the longest sections' backtraces. */
+extern void urcu_read_profile_dump(FILE *fp);
+
+static inline void _urcu_read_profile_begin(void)
+{
+	unsigned long period = CMM_LOAD_SHARED(urcu_read_profile_period);
+
+	if (caa_likely(!period))
+		return;
+	if (caa_likely(++URCU_TLS(urcu_read_profile_thread).count & (period - 1)))
+		return;
+	urcu_read_profile_sample_begin();
+}
+
+/* Read the end time of a timed section, before the section ends. */
+static inline void _urcu_read_profile_stop(void)
+{
+	if (caa_unlikely(URCU_TLS(urcu_read_profile_thread).start))
+		urcu_read_profile_sample_stop();
+}
+
+/* Account a timed section, once it ended. */
+static inline void _urcu_read_profile_end(void)
+{
+	if (caa_unlikely(URCU_TLS(urcu_read_profile_thread).stop))
+		urcu_read_profile_sample_end();
+}
+
+#ifdef RCU_READ_PROFILE
+#define urcu_read_profile_begin()	_urcu_read_profile_begin()
+#define urcu_read_profile_stop()	_urcu_read_profile_stop()
+#define urcu_read_profile_end()		_urcu_read_profile_end()
+#else
+#define urcu_read_profile_begin()
+#define urcu_read_profile_stop()
+#define urcu_read_profile_end()
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_READ_PROFILE_H */
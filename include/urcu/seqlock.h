@@ -0,0 +1,278 @@
+#ifndef _URCU_SEQLOCK_H
+#define _URCU_SEQLOCK_H
+
+/*
+ * urcu/seqlock.h
+ *
+ * Userspace RCU library - Sequence counters, sequence locks and latches
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Sequence counters protect small multi-word values which are read
+ * often and updated rarely, without allocating a new copy for each
+ * update. Readers retry when they observe a concurrent update; they
+ * never write to shared memory.
+ *
+ * Readers access the protected fields with CMM_LOAD_SHARED() and
+ * writers with CMM_STORE_SHARED(), since reads may race with updates
+ * (the retry discards torn values).
+ *
+ * Interaction with RCU:
+ *
+ * Read-side sections never block: they can be nested within RCU
+ * read-side critical sections, and RCU read-side critical sections can
+ * be nested within them. Pointers loaded within a sequence read-side
+ * section still need rcu_dereference() if they are RCU-protected.
+ *
+ * A cds_seqcount reader spins while an update is in progress. A writer
+ * must therefore *not* wait for a grace period (synchronize_rcu(),
+ * rcu_barrier()) between cds_seqcount_write_begin() and
+ * cds_seqcount_write_end(): a reader spinning within a RCU read-side
+ * critical section (or an online QSBR reader) would deadlock with it.
+ * cds_seqlatch readers never spin, so the latch has no such
+ * restriction and can also be read from contexts which must not wait
+ * for the writer (e.g. signal handlers interrupting the writer).
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <urcu/compiler.h>
+#include <urcu/arch.h>
+#include <urcu/system.h>
+#include <urcu/uatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * cds_seqcount: sequence counter. Odd while an update is in progress.
+ * Writers must be serialized by the caller (see cds_seqlock).
+ */
+struct cds_seqcount {
+	unsigned long seq;
+};
+
+#define CDS_SEQCOUNT_INIT	{ 0 }
+
+static inline
+void cds_seqcount_init(struct cds_seqcount *s)
+{
+	uatomic_set(&s->seq, 0);
+}
+
+/*
+ * cds_seqcount_read_begin - begin a read-side section.
+ *
+ * Waits for any in-progress update to complete. Returns the sequence
+ * value to pass to cds_seqcount_read_retry().
+ */
+static inline
+unsigned long cds_seqcount_read_begin(const struct cds_seqcount *s)
+{
+	unsigned long seq;
+
+	for (;;) {
+		seq = CMM_LOAD_SHARED(s->seq);
+		if (caa_likely(!(seq & 1)))
+			break;
+		caa_cpu_relax();
+	}
+	/* Read sequence before protected data. */
+	cmm_smp_rmb();
+	return seq;
+}
+
+/*
+ * cds_seqcount_read_retry - end a read-side section.
+ *
+ * Returns non-zero if the values read since cds_seqcount_read_begin()
+ * may be inconsistent, in which case the read-side section must be
+ * restarted.
+ */
+static inline
+int cds_seqcount_read_retry(const struct cds_seqcount *s, unsigned long seq)
+{
+	/* Read protected data before re-reading the sequence. */
+	cmm_smp_rmb();
+	return caa_unlikely(CMM_LOAD_SHARED(s->seq) != seq);
+}
+
+/*
+ * cds_seqcount_write_begin - begin an update.
+ */
+static inline
+void cds_seqcount_write_begin(struct cds_seqcount *s)
+{
+	uatomic_set(&s->seq, s->seq + 1);
+	/* Make odd sequence visible before updating protected data. */
+	cmm_smp_wmb();
+}
+
+/*
+ * cds_seqcount_write_end - end an update.
+ */
+static inline
+void cds_seqcount_write_end(struct cds_seqcount *s)
+{
+	/* Update protected data before making sequence even. */
+	cmm_smp_wmb();
+	uatomic_set(&s->seq, s->seq + 1);
+}
+
+/*
+ * cds_seqlock: sequence counter serializing its writers with a mutex.
+ */
+struct cds_seqlock {
+	struct cds_seqcount seqcount;
+	pthread_mutex_t lock;
+};
+
+#define CDS_SEQLOCK_INIT	{ CDS_SEQCOUNT_INIT, PTHREAD_MUTEX_INITIALIZER }
+
+static inline
+void cds_seqlock_init(struct cds_seqlock *sl)
+{
+	int ret;
+
+	cds_seqcount_init(&sl->seqcount);
+	ret = pthread_mutex_init(&sl->lock, NULL);
+	assert(!ret);
+}
+
+static inline
+void cds_seqlock_destroy(struct cds_seqlock *sl)
+{
+	int ret;
+
+	ret = pthread_mutex_destroy(&sl->lock);
+	assert(!ret);
+}
+
+static inline
+unsigned long cds_seqlock_read_begin(const struct cds_seqlock *sl)
+{
+	return cds_seqcount_read_begin(&sl->seqcount);
+}
+
+static inline
+int cds_seqlock_read_retry(const struct cds_seqlock *sl, unsigned long seq)
+{
+	return cds_seqcount_read_retry(&sl->seqcount, seq);
+}
+
+static inline
+void cds_seqlock_write_lock(struct cds_seqlock *sl)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(&sl->lock);
+	assert(!ret);
+	cds_seqcount_write_begin(&sl->seqcount);
+}
+
+static inline
+void cds_seqlock_write_unlock(struct cds_seqlock *sl)
+{
+	int ret;
+
+	cds_seqcount_write_end(&sl->seqcount);
+	ret = pthread_mutex_unlock(&sl->lock);
+	assert(!ret);
+}
+
+/*
+ * cds_seqlatch: sequence counter selecting one of two copies of the
+ * protected data. Readers use copy cds_seqlatch_read_index(seq), which
+ * is never the copy being modified, so they never wait for a writer.
+ *
+ * Writers (serialized by the caller) update both copies:
+ *
+ *	cds_seqlatch_write_flip(&latch);
+ *	update copy[0];
+ *	cds_seqlatch_write_flip(&latch);
+ *	update copy[1];
+ *
+ * Readers:
+ *
+ *	do {
+ *		seq = cds_seqlatch_read_begin(&latch);
+ *		read copy[cds_seqlatch_read_index(seq)];
+ *	} while (cds_seqlatch_read_retry(&latch, seq));
+ *
+ * A reader retries whenever the sequence changed during its read, i.e.
+ * after any flip. This is conservative: only a second flip can make it
+ * read a copy being modified.
+ */
+struct cds_seqlatch {
+	unsigned long seq;
+};
+
+#define CDS_SEQLATCH_INIT	{ 0 }
+
+static inline
+void cds_seqlatch_init(struct cds_seqlatch *l)
+{
+	uatomic_set(&l->seq, 0);
+}
+
+static inline
+unsigned long cds_seqlatch_read_begin(const struct cds_seqlatch *l)
+{
+	unsigned long seq;
+
+	seq = CMM_LOAD_SHARED(l->seq);
+	/* Read sequence before protected data. */
+	cmm_smp_rmb();
+	return seq;
+}
+
+static inline
+unsigned int cds_seqlatch_read_index(unsigned long seq)
+{
+	return seq & 1;
+}
+
+static inline
+int cds_seqlatch_read_retry(const struct cds_seqlatch *l, unsigned long seq)
+{
+	/* Read protected data before re-reading the sequence. */
+	cmm_smp_rmb();
+	return caa_unlikely(CMM_LOAD_SHARED(l->seq) != seq);
+}
+
+/*
+ * cds_seqlatch_write_flip - steer readers to the other copy.
+ *
+ * After this call, readers use the copy which is not the next one to be
+ * updated.
+ */
+static inline
+void cds_seqlatch_write_flip(struct cds_seqlatch *l)
+{
+	/* Complete previous copy update before steering readers to it. */
+	cmm_smp_wmb();
+	uatomic_set(&l->seq, l->seq + 1);
+	/* Steer readers away before updating the other copy. */
+	cmm_smp_wmb();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_SEQLOCK_H */
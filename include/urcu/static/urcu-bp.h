@@ -41,6 +41,7 @@
 #include <urcu/list.h>
 #include <urcu/tls-compat.h>
 #include <urcu/debug.h>
+#include <urcu/read-profile.h>
 
 /*
  * This code section can only be included in LGPL 2.1 compatible source code.
@@ -147,6 +148,7 @@ static inline void _rcu_read_lock_update(unsigned long tmp)
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
 		urcu_bp_smp_mb_slave();
+		urcu_read_profile_begin();
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, tmp + RCU_GP_COUNT);
 }
@@ -184,10 +186,13 @@ static inline void _rcu_read_unlock(void)
 
 	tmp = URCU_TLS(rcu_reader)->ctr;
 	urcu_assert(tmp & RCU_GP_CTR_NEST_MASK);
+	if ((tmp & RCU_GP_CTR_NEST_MASK) == RCU_GP_COUNT)
+		urcu_read_profile_stop();
 	/* Finish using rcu before decrementing the pointer. */
 	urcu_bp_smp_mb_slave();
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader)->ctr, tmp - RCU_GP_COUNT);
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
+	urcu_read_profile_end();
 }
 
 /*
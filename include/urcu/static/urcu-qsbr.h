@@ -43,6 +43,7 @@
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
 #include <urcu/debug.h>
+#include <urcu/read-profile.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -195,9 +196,11 @@ static inline void _rcu_quiescent_state(void)
 	unsigned long gp_ctr;
 
 	urcu_assert(URCU_TLS(rcu_reader).registered);
-	if ((gp_ctr = CMM_LOAD_SHARED(rcu_gp.ctr)) == URCU_TLS(rcu_reader).ctr)
-		return;
-	_rcu_quiescent_state_update_and_wakeup(gp_ctr);
+	urcu_read_profile_stop();
+	if ((gp_ctr = CMM_LOAD_SHARED(rcu_gp.ctr)) != URCU_TLS(rcu_reader).ctr)
+		_rcu_quiescent_state_update_and_wakeup(gp_ctr);
+	urcu_read_profile_end();
+	urcu_read_profile_begin();
 }
 
 /*
@@ -211,10 +214,12 @@ static inline void _rcu_quiescent_state(void)
 static inline void _rcu_thread_offline(void)
 {
 	urcu_assert(URCU_TLS(rcu_reader).registered);
+	urcu_read_profile_stop();
 	cmm_smp_mb();
 	CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, 0);
 	cmm_smp_mb();	/* write URCU_TLS(rcu_reader).ctr before read futex */
 	wake_up_gp();
+	urcu_read_profile_end();
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 }
 
@@ -232,6 +237,7 @@ static inline void _rcu_thread_online(void)
 	cmm_barrier();	/* Ensure the compiler does not reorder us with mutex */
 	_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, CMM_LOAD_SHARED(rcu_gp.ctr));
 	cmm_smp_mb();
+	urcu_read_profile_begin();
 }
 
 #ifdef __cplusplus
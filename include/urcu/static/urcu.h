@@ -43,6 +43,7 @@
 #include <urcu/futex.h>
 #include <urcu/tls-compat.h>
 #include <urcu/debug.h>
+#include <urcu/read-profile.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -201,6 +202,7 @@ static inline void _rcu_read_lock_update(unsigned long tmp)
 	if (caa_likely(!(tmp & RCU_GP_CTR_NEST_MASK))) {
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, _CMM_LOAD_SHARED(rcu_gp.ctr));
 		smp_mb_slave();
+		urcu_read_profile_begin();
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, tmp + RCU_GP_COUNT);
 }
@@ -237,10 +239,12 @@ static inline void _rcu_read_lock(void)
 static inline void _rcu_read_unlock_update_and_wakeup(unsigned long tmp)
 {
 	if (caa_likely((tmp & RCU_GP_CTR_NEST_MASK) == RCU_GP_COUNT)) {
+		urcu_read_profile_stop();
 		smp_mb_slave();
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, tmp - RCU_GP_COUNT);
 		smp_mb_slave();
 		wake_up_gp();
+		urcu_read_profile_end();
 	} else
 		_CMM_STORE_SHARED(URCU_TLS(rcu_reader).ctr, tmp - RCU_GP_COUNT);
 }
@@ -0,0 +1,121 @@
+#ifndef _URCU_STATS_H
+#define _URCU_STATS_H
+
+/*
+ * urcu/stats.h
+ *
+ * Userspace RCU library - live statistics shared memory layout
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * When the URCU_STATS_SHM environment variable is set as the library
+ * is loaded, liburcu publishes its counters in a POSIX shared memory
+ * object, which tools such as urcu-top map read-only to monitor the
+ * process live. A value of "1" names the object "/urcu-stats-<pid>",
+ * a value starting with '/' is used as the object name. The object is
+ * unlinked when the library is unloaded.
+ *
+ * The process updates the counters with plain stores from paths which
+ * already serialize the updates of each counter, and never waits on the
+ * readers of the object: readers may observe counters which are not
+ * consistent with each other and, on 32-bit architectures, torn 64-bit
+ * values. The magic number is written last, once the object is fully
+ * initialized.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define URCU_STATS_ENV			"URCU_STATS_SHM"
+#define URCU_STATS_NAME_FMT		"/urcu-stats-%d"
+#define URCU_STATS_MAGIC		0x5552435553544154ULL	/* "URCUSTAT" */
+#define URCU_STATS_VERSION		1
+
+#define URCU_STATS_NR_CALL_RCU		64
+#define URCU_STATS_NR_LFHT		64
+
+enum urcu_stats_flavor_id {
+	URCU_STATS_FLAVOR_MEMB = 0,
+	URCU_STATS_FLAVOR_MB,
+	URCU_STATS_FLAVOR_SIGNAL,
+	URCU_STATS_FLAVOR_QSBR,
+	URCU_STATS_FLAVOR_BP,
+	URCU_STATS_NR_FLAVORS,
+};
+
+enum urcu_stats_slot_state {
+	URCU_STATS_SLOT_FREE = 0,
+	URCU_STATS_SLOT_USED = 1,
+};
+
+/* Per flavor counters. */
+struct urcu_stats_flavor {
+	uint64_t active;		/* flavor in use by the process */
+	uint64_t nr_threads;		/* registered reader threads */
+	uint64_t nr_gp;			/* grace periods performed */
+	uint64_t nr_gp_shared;		/* synchronize_rcu() served by a concurrent grace period */
+	uint64_t nr_wait;		/* waits for readers */
+	uint64_t gp_last_ns;		/* duration of the last grace period */
+	uint64_t gp_max_ns;		/* longest grace period */
+	uint64_t gp_total_ns;		/* sum of grace period durations */
+	uint64_t defer_fill;		/* defer_rcu() callbacks pending, sampled */
+};
+
+/* One slot per call_rcu worker. */
+struct urcu_stats_call_rcu {
+	uint32_t state;			/* enum urcu_stats_slot_state */
+	int32_t flavor;			/* enum urcu_stats_flavor_id */
+	int32_t cpu;			/* CPU affinity, -1 if none */
+	uint32_t flags;			/* URCU_CALL_RCU_* flags */
+	uint64_t qlen;			/* callbacks queued */
+	uint64_t nr_invoked;		/* callbacks invoked */
+	uint64_t nr_batches;		/* grace periods waited for by the worker */
+};
+
+/* One slot per cds_lfht hash table. */
+struct urcu_stats_lfht {
+	uint32_t state;			/* enum urcu_stats_slot_state */
+	uint32_t flags;			/* CDS_LFHT_* flags */
+	uint64_t size;			/* number of buckets */
+	uint64_t resize_target;		/* requested number of buckets */
+	uint64_t count;			/* approximate node count (CDS_LFHT_ACCOUNTING) */
+	uint64_t min_nr_alloc_buckets;
+	uint64_t max_nr_buckets;
+	uint64_t nr_resize;		/* completed resize operations */
+	uint64_t resize_last_ns;	/* duration of the last resize */
+	uint64_t resize_total_ns;	/* sum of resize durations */
+};
+
+struct urcu_stats {
+	uint64_t magic;			/* URCU_STATS_MAGIC, written last */
+	uint32_t version;		/* URCU_STATS_VERSION */
+	uint32_t size;			/* sizeof(struct urcu_stats) */
+	int64_t pid;
+	uint64_t workqueue_qlen;	/* work queued, last active workqueue */
+	struct urcu_stats_flavor flavor[URCU_STATS_NR_FLAVORS];
+	struct urcu_stats_call_rcu call_rcu[URCU_STATS_NR_CALL_RCU];
+	struct urcu_stats_lfht lfht[URCU_STATS_NR_LFHT];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_STATS_H */
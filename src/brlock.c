@@ -0,0 +1,294 @@
+/*
+ * brlock.c
+ *
+ * Userspace RCU library - Big-reader lock with RCU-assisted fast path
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/uatomic.h>
+#include <urcu/futex.h>
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/brlock.h>
+
+#include "compat-getcpu.h"
+#include "urcu-die.h"
+
+/* Number of checks of the reader counters before sleeping. */
+#define BRLOCK_ACTIVE_ATTEMPTS	100
+
+/* Writer states. */
+enum brlock_writer_state {
+	BRLOCK_NO_WRITER = 0,
+	BRLOCK_WRITER = 1,
+	BRLOCK_WRITER_READERS_WAITING = 2,
+};
+
+struct brlock_slot {
+	unsigned long count;	/* readers holding the lock */
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+struct cds_brlock {
+	int32_t writer;		/* enum brlock_writer_state, futex */
+	int32_t drain_futex;	/* -1 when writer waits for readers */
+	const struct rcu_flavor_struct *flavor;
+	pthread_mutex_t writer_mutex;
+	unsigned int nr_slots;	/* power of two */
+	struct brlock_slot *slots;
+};
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+unsigned int brlock_slot_index(struct cds_brlock *brlock)
+{
+	int cpu;
+
+	cpu = urcu_sched_getcpu();
+	if (caa_unlikely(cpu < 0)) {
+		unsigned long self = (unsigned long) pthread_self();
+
+		/* Spread threads when the current CPU is unknown. */
+		cpu = (int) ((self >> 12) ^ (self >> 4));
+	}
+	return (unsigned int) cpu & (brlock->nr_slots - 1);
+}
+
+static
+void futex_wait_value(int32_t *futex, int32_t val)
+{
+	while (futex_noasync(futex, FUTEX_WAIT, val, NULL, NULL, 0)) {
+		switch (errno) {
+		case EWOULDBLOCK:
+			/* Value already changed. */
+			return;
+		case EINTR:
+			/* Retry if interrupted by signal. */
+			break;	/* Get out of switch. */
+		default:
+			/* Unexpected error. */
+			urcu_die(errno);
+		}
+	}
+}
+
+/*
+ * Block the caller while a writer holds the lock. The caller is not
+ * within a RCU read-side critical section, but QSBR threads are still
+ * online and must go offline so the writer grace period can complete.
+ */
+static
+void brlock_wait_writer(struct cds_brlock *brlock)
+{
+	int was_online;
+
+	was_online = brlock->flavor->read_ongoing();
+	if (was_online)
+		brlock->flavor->thread_offline();
+	for (;;) {
+		int32_t state = uatomic_read(&brlock->writer);
+
+		if (state == BRLOCK_NO_WRITER)
+			break;
+		if (state == BRLOCK_WRITER
+				&& uatomic_cmpxchg(&brlock->writer, BRLOCK_WRITER,
+					BRLOCK_WRITER_READERS_WAITING)
+					!= BRLOCK_WRITER)
+			continue;
+		futex_wait_value(&brlock->writer,
+				BRLOCK_WRITER_READERS_WAITING);
+	}
+	if (was_online)
+		brlock->flavor->thread_online();
+}
+
+static
+int brlock_readers_drained(struct cds_brlock *brlock)
+{
+	unsigned int i;
+
+	/*
+	 * No reader can increment a counter after the grace period
+	 * which followed the writer flag store, so counters only
+	 * decrease: checking them one at a time is enough.
+	 */
+	for (i = 0; i < brlock->nr_slots; i++) {
+		if (uatomic_read(&brlock->slots[i].count))
+			return 0;
+	}
+	return 1;
+}
+
+static
+void brlock_wait_readers(struct cds_brlock *brlock)
+{
+	unsigned int attempts = 0;
+	int was_online;
+
+	was_online = brlock->flavor->read_ongoing();
+	if (was_online)
+		brlock->flavor->thread_offline();
+	for (;;) {
+		if (attempts < BRLOCK_ACTIVE_ATTEMPTS) {
+			if (brlock_readers_drained(brlock))
+				break;
+			attempts++;
+			caa_cpu_relax();
+			continue;
+		}
+		uatomic_set(&brlock->drain_futex, -1);
+		/* Write futex before reading reader counters. */
+		cmm_smp_mb();
+		if (brlock_readers_drained(brlock)) {
+			uatomic_set(&brlock->drain_futex, 0);
+			break;
+		}
+		futex_wait_value(&brlock->drain_futex, -1);
+	}
+	if (was_online)
+		brlock->flavor->thread_online();
+}
+
+struct cds_brlock *_cds_brlock_new(const struct rcu_flavor_struct *flavor)
+{
+	struct cds_brlock *brlock;
+	long nr_cpus;
+	int ret;
+
+	brlock = calloc(1, sizeof(*brlock));
+	if (!brlock)
+		return NULL;
+	brlock->flavor = flavor;
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus <= 0)
+		nr_cpus = 1;
+	for (brlock->nr_slots = 1; brlock->nr_slots < nr_cpus;
+			brlock->nr_slots <<= 1)
+		;
+	ret = posix_memalign((void **) &brlock->slots, CAA_CACHE_LINE_SIZE,
+			brlock->nr_slots * sizeof(*brlock->slots));
+	if (ret) {
+		free(brlock);
+		return NULL;
+	}
+	memset(brlock->slots, 0, brlock->nr_slots * sizeof(*brlock->slots));
+	ret = pthread_mutex_init(&brlock->writer_mutex, NULL);
+	if (ret)
+		urcu_die(ret);
+	return brlock;
+}
+
+void cds_brlock_destroy(struct cds_brlock *brlock)
+{
+	int ret;
+
+	assert(!uatomic_read(&brlock->writer));
+	assert(brlock_readers_drained(brlock));
+	ret = pthread_mutex_destroy(&brlock->writer_mutex);
+	if (ret)
+		urcu_die(ret);
+	free(brlock->slots);
+	free(brlock);
+}
+
+unsigned int cds_brlock_read_lock(struct cds_brlock *brlock)
+{
+	unsigned int idx;
+
+	for (;;) {
+		brlock->flavor->read_lock();
+		if (caa_likely(!CMM_LOAD_SHARED(brlock->writer))) {
+			idx = brlock_slot_index(brlock);
+			uatomic_inc(&brlock->slots[idx].count);
+			brlock->flavor->read_unlock();
+			/* Order counter increment before critical section. */
+			cmm_smp_mb__after_uatomic_inc();
+			return idx;
+		}
+		brlock->flavor->read_unlock();
+		brlock_wait_writer(brlock);
+	}
+}
+
+void cds_brlock_read_unlock(struct cds_brlock *brlock, unsigned int cookie)
+{
+	/* Order critical section before counter decrement. */
+	cmm_smp_mb__before_uatomic_dec();
+	uatomic_dec(&brlock->slots[cookie].count);
+	/* Decrement counter before reading drain futex. */
+	cmm_smp_mb__after_uatomic_dec();
+	if (caa_unlikely(uatomic_read(&brlock->drain_futex) == -1)) {
+		uatomic_set(&brlock->drain_futex, 0);
+		futex_noasync(&brlock->drain_futex, FUTEX_WAKE, 1,
+				NULL, NULL, 0);
+	}
+}
+
+void cds_brlock_write_lock(struct cds_brlock *brlock)
+{
+	mutex_lock(&brlock->writer_mutex);
+	uatomic_set(&brlock->writer, BRLOCK_WRITER);
+	/*
+	 * After the grace period, readers either observed the writer
+	 * flag, or their counter increment is visible.
+	 */
+	brlock->flavor->update_synchronize_rcu();
+	brlock_wait_readers(brlock);
+	/* Order reader critical sections before writer critical section. */
+	cmm_smp_mb();
+}
+
+void cds_brlock_write_unlock(struct cds_brlock *brlock)
+{
+	int32_t state;
+
+	state = uatomic_xchg(&brlock->writer, BRLOCK_NO_WRITER);
+	if (state == BRLOCK_WRITER_READERS_WAITING)
+		futex_noasync(&brlock->writer, FUTEX_WAKE, INT_MAX,
+				NULL, NULL, 0);
+	mutex_unlock(&brlock->writer_mutex);
+}
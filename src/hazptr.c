@@ -0,0 +1,309 @@
+/*
+ * hazptr.c
+ *
+ * Userspace RCU library - Hazard pointers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/uatomic.h>
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/hazptr.h>
+
+#include "urcu-die.h"
+
+/*
+ * Scan the hazard pointers once this many objects are waiting, plus
+ * twice the number of hazard pointers in the domain. This bounds the
+ * scan cost per reclaimed object to a constant, as in Michael's
+ * original scheme.
+ */
+#define HP_SCAN_BATCH		64
+
+struct cds_hp_domain {
+	const struct rcu_flavor_struct *flavor;
+
+	struct cds_hp_record *records;	/* push-only list */
+	unsigned long nr_records;
+
+	/*
+	 * Objects past their grace period, waiting for a scan. Pushed
+	 * with cmpxchg, taken as a whole by the scanner.
+	 */
+	struct cds_hp_head *retired;
+	unsigned long nr_retired;	/* objects retired, not reclaimed */
+	unsigned long nr_scan_pending;	/* on the retired list */
+
+	pthread_mutex_t scan_mutex;
+	void **hazards;			/* scan buffer, under scan_mutex */
+	unsigned long hazards_len;
+};
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void push_retired(struct cds_hp_domain *domain, struct cds_hp_head *head)
+{
+	struct cds_hp_head *old, *cur;
+
+	cur = CMM_LOAD_SHARED(domain->retired);
+	do {
+		old = cur;
+		head->next = old;
+		cur = uatomic_cmpxchg(&domain->retired, old, head);
+	} while (cur != old);
+}
+
+static
+int compare_ptr(const void *a, const void *b)
+{
+	const void *pa = *(void * const *) a, *pb = *(void * const *) b;
+
+	if (pa < pb)
+		return -1;
+	return pa > pb;
+}
+
+/* Grow the scan buffer to len hazard pointers, keep it on failure. */
+static
+int hazards_grow(struct cds_hp_domain *domain, unsigned long len)
+{
+	void **hazards;
+
+	hazards = realloc(domain->hazards, len * sizeof(*domain->hazards));
+	if (!hazards)
+		return -ENOMEM;
+	domain->hazards = hazards;
+	domain->hazards_len = len;
+	return 0;
+}
+
+/*
+ * Snapshot all non-NULL hazard pointers into the sorted scan buffer.
+ * Return the number of hazard pointers found, or -ENOMEM if the buffer
+ * cannot hold them all.
+ *
+ * The buffer is sized after nr_records, but records acquired meanwhile
+ * are pushed at the head of the list and walked first: grow the buffer
+ * when it fills up rather than dropping any slot.
+ */
+static
+long collect_hazards(struct cds_hp_domain *domain)
+{
+	struct cds_hp_record *rec;
+	unsigned long nr_records, nr = 0;
+	unsigned int i;
+
+	nr_records = uatomic_read(&domain->nr_records);
+	if (domain->hazards_len < nr_records * CDS_HP_NR_SLOTS
+			&& hazards_grow(domain, nr_records * CDS_HP_NR_SLOTS))
+		return -ENOMEM;
+	for (rec = rcu_dereference(domain->records); rec;
+			rec = rcu_dereference(rec->next)) {
+		for (i = 0; i < CDS_HP_NR_SLOTS; i++) {
+			void *hp = CMM_LOAD_SHARED(rec->slot[i]);
+
+			if (!hp)
+				continue;
+			if (nr == domain->hazards_len
+					&& hazards_grow(domain, 2 * nr
+						+ CDS_HP_NR_SLOTS))
+				return -ENOMEM;
+			domain->hazards[nr++] = hp;
+		}
+	}
+	qsort(domain->hazards, nr, sizeof(*domain->hazards), compare_ptr);
+	return nr;
+}
+
+/*
+ * Reclaim the retired objects which are not protected by any hazard
+ * pointer. Objects still protected are put back on the retired list.
+ * If another thread is already scanning, let it do the work.
+ */
+static
+void hp_scan(struct cds_hp_domain *domain, int wait)
+{
+	struct cds_hp_head *head, *next;
+	unsigned long nr_reclaimed = 0;
+	long nr_hazards;
+
+	if (wait)
+		mutex_lock(&domain->scan_mutex);
+	else if (pthread_mutex_trylock(&domain->scan_mutex))
+		return;
+
+	head = uatomic_xchg(&domain->retired, NULL);
+	/*
+	 * Order the retired list snapshot before loading the hazard
+	 * pointers. Pairs with the barrier in cds_hp_protect().
+	 */
+	cmm_smp_mb();
+	nr_hazards = collect_hazards(domain);
+	for (; head; head = next) {
+		next = head->next;
+		/* Out of memory: keep everything for the next scan. */
+		if (nr_hazards < 0 || (nr_hazards && bsearch(&head->ptr, domain->hazards,
+				nr_hazards, sizeof(*domain->hazards),
+				compare_ptr))) {
+			push_retired(domain, head);
+			continue;
+		}
+		head->func(head);
+		nr_reclaimed++;
+	}
+	uatomic_add(&domain->nr_scan_pending, -nr_reclaimed);
+	uatomic_add(&domain->nr_retired, -nr_reclaimed);
+	mutex_unlock(&domain->scan_mutex);
+}
+
+static
+void hp_retire_cb(struct rcu_head *rcu)
+{
+	struct cds_hp_head *head = caa_container_of(rcu, struct cds_hp_head, rcu);
+	struct cds_hp_domain *domain = head->domain;
+	unsigned long pending;
+
+	push_retired(domain, head);
+	pending = uatomic_add_return(&domain->nr_scan_pending, 1);
+	if (pending >= HP_SCAN_BATCH + 2 * CDS_HP_NR_SLOTS
+			* uatomic_read(&domain->nr_records))
+		hp_scan(domain, 0);
+}
+
+struct cds_hp_domain *_cds_hp_domain_create(
+			const struct rcu_flavor_struct *flavor)
+{
+	struct cds_hp_domain *domain;
+	int ret;
+
+	domain = calloc(1, sizeof(*domain));
+	if (!domain)
+		return NULL;
+	domain->flavor = flavor;
+	ret = pthread_mutex_init(&domain->scan_mutex, NULL);
+	if (ret)
+		urcu_die(ret);
+	return domain;
+}
+
+int cds_hp_domain_destroy(struct cds_hp_domain *domain)
+{
+	struct cds_hp_record *rec, *next;
+	int ret;
+
+	for (rec = domain->records; rec; rec = rec->next) {
+		if (uatomic_read(&rec->active))
+			return -EBUSY;
+	}
+	cds_hp_barrier(domain);
+	for (rec = domain->records; rec; rec = next) {
+		next = rec->next;
+		free(rec);
+	}
+	free(domain->hazards);
+	ret = pthread_mutex_destroy(&domain->scan_mutex);
+	if (ret)
+		urcu_die(ret);
+	free(domain);
+	return 0;
+}
+
+struct cds_hp_record *cds_hp_record_acquire(struct cds_hp_domain *domain)
+{
+	struct cds_hp_record *rec, *old, *cur;
+
+	/* Recycle a released record first. */
+	for (rec = rcu_dereference(domain->records); rec;
+			rec = rcu_dereference(rec->next)) {
+		if (!CMM_LOAD_SHARED(rec->active)
+				&& !uatomic_cmpxchg(&rec->active, 0, 1))
+			return rec;
+	}
+	if (posix_memalign((void **) &rec, CAA_CACHE_LINE_SIZE, sizeof(*rec)))
+		return NULL;
+	memset(rec, 0, sizeof(*rec));
+	rec->active = 1;
+	(void) uatomic_add_return(&domain->nr_records, 1);
+	cur = CMM_LOAD_SHARED(domain->records);
+	do {
+		old = cur;
+		rec->next = old;
+		cur = uatomic_cmpxchg(&domain->records, old, rec);
+	} while (cur != old);
+	return rec;
+}
+
+void cds_hp_record_release(struct cds_hp_record *rec)
+{
+	unsigned int i;
+
+	for (i = 0; i < CDS_HP_NR_SLOTS; i++)
+		assert(!rec->slot[i]);
+	cmm_smp_mb();
+	uatomic_set(&rec->active, 0);
+}
+
+void cds_hp_retire(struct cds_hp_domain *domain, struct cds_hp_head *head,
+		const void *ptr, void (*func)(struct cds_hp_head *head))
+{
+	head->domain = domain;
+	head->ptr = ptr;
+	head->func = func;
+	uatomic_inc(&domain->nr_retired);
+	domain->flavor->update_call_rcu(&head->rcu, hp_retire_cb);
+}
+
+void cds_hp_barrier(struct cds_hp_domain *domain)
+{
+	/* Get all retired objects past their grace period. */
+	domain->flavor->barrier();
+	for (;;) {
+		hp_scan(domain, 1);
+		if (!uatomic_read(&domain->nr_retired))
+			break;
+		(void) poll(NULL, 0, 10);	/* Wait for hazards to clear. */
+	}
+}
@@ -0,0 +1,241 @@
+/*
+ * rcuarena.c
+ *
+ * Userspace RCU library - RCU generation arena allocator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Objects are carved out of the current region by advancing its "used"
+ * offset with cmpxchg, so that threads allocating concurrently only
+ * take the arena mutex when the current region is exhausted. Objects
+ * larger than half a region get a region of their own, which does not
+ * replace the current one.
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/uatomic.h>
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rcuarena.h>
+
+#include "urcu-die.h"
+
+/* Default region size, in bytes. */
+#define ARENA_REGION_BYTES	(1UL << 20)
+
+struct arena_region {
+	struct arena_region *next;	/* arena->regions */
+	size_t size;			/* bytes of data[] */
+	size_t used;			/* bytes allocated from data[] */
+	unsigned long nr_objects;
+	char data[] __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+};
+
+struct cds_arena {
+	struct arena_region *cur;	/* region to allocate from */
+	size_t region_size;
+	const struct rcu_flavor_struct *flavor;
+
+	/* Set by cds_arena_retire(). */
+	struct rcu_head head;
+	cds_arena_release_fct release;
+	void *priv;
+
+	/* Protected by lock. */
+	pthread_mutex_t lock;
+	struct arena_region *regions;
+};
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+/* Called with arena->lock held. */
+static
+struct arena_region *region_add(struct cds_arena *arena, size_t size)
+{
+	struct arena_region *region;
+
+	if (size > SIZE_MAX - sizeof(*region))
+		return NULL;
+	if (posix_memalign((void **) &region, CAA_CACHE_LINE_SIZE,
+			sizeof(*region) + size))
+		return NULL;
+	region->size = size;
+	region->used = 0;
+	region->nr_objects = 0;
+	region->next = arena->regions;
+	arena->regions = region;
+	return region;
+}
+
+static
+void *region_alloc(struct arena_region *region, size_t size, size_t align)
+{
+	uintptr_t base = (uintptr_t) region->data;
+	size_t old, prev, start;
+
+	old = uatomic_read(&region->used);
+	for (;;) {
+		start = ((base + old + align - 1) & ~(align - 1)) - base;
+		if (start > region->size || region->size - start < size)
+			return NULL;
+		prev = uatomic_cmpxchg(&region->used, old, start + size);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+	uatomic_inc(&region->nr_objects);
+	return region->data + start;
+}
+
+struct cds_arena *_cds_arena_create(size_t region_size,
+			const struct rcu_flavor_struct *flavor)
+{
+	struct cds_arena *arena;
+	int ret;
+
+	arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return NULL;
+	arena->region_size = region_size ? : ARENA_REGION_BYTES;
+	arena->flavor = flavor;
+	ret = pthread_mutex_init(&arena->lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	return arena;
+}
+
+void *cds_arena_alloc(struct cds_arena *arena, size_t size, size_t align)
+{
+	struct arena_region *region, *cur;
+	void *obj;
+
+	if (!align)
+		align = sizeof(void *);
+	/* The region of a large object must not overflow either. */
+	if ((align & (align - 1))
+			|| size > SIZE_MAX - align - sizeof(struct arena_region))
+		return NULL;
+
+	for (;;) {
+		cur = CMM_LOAD_SHARED(arena->cur);
+		cmm_smp_read_barrier_depends();
+		if (caa_likely(cur)) {
+			obj = region_alloc(cur, size, align);
+			if (caa_likely(obj))
+				return obj;
+		}
+
+		mutex_lock(&arena->lock);
+		if (size + align - 1 > arena->region_size / 2) {
+			region = region_add(arena, size + align - 1);
+			obj = region ? region_alloc(region, size, align) : NULL;
+			mutex_unlock(&arena->lock);
+			return obj;
+		}
+		/* Another thread may have replaced the region meanwhile. */
+		if (arena->cur == cur) {
+			region = region_add(arena, arena->region_size);
+			if (!region) {
+				mutex_unlock(&arena->lock);
+				return NULL;
+			}
+			/* Initialize region before publishing it. */
+			cmm_smp_wmb();
+			CMM_STORE_SHARED(arena->cur, region);
+		}
+		mutex_unlock(&arena->lock);
+	}
+}
+
+void cds_arena_get_stats(struct cds_arena *arena,
+			struct cds_arena_stats *stats)
+{
+	struct arena_region *region;
+
+	stats->nr_objects = 0;
+	stats->nr_regions = 0;
+	stats->bytes_used = 0;
+	stats->bytes_reserved = 0;
+	mutex_lock(&arena->lock);
+	for (region = arena->regions; region; region = region->next) {
+		stats->nr_objects += uatomic_read(&region->nr_objects);
+		stats->nr_regions++;
+		stats->bytes_used += uatomic_read(&region->used);
+		stats->bytes_reserved += region->size;
+	}
+	mutex_unlock(&arena->lock);
+}
+
+void cds_arena_destroy(struct cds_arena *arena)
+{
+	struct arena_region *region, *next;
+	int ret;
+
+	for (region = arena->regions; region; region = next) {
+		next = region->next;
+		free(region);
+	}
+	ret = pthread_mutex_destroy(&arena->lock);
+	if (ret)
+		urcu_die(ret);
+	free(arena);
+}
+
+static
+void arena_retire_cb(struct rcu_head *head)
+{
+	struct cds_arena *arena = caa_container_of(head, struct cds_arena,
+			head);
+
+	if (arena->release)
+		arena->release(arena, arena->priv);
+	cds_arena_destroy(arena);
+}
+
+void cds_arena_retire(struct cds_arena *arena, cds_arena_release_fct release,
+			void *priv)
+{
+	arena->release = release;
+	arena->priv = priv;
+	arena->flavor->update_call_rcu(&arena->head, arena_retire_cb);
+}
@@ -0,0 +1,228 @@
+/*
+ * rcuarray.c
+ *
+ * Userspace RCU library - RCU copy-on-write array
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <urcu/compiler.h>
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rcuarray.h>
+
+#include "urcu-die.h"
+
+/* Elements allocated beyond the current ones when copying. */
+#define ARRAY_COPY_SLACK	4
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+struct cds_rcu_array_snap *snap_alloc(struct cds_rcu_array *array,
+		size_t alloc)
+{
+	struct cds_rcu_array_snap *snap;
+
+	if (alloc > (SIZE_MAX - sizeof(*snap)) / array->elem_size)
+		return NULL;
+	snap = malloc(sizeof(*snap) + alloc * array->elem_size);
+	if (!snap)
+		return NULL;
+	snap->nr = 0;
+	snap->alloc = alloc;
+	return snap;
+}
+
+static
+void snap_free_cb(struct rcu_head *head)
+{
+	free(caa_container_of(head, struct cds_rcu_array_snap, head));
+}
+
+struct cds_rcu_array *_cds_rcu_array_create(size_t elem_size,
+		const struct rcu_flavor_struct *flavor)
+{
+	struct cds_rcu_array *array;
+	int ret;
+
+	if (!elem_size)
+		return NULL;
+	array = calloc(1, sizeof(*array));
+	if (!array)
+		return NULL;
+	array->elem_size = elem_size;
+	array->flavor = flavor;
+	array->snap = snap_alloc(array, 0);
+	if (!array->snap) {
+		free(array);
+		return NULL;
+	}
+	ret = pthread_mutex_init(&array->lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	return array;
+}
+
+void cds_rcu_array_destroy(struct cds_rcu_array *array)
+{
+	int ret;
+
+	free(array->snap);
+	ret = pthread_mutex_destroy(&array->lock);
+	if (ret)
+		urcu_die(ret);
+	free(array);
+}
+
+int cds_rcu_array_update_begin(struct cds_rcu_array *array,
+		struct cds_rcu_array_update *update)
+{
+	struct cds_rcu_array_snap *snap, *copy;
+
+	mutex_lock(&array->lock);
+	snap = array->snap;
+	copy = snap_alloc(array, snap->nr + ARRAY_COPY_SLACK);
+	if (!copy) {
+		mutex_unlock(&array->lock);
+		return -ENOMEM;
+	}
+	memcpy(copy->elems, snap->elems, snap->nr * array->elem_size);
+	copy->nr = snap->nr;
+	update->array = array;
+	update->copy = copy;
+	return 0;
+}
+
+int cds_rcu_array_update_insert(struct cds_rcu_array_update *update,
+		size_t index, const void *elem)
+{
+	struct cds_rcu_array *array = update->array;
+	struct cds_rcu_array_snap *copy = update->copy;
+	size_t elem_size = array->elem_size;
+
+	assert(index <= copy->nr);
+	if (copy->nr == copy->alloc) {
+		if (copy->alloc > (SIZE_MAX - sizeof(*copy)) / elem_size / 2)
+			return -ENOMEM;
+		copy = realloc(copy, sizeof(*copy)
+				+ 2 * copy->alloc * elem_size);
+		if (!copy)
+			return -ENOMEM;
+		copy->alloc *= 2;
+		update->copy = copy;
+	}
+	memmove(copy->elems + (index + 1) * elem_size,
+		copy->elems + index * elem_size,
+		(copy->nr - index) * elem_size);
+	memcpy(copy->elems + index * elem_size, elem, elem_size);
+	copy->nr++;
+	return 0;
+}
+
+void cds_rcu_array_update_remove(struct cds_rcu_array_update *update,
+		size_t index)
+{
+	struct cds_rcu_array_snap *copy = update->copy;
+	size_t elem_size = update->array->elem_size;
+
+	assert(index < copy->nr);
+	memmove(copy->elems + index * elem_size,
+		copy->elems + (index + 1) * elem_size,
+		(copy->nr - index - 1) * elem_size);
+	copy->nr--;
+}
+
+void cds_rcu_array_update_commit(struct cds_rcu_array_update *update)
+{
+	struct cds_rcu_array *array = update->array;
+	struct cds_rcu_array_snap *old;
+
+	old = rcu_xchg_pointer(&array->snap, update->copy);
+	mutex_unlock(&array->lock);
+	array->flavor->update_call_rcu(&old->head, snap_free_cb);
+}
+
+void cds_rcu_array_update_abort(struct cds_rcu_array_update *update)
+{
+	free(update->copy);
+	mutex_unlock(&update->array->lock);
+}
+
+int cds_rcu_array_add(struct cds_rcu_array *array, const void *elem)
+{
+	struct cds_rcu_array_update update;
+	int ret;
+
+	ret = cds_rcu_array_update_begin(array, &update);
+	if (ret)
+		return ret;
+	ret = cds_rcu_array_update_insert(&update, update.copy->nr, elem);
+	if (ret) {
+		cds_rcu_array_update_abort(&update);
+		return ret;
+	}
+	cds_rcu_array_update_commit(&update);
+	return 0;
+}
+
+int cds_rcu_array_del(struct cds_rcu_array *array,
+		int (*match)(const void *elem, const void *key),
+		const void *key)
+{
+	struct cds_rcu_array_update update;
+	size_t i;
+	int ret;
+
+	ret = cds_rcu_array_update_begin(array, &update);
+	if (ret)
+		return ret;
+	for (i = 0; i < update.copy->nr; i++) {
+		if (match(cds_rcu_array_get(array, update.copy, i), key)) {
+			cds_rcu_array_update_remove(&update, i);
+			cds_rcu_array_update_commit(&update);
+			return 0;
+		}
+	}
+	cds_rcu_array_update_abort(&update);
+	return -ENOENT;
+}
@@ -0,0 +1,196 @@
+/*
+ * rculfhash-bloom.c
+ *
+ * Userspace RCU library - Lock-Free RCU Hash Table Bloom filter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Adds set the bits of their hash value in ht->bloom (and ht->bloom_next
+ * during a rebuild) before linking the node, so a lookup never misses a
+ * node because of the filter. Removals leave their bits set, and count
+ * in nr_removed: once they reach half the number of nodes the filter is
+ * sized for, cds_lfht_del() queues a rebuild on the resize worker, so
+ * the filter of a table with many removals and no resize does not fill
+ * up. Resizes rebuild the filter too. The filter holds the resize worker
+ * from cds_lfht_bloom_enable() to cds_lfht_bloom_disable() or
+ * cds_lfht_destroy(): removals, within read-side critical sections, only
+ * queue work and never start the worker.
+ *
+ * A rebuild allocates an empty filter, publishes it as bloom_next and
+ * waits for a grace period: from then on, every add sets its bits in
+ * it, and every node added before is linked. It then traverses the
+ * table to set the bits of all nodes, publishes the new filter as bloom,
+ * and frees the old one after another grace period.
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rculfhash.h>
+#include "rculfhash-internal.h"
+#include "urcu-die.h"
+
+/* Nodes between read-side lock yields while filling a new filter. */
+#define BLOOM_REBUILD_BATCH	4096
+/* Largest number of blocks: the block index uses 32 hash bits. */
+#define BLOOM_MAX_BLOCKS	(1ULL << 32)
+/* Fewest removals queueing a rebuild, which walks the whole table. */
+#define BLOOM_MIN_REMOVED	64
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+struct cds_lfht_bloom *bloom_alloc(struct cds_lfht *ht)
+{
+	struct cds_lfht_bloom *bloom;
+	unsigned long long nr_bits, nr_blocks;
+	unsigned long nr_nodes;
+	long count;
+
+	nr_nodes = ht->size;
+	count = CMM_LOAD_SHARED(ht->count);
+	if (count > 0 && (unsigned long) count > nr_nodes)
+		nr_nodes = count;
+	nr_bits = (unsigned long long) nr_nodes * ht->bloom_bits_per_node;
+	for (nr_blocks = 1; nr_blocks * BLOOM_BLOCK_BITS < nr_bits
+			&& nr_blocks < BLOOM_MAX_BLOCKS; nr_blocks <<= 1)
+		;
+	if (nr_blocks > ~0UL / sizeof(unsigned long) / BLOOM_BLOCK_WORDS)
+		return NULL;
+
+	if (posix_memalign((void **) &bloom, CAA_CACHE_LINE_SIZE,
+			sizeof(*bloom)))
+		return NULL;
+	bloom->nr_blocks = nr_blocks;
+	bloom->nr_hashes = ht->bloom_nr_hashes;
+	bloom->max_removed = max(nr_blocks * BLOOM_BLOCK_BITS
+			/ ht->bloom_bits_per_node / 2, BLOOM_MIN_REMOVED);
+	bloom->nr_removed = 0;
+	if (posix_memalign((void **) &bloom->bits, CAA_CACHE_LINE_SIZE,
+			nr_blocks * BLOOM_BLOCK_WORDS * sizeof(unsigned long))) {
+		free(bloom);
+		return NULL;
+	}
+	memset(bloom->bits, 0,
+		nr_blocks * BLOOM_BLOCK_WORDS * sizeof(unsigned long));
+	return bloom;
+}
+
+void cds_lfht_bloom_free(struct cds_lfht_bloom *bloom)
+{
+	if (!bloom)
+		return;
+	free(bloom->bits);
+	free(bloom);
+}
+
+int cds_lfht_bloom_rebuild(struct cds_lfht *ht)
+{
+	struct cds_lfht_bloom *bloom, *old;
+	struct cds_lfht_cursor cursor;
+	struct cds_lfht_node *node;
+
+	bloom = bloom_alloc(ht);
+	if (!bloom)
+		return -ENOMEM;
+	rcu_assign_pointer(ht->bloom_next, bloom);
+	ht->flavor->update_synchronize_rcu();
+
+	ht->flavor->read_lock();
+	cds_lfht_for_each_cursor(ht, &cursor, BLOOM_REBUILD_BATCH, node)
+		cds_lfht_bloom_set(bloom,
+			cds_lfht_bit_reverse_ulong(node->reverse_hash));
+	ht->flavor->read_unlock();
+
+	old = ht->bloom;
+	rcu_assign_pointer(ht->bloom, bloom);
+	/* Publish bloom before clearing bloom_next: see bloom_add(). */
+	cmm_smp_wmb();
+	CMM_STORE_SHARED(ht->bloom_next, NULL);
+	ht->flavor->update_synchronize_rcu();
+	cds_lfht_bloom_free(old);
+	return 0;
+}
+
+int cds_lfht_bloom_enable(struct cds_lfht *ht, unsigned int bits_per_node,
+		unsigned int nr_hashes)
+{
+	unsigned int old_bits, old_hashes;
+	int ret;
+
+	if (!bits_per_node || bits_per_node > 64 || nr_hashes > 16)
+		return -EINVAL;
+	if (!nr_hashes)
+		nr_hashes = bits_per_node * 69 / 100 ? : 1;
+
+	mutex_lock(&ht->resize_mutex);
+	cds_lfht_bloom_get_worker(ht);
+	old_bits = ht->bloom_bits_per_node;
+	old_hashes = ht->bloom_nr_hashes;
+	ht->bloom_bits_per_node = bits_per_node;
+	ht->bloom_nr_hashes = min(nr_hashes, 16U);
+	ret = cds_lfht_bloom_rebuild(ht);
+	if (ret) {
+		/* Keep the current filter consistent with its parameters. */
+		ht->bloom_bits_per_node = old_bits;
+		ht->bloom_nr_hashes = old_hashes;
+	}
+	mutex_unlock(&ht->resize_mutex);
+	return ret;
+}
+
+void cds_lfht_bloom_disable(struct cds_lfht *ht)
+{
+	struct cds_lfht_bloom *old;
+	int put_worker;
+
+	mutex_lock(&ht->resize_mutex);
+	ht->bloom_bits_per_node = 0;
+	old = ht->bloom;
+	rcu_assign_pointer(ht->bloom, NULL);
+	ht->flavor->update_synchronize_rcu();
+	cds_lfht_bloom_free(old);
+	put_worker = ht->bloom_worker;
+	ht->bloom_worker = 0;
+	mutex_unlock(&ht->resize_mutex);
+	if (put_worker)
+		cds_lfht_bloom_put_worker(ht);
+}
@@ -26,6 +26,8 @@
 
 #include <urcu/rculfhash.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <urcu/uatomic.h>
 
 #ifdef DEBUG
 #define dbg_printf(fmt, args...)     printf("[debug rculfhash] " fmt, ## args)
@@ -56,6 +58,34 @@ do {								\
 
 struct ht_items_count;
 
+/*
+ * Blocked Bloom filter of the hash values of the nodes: each hash value
+ * sets nr_hashes bits within a single block of one cache line, chosen
+ * by the hash value.
+ */
+#define BLOOM_BLOCK_BITS		512
+#define BLOOM_BLOCK_WORDS		(BLOOM_BLOCK_BITS / CAA_BITS_PER_LONG)
+
+struct cds_lfht_bloom {
+	unsigned long nr_blocks;	/* power of two */
+	unsigned int nr_hashes;
+	unsigned long *bits;		/* nr_blocks * BLOOM_BLOCK_WORDS */
+	unsigned long max_removed;	/* removals queueing a rebuild */
+	/* Removals since the filter was built, off the lookup cache line. */
+	unsigned long nr_removed __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+};
+
+/*
+ * Bucket node of the compact backends. Only the next pointer is kept:
+ * the reverse hash of a bucket node is bit_reverse_ulong() of its index.
+ * Nodes must be aligned on 8 bytes, because the low bits of next
+ * pointers hold flags: on 32-bit architectures, this makes compact
+ * bucket nodes as large as regular ones.
+ */
+struct cds_lfht_compact_bucket {
+	struct cds_lfht_node *next;
+} __attribute__((aligned(8)));
+
 /*
  * cds_lfht: Top-level data structure representing a lock-free hash
  * table. Defined in the implementation file to make it be an opaque
@@ -65,6 +95,8 @@ struct ht_items_count;
  * structure, because we need to have a variable-sized union to contain
  * the mm plugin fields, which are used in the fast path.
  */
+struct urcu_stats_lfht;
+
 struct cds_lfht {
 	/* Initial configuration items */
 	unsigned long max_nr_buckets;
@@ -85,6 +117,10 @@ struct cds_lfht {
 	unsigned int in_progress_destroy;
 	unsigned long resize_target;
 	int resize_initiated;
+	int async_worker;		/* resize worker started by async resize */
+	int bloom_worker;		/* resize worker held by the Bloom filter */
+	unsigned long reserve_size;	/* no automatic shrink below, 0: none */
+	struct urcu_stats_lfht *stats;	/* live statistics, NULL if disabled */
 
 	/*
 	 * Variables needed for add and remove fast-paths.
@@ -93,17 +129,27 @@ struct cds_lfht {
 	unsigned long min_alloc_buckets_order;
 	unsigned long min_nr_alloc_buckets;
 	struct ht_items_count *split_count;	/* split item count */
+	/* Bloom filter being rebuilt, updated along with bloom. */
+	struct cds_lfht_bloom *bloom_next;
+	unsigned int bloom_bits_per_node;	/* 0 if no Bloom filter */
+	unsigned int bloom_nr_hashes;
 
 	/*
 	 * Variables needed for the lookup, add and remove fast-paths.
 	 */
 	unsigned long size;	/* always a power of 2, shared (RCU) */
+	struct cds_lfht_bloom *bloom;	/* NULL if disabled, shared (RCU) */
 	/*
 	 * bucket_at pointer is kept here to skip the extra level of
 	 * dereference needed to get to "mm" (this is a fast-path).
 	 */
 	struct cds_lfht_node *(*bucket_at)(struct cds_lfht *ht,
 			unsigned long index);
+	/*
+	 * Set by cds_lfht_mm_mmap_compact: bucket nodes are struct
+	 * cds_lfht_compact_bucket in tbl_mmap_compact.
+	 */
+	int compact_buckets;
 	/*
 	 * Dynamic length "tbl_chunk" needs to be at the end of
 	 * cds_lfht.
@@ -136,6 +182,9 @@ struct cds_lfht {
 		 * Their memory is allocated when needed.
 		 */
 		struct cds_lfht_node *tbl_mmap;
+
+		/* Same, with compact bucket nodes. */
+		struct cds_lfht_compact_bucket *tbl_mmap_compact;
 	};
 	/*
 	 * End of variables needed for the lookup, add and remove
@@ -145,6 +194,37 @@ struct cds_lfht {
 
 extern unsigned int cds_lfht_fls_ulong(unsigned long x);
 extern int cds_lfht_get_count_order_ulong(unsigned long x);
+extern unsigned long cds_lfht_bit_reverse_ulong(unsigned long v);
+
+/*
+ * Rebuild the Bloom filter for the current table size, dropping the
+ * hash values of removed nodes. Called with the resize mutex held.
+ * Returns -ENOMEM, keeping the current filter, if the new one cannot be
+ * allocated.
+ */
+extern int cds_lfht_bloom_rebuild(struct cds_lfht *ht);
+extern void cds_lfht_bloom_free(struct cds_lfht_bloom *bloom);
+extern void cds_lfht_bloom_get_worker(struct cds_lfht *ht);
+extern void cds_lfht_bloom_put_worker(struct cds_lfht *ht);
+
+/*
+ * Bulk insertion of nodes, used to load tables. Between
+ * cds_lfht_bulk_begin() and cds_lfht_bulk_end(), the resize mutex is
+ * held, and the caller must be the only updater of the table. Readers
+ * may run concurrently. Nodes are best added in increasing reverse hash
+ * order, i.e. in the order of a table traversal.
+ */
+struct cds_lfht_bulk {
+	struct cds_lfht_node *prev;	/* last node before the insert position */
+	unsigned long prev_hash;	/* reverse hash of prev */
+	unsigned long size;
+};
+
+extern void cds_lfht_bulk_begin(struct cds_lfht *ht,
+		struct cds_lfht_bulk *bulk);
+extern void cds_lfht_bulk_add(struct cds_lfht *ht, struct cds_lfht_bulk *bulk,
+		unsigned long hash, struct cds_lfht_node *node);
+extern void cds_lfht_bulk_end(struct cds_lfht *ht, struct cds_lfht_bulk *bulk);
 
 #ifdef POISON_FREE
 #define poison_free(ptr)					\
@@ -158,6 +238,64 @@ extern int cds_lfht_get_count_order_ulong(unsigned long x);
 #define poison_free(ptr)	free(ptr)
 #endif
 
+/*
+ * Block and bit positions of a hash value: the user hash only needs to
+ * be well distributed in its low bits (which index the buckets), so mix
+ * it first. Bits are picked by double hashing within the block.
+ */
+static inline
+unsigned long *bloom_block(const struct cds_lfht_bloom *bloom,
+		unsigned long hash, uint32_t *h1, uint32_t *h2)
+{
+	uint64_t x = hash;
+
+	/* 64-bit finalizer of MurmurHash3. */
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	*h1 = (uint32_t) x;
+	*h2 = (uint32_t) ((x * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+	return &bloom->bits[((x >> 32) & (bloom->nr_blocks - 1))
+			* BLOOM_BLOCK_WORDS];
+}
+
+/* Return 0 if no node of this hash value is in the table. */
+static inline
+int cds_lfht_bloom_test(const struct cds_lfht_bloom *bloom,
+		unsigned long hash)
+{
+	unsigned long *block;
+	uint32_t h1, h2;
+	unsigned int i, bit;
+
+	block = bloom_block(bloom, hash, &h1, &h2);
+	for (i = 0; i < bloom->nr_hashes; i++) {
+		bit = (h1 + i * h2) & (BLOOM_BLOCK_BITS - 1);
+		if (!(CMM_LOAD_SHARED(block[bit / CAA_BITS_PER_LONG])
+				& (1UL << (bit % CAA_BITS_PER_LONG))))
+			return 0;
+	}
+	return 1;
+}
+
+static inline
+void cds_lfht_bloom_set(struct cds_lfht_bloom *bloom, unsigned long hash)
+{
+	unsigned long *block, mask;
+	uint32_t h1, h2;
+	unsigned int i, bit;
+
+	block = bloom_block(bloom, hash, &h1, &h2);
+	for (i = 0; i < bloom->nr_hashes; i++) {
+		bit = (h1 + i * h2) & (BLOOM_BLOCK_BITS - 1);
+		mask = 1UL << (bit % CAA_BITS_PER_LONG);
+		if (!(CMM_LOAD_SHARED(block[bit / CAA_BITS_PER_LONG]) & mask))
+			uatomic_or(&block[bit / CAA_BITS_PER_LONG], mask);
+	}
+}
+
 static inline
 struct cds_lfht *__default_alloc_cds_lfht(
 		const struct cds_lfht_mm_type *mm,
@@ -122,6 +122,22 @@ void memory_discard(void *ptr, size_t length)
 }
 #endif /* __CYGWIN__ */
 
+/* Size of a bucket node: cds_lfht_mm_mmap_compact only keeps next. */
+static
+size_t bucket_size(struct cds_lfht *ht)
+{
+	if (ht->compact_buckets)
+		return sizeof(struct cds_lfht_compact_bucket);
+	return sizeof(struct cds_lfht_node);
+}
+
+/* Address of the bucket table slot of bucket node index. */
+static
+void *bucket_slot(struct cds_lfht *ht, unsigned long index)
+{
+	return (char *) ht->tbl_mmap + index * bucket_size(ht);
+}
+
 static
 void cds_lfht_alloc_bucket_table(struct cds_lfht *ht, unsigned long order)
 {
@@ -129,22 +145,21 @@ void cds_lfht_alloc_bucket_table(struct cds_lfht *ht, unsigned long order)
 		if (ht->min_nr_alloc_buckets == ht->max_nr_buckets) {
 			/* small table */
 			ht->tbl_mmap = calloc(ht->max_nr_buckets,
-					sizeof(*ht->tbl_mmap));
+					bucket_size(ht));
 			assert(ht->tbl_mmap);
 			return;
 		}
 		/* large table */
 		ht->tbl_mmap = memory_map(ht->max_nr_buckets
-			* sizeof(*ht->tbl_mmap));
+			* bucket_size(ht));
 		memory_populate(ht->tbl_mmap,
-			ht->min_nr_alloc_buckets * sizeof(*ht->tbl_mmap));
+			ht->min_nr_alloc_buckets * bucket_size(ht));
 	} else if (order > ht->min_alloc_buckets_order) {
 		/* large table */
 		unsigned long len = 1UL << (order - 1);
 
 		assert(ht->min_nr_alloc_buckets < ht->max_nr_buckets);
-		memory_populate(ht->tbl_mmap + len,
-				len * sizeof(*ht->tbl_mmap));
+		memory_populate(bucket_slot(ht, len), len * bucket_size(ht));
 	}
 	/* Nothing to do for 0 < order && order <= ht->min_alloc_buckets_order */
 }
@@ -160,18 +175,21 @@ void cds_lfht_free_bucket_table(struct cds_lfht *ht, unsigned long order)
 	if (order == 0) {
 		if (ht->min_nr_alloc_buckets == ht->max_nr_buckets) {
 			/* small table */
-			poison_free(ht->tbl_mmap);
+			if (ht->compact_buckets)
+				poison_free(ht->tbl_mmap_compact);
+			else
+				poison_free(ht->tbl_mmap);
 			return;
 		}
 		/* large table */
 		memory_unmap(ht->tbl_mmap,
-			ht->max_nr_buckets * sizeof(*ht->tbl_mmap));
+			ht->max_nr_buckets * bucket_size(ht));
 	} else if (order > ht->min_alloc_buckets_order) {
 		/* large table */
 		unsigned long len = 1UL << (order - 1);
 
 		assert(ht->min_nr_alloc_buckets < ht->max_nr_buckets);
-		memory_discard(ht->tbl_mmap + len, len * sizeof(*ht->tbl_mmap));
+		memory_discard(bucket_slot(ht, len), len * bucket_size(ht));
 	}
 	/* Nothing to do for 0 < order && order <= ht->min_alloc_buckets_order */
 }
@@ -183,12 +201,20 @@ struct cds_lfht_node *bucket_at(struct cds_lfht *ht, unsigned long index)
 }
 
 static
-struct cds_lfht *alloc_cds_lfht(unsigned long min_nr_alloc_buckets,
+struct cds_lfht_node *compact_bucket_at(struct cds_lfht *ht,
+		unsigned long index)
+{
+	return (struct cds_lfht_node *) &ht->tbl_mmap_compact[index];
+}
+
+static
+struct cds_lfht *__alloc_cds_lfht(const struct cds_lfht_mm_type *mm,
+		size_t size, unsigned long min_nr_alloc_buckets,
 		unsigned long max_nr_buckets)
 {
 	unsigned long page_bucket_size;
 
-	page_bucket_size = getpagesize() / sizeof(struct cds_lfht_node);
+	page_bucket_size = getpagesize() / size;
 	if (max_nr_buckets <= page_bucket_size) {
 		/* small table */
 		min_nr_alloc_buckets = max_nr_buckets;
@@ -199,13 +225,42 @@ struct cds_lfht *alloc_cds_lfht(unsigned long min_nr_alloc_buckets,
 	}
 
 	return __default_alloc_cds_lfht(
-			&cds_lfht_mm_mmap, sizeof(struct cds_lfht),
+			mm, sizeof(struct cds_lfht),
 			min_nr_alloc_buckets, max_nr_buckets);
 }
 
+static
+struct cds_lfht *alloc_cds_lfht(unsigned long min_nr_alloc_buckets,
+		unsigned long max_nr_buckets)
+{
+	return __alloc_cds_lfht(&cds_lfht_mm_mmap,
+			sizeof(struct cds_lfht_node),
+			min_nr_alloc_buckets, max_nr_buckets);
+}
+
+static
+struct cds_lfht *alloc_cds_lfht_compact(unsigned long min_nr_alloc_buckets,
+		unsigned long max_nr_buckets)
+{
+	struct cds_lfht *ht;
+
+	ht = __alloc_cds_lfht(&cds_lfht_mm_mmap_compact,
+			sizeof(struct cds_lfht_compact_bucket),
+			min_nr_alloc_buckets, max_nr_buckets);
+	ht->compact_buckets = 1;
+	return ht;
+}
+
 const struct cds_lfht_mm_type cds_lfht_mm_mmap = {
 	.alloc_cds_lfht = alloc_cds_lfht,
 	.alloc_bucket_table = cds_lfht_alloc_bucket_table,
 	.free_bucket_table = cds_lfht_free_bucket_table,
 	.bucket_at = bucket_at,
 };
+
+const struct cds_lfht_mm_type cds_lfht_mm_mmap_compact = {
+	.alloc_cds_lfht = alloc_cds_lfht_compact,
+	.alloc_bucket_table = cds_lfht_alloc_bucket_table,
+	.free_bucket_table = cds_lfht_free_bucket_table,
+	.bucket_at = compact_bucket_at,
+};
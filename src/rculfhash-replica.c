@@ -0,0 +1,369 @@
+/*
+ * rculfhash-replica.c
+ *
+ * Userspace RCU library - NUMA-Replicated RCU Hash Table
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rculfhash-replica.h>
+
+#include "compat-getcpu.h"
+#include "urcu-die.h"
+
+struct cds_lfht_replica {
+	const struct rcu_flavor_struct *flavor;
+	cds_lfht_replica_copy_fct copy;
+	cds_lfht_replica_free_fct free_node;
+	void *priv;
+
+	long nr_cpus;
+	unsigned long *cpu_to_replica;
+
+	/* Protected by writer_mutex. */
+	pthread_mutex_t writer_mutex;
+	struct cds_lfht_node **copies;	/* copies being added */
+	struct cds_lfht_node **old;	/* copies to release */
+
+	unsigned long nr_replicas;
+	struct cds_lfht *tables[];
+};
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+/*
+ * NUMA node of a CPU, from its sysfs "nodeN" link. Node 0 if unknown,
+ * e.g. on kernels without NUMA support.
+ */
+static
+unsigned long cpu_numa_node(long cpu)
+{
+	char path[64];
+	struct dirent *entry;
+	unsigned long node = 0;
+	DIR *dir;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%ld", cpu);
+	dir = opendir(path);
+	if (!dir)
+		return 0;
+	while ((entry = readdir(dir)) != NULL) {
+		if (!strncmp(entry->d_name, "node", 4)
+				&& isdigit((unsigned char) entry->d_name[4])) {
+			node = strtoul(entry->d_name + 4, NULL, 10);
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+
+/*
+ * Fill the CPU to replica map. Return the number of NUMA nodes seen.
+ */
+static
+unsigned long init_cpu_to_replica(unsigned long *cpu_to_replica,
+		long nr_cpus)
+{
+	unsigned long nr_nodes = 1;
+	long cpu;
+
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		cpu_to_replica[cpu] = cpu_numa_node(cpu);
+		if (cpu_to_replica[cpu] >= nr_nodes)
+			nr_nodes = cpu_to_replica[cpu] + 1;
+	}
+	return nr_nodes;
+}
+
+struct cds_lfht_replica *_cds_lfht_replica_new(unsigned long nr_replicas,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			cds_lfht_replica_copy_fct copy,
+			cds_lfht_replica_free_fct free_node,
+			void *priv,
+			const struct cds_lfht_mm_type *mm,
+			const struct rcu_flavor_struct *flavor,
+			pthread_attr_t *attr)
+{
+	struct cds_lfht_replica *map;
+	unsigned long *cpu_to_replica, nr_nodes, i = 0;
+	long nr_cpus, cpu;
+	int ret;
+
+	if (!copy || !free_node)
+		return NULL;
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus <= 0)
+		nr_cpus = 1;
+	cpu_to_replica = calloc(nr_cpus, sizeof(*cpu_to_replica));
+	if (!cpu_to_replica)
+		return NULL;
+	nr_nodes = init_cpu_to_replica(cpu_to_replica, nr_cpus);
+	if (!nr_replicas)
+		nr_replicas = nr_nodes;
+	for (cpu = 0; cpu < nr_cpus; cpu++)
+		cpu_to_replica[cpu] %= nr_replicas;
+
+	map = calloc(1, sizeof(*map)
+			+ nr_replicas * sizeof(struct cds_lfht *));
+	if (!map)
+		goto error_map;
+	map->flavor = flavor;
+	map->copy = copy;
+	map->free_node = free_node;
+	map->priv = priv;
+	map->nr_cpus = nr_cpus;
+	map->cpu_to_replica = cpu_to_replica;
+	map->nr_replicas = nr_replicas;
+	map->copies = calloc(nr_replicas, sizeof(*map->copies));
+	map->old = calloc(nr_replicas, sizeof(*map->old));
+	if (!map->copies || !map->old)
+		goto error_tables;
+	for (i = 0; i < nr_replicas; i++) {
+		map->tables[i] = _cds_lfht_new(init_size, min_nr_alloc_buckets,
+				max_nr_buckets, flags, mm, flavor, attr);
+		if (!map->tables[i])
+			goto error_tables;
+	}
+	ret = pthread_mutex_init(&map->writer_mutex, NULL);
+	if (ret)
+		urcu_die(ret);
+	return map;
+
+error_tables:
+	while (i-- > 0)
+		(void) cds_lfht_destroy(map->tables[i], NULL);
+	free(map->copies);
+	free(map->old);
+	free(map);
+error_map:
+	free(cpu_to_replica);
+	return NULL;
+}
+
+int cds_lfht_replica_destroy(struct cds_lfht_replica *map,
+		pthread_attr_t **attr)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	unsigned long i;
+	int ret;
+
+	/* No concurrent readers: copies can be released right away. */
+	for (i = 0; i < map->nr_replicas; i++) {
+		map->flavor->read_lock();
+		cds_lfht_for_each(map->tables[i], &iter, node) {
+			ret = cds_lfht_del(map->tables[i], node);
+			assert(!ret);
+			map->free_node(node, map->priv);
+		}
+		map->flavor->read_unlock();
+		ret = cds_lfht_destroy(map->tables[i], attr);
+		if (ret)
+			return ret;
+	}
+	ret = pthread_mutex_destroy(&map->writer_mutex);
+	if (ret)
+		urcu_die(ret);
+	free(map->copies);
+	free(map->old);
+	free(map->cpu_to_replica);
+	free(map);
+	return 0;
+}
+
+unsigned long cds_lfht_replica_nr_replicas(struct cds_lfht_replica *map)
+{
+	return map->nr_replicas;
+}
+
+struct cds_lfht *cds_lfht_replica_get(struct cds_lfht_replica *map,
+		unsigned long index)
+{
+	assert(index < map->nr_replicas);
+	return map->tables[index];
+}
+
+struct cds_lfht *cds_lfht_replica_local(struct cds_lfht_replica *map)
+{
+	int cpu;
+
+	cpu = urcu_sched_getcpu();
+	if (caa_unlikely(cpu < 0 || cpu >= map->nr_cpus))
+		return map->tables[0];
+	return map->tables[map->cpu_to_replica[cpu]];
+}
+
+void cds_lfht_replica_lookup(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_iter *iter)
+{
+	cds_lfht_lookup(cds_lfht_replica_local(map), hash, match, key, iter);
+}
+
+/*
+ * Allocate a copy of node for each replica. On failure, release the
+ * copies already made (they were never published) and return -ENOMEM.
+ * Called with writer_mutex held.
+ */
+static
+int replica_copy(struct cds_lfht_replica *map, struct cds_lfht_node *node)
+{
+	unsigned long i;
+
+	for (i = 0; i < map->nr_replicas; i++) {
+		map->copies[i] = map->copy(node, (int) i, map->priv);
+		if (!map->copies[i])
+			goto error;
+	}
+	return 0;
+
+error:
+	while (i-- > 0)
+		map->free_node(map->copies[i], map->priv);
+	return -ENOMEM;
+}
+
+/*
+ * Release the copies unpublished from the replicas, after a single
+ * grace period. Called with writer_mutex held.
+ */
+static
+void replica_release_old(struct cds_lfht_replica *map)
+{
+	unsigned long i;
+
+	for (i = 0; i < map->nr_replicas; i++)
+		if (map->old[i])
+			break;
+	if (i == map->nr_replicas)
+		return;
+	map->flavor->update_synchronize_rcu();
+	for (i = 0; i < map->nr_replicas; i++) {
+		if (map->old[i])
+			map->free_node(map->old[i], map->priv);
+		map->old[i] = NULL;
+	}
+}
+
+int cds_lfht_replica_add_unique(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *node)
+{
+	struct cds_lfht_iter iter;
+	unsigned long i;
+	int ret;
+
+	mutex_lock(&map->writer_mutex);
+	/* Replicas only differ while writer_mutex is held. */
+	map->flavor->read_lock();
+	cds_lfht_lookup(map->tables[0], hash, match, key, &iter);
+	map->flavor->read_unlock();
+	if (cds_lfht_iter_get_node(&iter)) {
+		ret = -EEXIST;
+		goto end;
+	}
+	ret = replica_copy(map, node);
+	if (ret)
+		goto end;
+	map->flavor->read_lock();
+	for (i = 0; i < map->nr_replicas; i++)
+		cds_lfht_add(map->tables[i], hash, map->copies[i]);
+	map->flavor->read_unlock();
+end:
+	mutex_unlock(&map->writer_mutex);
+	return ret;
+}
+
+int cds_lfht_replica_add_replace(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *node)
+{
+	unsigned long i;
+	int ret;
+
+	mutex_lock(&map->writer_mutex);
+	ret = replica_copy(map, node);
+	if (ret)
+		goto end;
+	map->flavor->read_lock();
+	for (i = 0; i < map->nr_replicas; i++)
+		map->old[i] = cds_lfht_add_replace(map->tables[i], hash,
+				match, key, map->copies[i]);
+	map->flavor->read_unlock();
+	replica_release_old(map);
+end:
+	mutex_unlock(&map->writer_mutex);
+	return ret;
+}
+
+int cds_lfht_replica_del(struct cds_lfht_replica *map,
+		unsigned long hash, cds_lfht_match_fct match, const void *key)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	unsigned long i;
+	int ret = -ENOENT;
+
+	mutex_lock(&map->writer_mutex);
+	map->flavor->read_lock();
+	for (i = 0; i < map->nr_replicas; i++) {
+		cds_lfht_lookup(map->tables[i], hash, match, key, &iter);
+		node = cds_lfht_iter_get_node(&iter);
+		if (node && !cds_lfht_del(map->tables[i], node)) {
+			map->old[i] = node;
+			ret = 0;
+		}
+	}
+	map->flavor->read_unlock();
+	replica_release_old(map);
+	mutex_unlock(&map->writer_mutex);
+	return ret;
+}
@@ -0,0 +1,262 @@
+/*
+ * rculfhash-shard.c
+ *
+ * Userspace RCU library - Sharded Lock-Free RCU Hash Table
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rculfhash-shard.h>
+#include "rculfhash-internal.h"
+
+struct cds_lfht_shard {
+	const struct rcu_flavor_struct *flavor;
+	unsigned int shard_order;
+	unsigned long nr_shards;
+	struct cds_lfht *tables[];
+};
+
+#if (CAA_BITS_PER_LONG == 32)
+#define SHARD_HASH_MULT		0x9e3779b9UL
+#else
+#define SHARD_HASH_MULT		0x9e3779b97f4a7c15UL
+#endif
+
+/*
+ * Shard of a hash value: the shard_order high bits of its product by
+ * the golden ratio, which depend on all the bits of the hash value.
+ * Hash values of 32 bits on 64-bit architectures, whose high bits are
+ * all zero, are spread over all shards too.
+ */
+static inline
+unsigned long shard_index(struct cds_lfht_shard *map, unsigned long hash)
+{
+	if (!map->shard_order)
+		return 0;
+	return (hash * SHARD_HASH_MULT)
+		>> (CAA_BITS_PER_LONG - map->shard_order);
+}
+
+static inline
+unsigned long node_shard_index(struct cds_lfht_shard *map,
+		struct cds_lfht_node *node)
+{
+	return shard_index(map,
+		cds_lfht_bit_reverse_ulong(node->reverse_hash));
+}
+
+struct cds_lfht_shard *_cds_lfht_shard_new(unsigned int shard_order,
+			unsigned long init_size,
+			unsigned long min_nr_alloc_buckets,
+			unsigned long max_nr_buckets,
+			int flags,
+			const struct cds_lfht_mm_type *mm,
+			const struct rcu_flavor_struct *flavor,
+			pthread_attr_t *attr)
+{
+	struct cds_lfht_shard *map;
+	unsigned long i;
+
+	if (shard_order >= CAA_BITS_PER_LONG)
+		return NULL;
+	map = calloc(1, sizeof(*map)
+			+ (sizeof(struct cds_lfht *) << shard_order));
+	if (!map)
+		return NULL;
+	map->flavor = flavor;
+	map->shard_order = shard_order;
+	map->nr_shards = 1UL << shard_order;
+	for (i = 0; i < map->nr_shards; i++) {
+		map->tables[i] = _cds_lfht_new(init_size, min_nr_alloc_buckets,
+				max_nr_buckets, flags, mm, flavor, attr);
+		if (!map->tables[i])
+			goto error;
+	}
+	return map;
+
+error:
+	while (i-- > 0)
+		(void) cds_lfht_destroy(map->tables[i], NULL);
+	free(map);
+	return NULL;
+}
+
+int cds_lfht_shard_destroy(struct cds_lfht_shard *map, pthread_attr_t **attr)
+{
+	struct cds_lfht_iter iter;
+	unsigned long i;
+	int ret;
+
+	/* Fail before destroying any shard. */
+	map->flavor->read_lock();
+	for (i = 0; i < map->nr_shards; i++) {
+		cds_lfht_first(map->tables[i], &iter);
+		if (cds_lfht_iter_get_node(&iter))
+			break;
+	}
+	map->flavor->read_unlock();
+	if (i < map->nr_shards)
+		return -EPERM;
+
+	for (i = 0; i < map->nr_shards; i++) {
+		ret = cds_lfht_destroy(map->tables[i], attr);
+		assert(!ret);
+	}
+	free(map);
+	return 0;
+}
+
+struct cds_lfht *cds_lfht_shard_get(struct cds_lfht_shard *map,
+		unsigned long hash)
+{
+	return map->tables[shard_index(map, hash)];
+}
+
+void cds_lfht_shard_lookup(struct cds_lfht_shard *map, unsigned long hash,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_shard_iter *iter)
+{
+	iter->index = shard_index(map, hash);
+	cds_lfht_lookup(map->tables[iter->index], hash, match, key,
+			&iter->iter);
+}
+
+void cds_lfht_shard_next_duplicate(struct cds_lfht_shard *map,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_shard_iter *iter)
+{
+	cds_lfht_next_duplicate(map->tables[iter->index], match, key,
+			&iter->iter);
+}
+
+void cds_lfht_shard_add(struct cds_lfht_shard *map, unsigned long hash,
+		struct cds_lfht_node *node)
+{
+	cds_lfht_add(map->tables[shard_index(map, hash)], hash, node);
+}
+
+struct cds_lfht_node *cds_lfht_shard_add_unique(struct cds_lfht_shard *map,
+		unsigned long hash, cds_lfht_match_fct match,
+		const void *key, struct cds_lfht_node *node)
+{
+	return cds_lfht_add_unique(map->tables[shard_index(map, hash)], hash,
+			match, key, node);
+}
+
+struct cds_lfht_node *cds_lfht_shard_add_replace(struct cds_lfht_shard *map,
+		unsigned long hash, cds_lfht_match_fct match,
+		const void *key, struct cds_lfht_node *node)
+{
+	return cds_lfht_add_replace(map->tables[shard_index(map, hash)], hash,
+			match, key, node);
+}
+
+int cds_lfht_shard_replace(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *old_iter, unsigned long hash,
+		cds_lfht_match_fct match, const void *key,
+		struct cds_lfht_node *new_node)
+{
+	if (shard_index(map, hash) != old_iter->index)
+		return -EINVAL;
+	return cds_lfht_replace(map->tables[old_iter->index], &old_iter->iter,
+			hash, match, key, new_node);
+}
+
+int cds_lfht_shard_del(struct cds_lfht_shard *map, struct cds_lfht_node *node)
+{
+	if (!node)
+		return -ENOENT;
+	return cds_lfht_del(map->tables[node_shard_index(map, node)], node);
+}
+
+/* Move on to the first node of the following non-empty shard. */
+static
+void shard_iter_skip_empty(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *iter)
+{
+	while (!cds_lfht_iter_get_node(&iter->iter)
+			&& ++iter->index < map->nr_shards)
+		cds_lfht_first(map->tables[iter->index], &iter->iter);
+}
+
+void cds_lfht_shard_first(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *iter)
+{
+	iter->index = 0;
+	cds_lfht_first(map->tables[0], &iter->iter);
+	shard_iter_skip_empty(map, iter);
+}
+
+void cds_lfht_shard_next(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_iter *iter)
+{
+	cds_lfht_next(map->tables[iter->index], &iter->iter);
+	shard_iter_skip_empty(map, iter);
+}
+
+void cds_lfht_shard_resize(struct cds_lfht_shard *map, unsigned long new_size)
+{
+	unsigned long i;
+
+	for (i = 0; i < map->nr_shards; i++)
+		cds_lfht_resize(map->tables[i], new_size);
+}
+
+void cds_lfht_shard_count_nodes(struct cds_lfht_shard *map,
+		long *approx_before,
+		unsigned long *count,
+		long *approx_after)
+{
+	long before, after;
+	unsigned long nr, i;
+
+	*approx_before = 0;
+	*count = 0;
+	*approx_after = 0;
+	for (i = 0; i < map->nr_shards; i++) {
+		cds_lfht_count_nodes(map->tables[i], &before, &nr, &after);
+		*approx_before += before;
+		*count += nr;
+		*approx_after += after;
+	}
+}
+
+void cds_lfht_shard_get_stats(struct cds_lfht_shard *map,
+		struct cds_lfht_shard_stats *stats)
+{
+	unsigned long size, i;
+
+	stats->nr_shards = map->nr_shards;
+	stats->nr_buckets = 0;
+	stats->min_shard_buckets = ~0UL;
+	stats->max_shard_buckets = 0;
+	stats->approx_count = 0;
+	for (i = 0; i < map->nr_shards; i++) {
+		size = CMM_LOAD_SHARED(map->tables[i]->size);
+		stats->nr_buckets += size;
+		stats->min_shard_buckets = min(stats->min_shard_buckets, size);
+		stats->max_shard_buckets = max(stats->max_shard_buckets, size);
+		stats->approx_count += CMM_LOAD_SHARED(map->tables[i]->count);
+	}
+}
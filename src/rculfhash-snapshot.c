@@ -0,0 +1,279 @@
+/*
+ * rculfhash-snapshot.c
+ *
+ * Userspace RCU library - Lock-Free RCU Hash Table snapshots
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Snapshot file layout:
+ *
+ * - struct snapshot_header,
+ * - for each node, in table traversal order, a struct snapshot_record
+ *   followed by the serialized node, padded to SNAPSHOT_ALIGN bytes.
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rculfhash-snapshot.h>
+#include "rculfhash-internal.h"
+
+#define SNAPSHOT_MAGIC		"LFHTSNAP"
+#define SNAPSHOT_VERSION	1
+#define SNAPSHOT_BYTE_ORDER	0x01020304U
+#define SNAPSHOT_ALIGN		8
+/* Write buffer size, in bytes. */
+#define SNAPSHOT_BUF_SIZE	65536
+
+struct snapshot_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t long_size;
+	uint32_t pad;
+	uint64_t nr_nodes;
+	uint64_t nr_buckets;
+};
+
+struct snapshot_record {
+	uint64_t hash;
+	uint64_t len;
+};
+
+struct snapshot_writer {
+	int fd;
+	char *buf;
+	size_t len;		/* bytes used in buf */
+	size_t alloc;		/* bytes allocated for buf */
+};
+
+static
+size_t snapshot_align(size_t len)
+{
+	return (len + SNAPSHOT_ALIGN - 1) & ~((size_t) SNAPSHOT_ALIGN - 1);
+}
+
+static
+int write_all(int fd, const char *buf, size_t len, off_t offset)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = pwrite(fd, buf, len, offset);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		buf += ret;
+		len -= ret;
+		offset += ret;
+	}
+	return 0;
+}
+
+static
+int writer_flush(struct snapshot_writer *writer, off_t *offset)
+{
+	int ret;
+
+	ret = write_all(writer->fd, writer->buf, writer->len, *offset);
+	if (ret)
+		return ret;
+	*offset += writer->len;
+	writer->len = 0;
+	return 0;
+}
+
+/*
+ * Append the record of node to the write buffer, flushing or growing
+ * it as needed.
+ */
+static
+int writer_add(struct snapshot_writer *writer, off_t *offset,
+		struct cds_lfht_node *node,
+		cds_lfht_snapshot_serialize_fct serialize, void *priv)
+{
+	struct snapshot_record record;
+	size_t avail, needed;
+	long len = 0;
+	char *buf;
+	int ret;
+
+	for (;;) {
+		avail = writer->alloc - writer->len;
+		if (avail >= sizeof(record)) {
+			avail -= sizeof(record);
+			len = serialize(node, writer->buf + writer->len
+					+ sizeof(record), avail, priv);
+			if (len < 0)
+				return -EINVAL;
+			if ((size_t) len <= avail)
+				break;
+		}
+		if (writer->len) {
+			ret = writer_flush(writer, offset);
+			if (ret)
+				return ret;
+			continue;
+		}
+		needed = snapshot_align(sizeof(record) + len);
+		buf = realloc(writer->buf, needed);
+		if (!buf)
+			return -ENOMEM;
+		writer->buf = buf;
+		writer->alloc = needed;
+	}
+	record.hash = cds_lfht_bit_reverse_ulong(node->reverse_hash);
+	record.len = len;
+	memcpy(writer->buf + writer->len, &record, sizeof(record));
+	needed = snapshot_align(sizeof(record) + len);
+	memset(writer->buf + writer->len + sizeof(record) + len, 0,
+			needed - sizeof(record) - len);
+	writer->len += needed;
+	return 0;
+}
+
+long cds_lfht_snapshot_save(struct cds_lfht *ht, int fd, unsigned long batch,
+		cds_lfht_snapshot_serialize_fct serialize, void *priv)
+{
+	struct snapshot_writer writer;
+	struct snapshot_header header;
+	struct cds_lfht_cursor cursor;
+	struct cds_lfht_node *node;
+	off_t offset = sizeof(header);
+	long nr_nodes = 0;
+	int ret = 0;
+
+	writer.fd = fd;
+	writer.len = 0;
+	writer.alloc = SNAPSHOT_BUF_SIZE;
+	writer.buf = malloc(writer.alloc);
+	if (!writer.buf)
+		return -ENOMEM;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byte_order = SNAPSHOT_BYTE_ORDER;
+	header.long_size = sizeof(unsigned long);
+	header.nr_buckets = CMM_LOAD_SHARED(ht->size);
+
+	ht->flavor->read_lock();
+	cds_lfht_for_each_cursor(ht, &cursor, batch, node) {
+		ret = writer_add(&writer, &offset, node, serialize, priv);
+		if (ret)
+			break;
+		nr_nodes++;
+	}
+	ht->flavor->read_unlock();
+	if (!ret)
+		ret = writer_flush(&writer, &offset);
+	free(writer.buf);
+	if (ret)
+		return ret;
+
+	/* Written last: a partially written file is not a snapshot. */
+	header.nr_nodes = nr_nodes;
+	ret = write_all(fd, (const char *) &header, sizeof(header), 0);
+	if (ret)
+		return ret;
+	if (ftruncate(fd, offset))
+		return -errno;
+	return nr_nodes;
+}
+
+static
+int check_header(const struct snapshot_header *header)
+{
+	if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic))
+			|| header->version != SNAPSHOT_VERSION
+			|| header->byte_order != SNAPSHOT_BYTE_ORDER
+			|| header->long_size != sizeof(unsigned long))
+		return -EINVAL;
+	return 0;
+}
+
+long cds_lfht_snapshot_load(struct cds_lfht *ht, int fd,
+		cds_lfht_snapshot_deserialize_fct deserialize, void *priv)
+{
+	const struct snapshot_header *header;
+	struct snapshot_record record;
+	struct cds_lfht_bulk bulk;
+	struct cds_lfht_node *node;
+	size_t offset, map_len;
+	struct stat st;
+	uint64_t i;
+	long nr_nodes = 0;
+	char *map;
+	int ret;
+
+	if (fstat(fd, &st))
+		return -errno;
+	if ((uint64_t) st.st_size < sizeof(*header))
+		return -EINVAL;
+	map_len = st.st_size;
+	map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return -errno;
+	(void) madvise(map, map_len, MADV_SEQUENTIAL);
+	header = (const struct snapshot_header *) map;
+	ret = check_header(header);
+	if (ret)
+		goto end;
+
+	if (header->nr_buckets > CMM_LOAD_SHARED(ht->size))
+		cds_lfht_resize(ht, header->nr_buckets);
+
+	offset = sizeof(*header);
+	cds_lfht_bulk_begin(ht, &bulk);
+	for (i = 0; i < header->nr_nodes; i++) {
+		if (map_len - offset < sizeof(record)) {
+			ret = -EINVAL;
+			break;
+		}
+		memcpy(&record, map + offset, sizeof(record));
+		offset += sizeof(record);
+		if (map_len - offset < record.len) {
+			ret = -EINVAL;
+			break;
+		}
+		node = deserialize(record.hash, map + offset, record.len,
+				priv);
+		if (!node) {
+			ret = -ENOMEM;
+			break;
+		}
+		cds_lfht_bulk_add(ht, &bulk, record.hash, node);
+		nr_nodes++;
+		offset += min(snapshot_align(record.len), map_len - offset);
+	}
+	cds_lfht_bulk_end(ht, &bulk);
+end:
+	(void) munmap(map, map_len);
+	return ret ? ret : nr_nodes;
+}
@@ -279,6 +279,7 @@
 #include <signal.h>
 #include "workqueue.h"
 #include "urcu-die.h"
+#include "urcu-stats.h"
 
 /*
  * Split-counters lazily update the global counter each 1024
@@ -344,6 +345,8 @@ struct ht_items_count {
 struct resize_work {
 	struct urcu_work work;
 	struct cds_lfht *ht;
+	cds_lfht_resize_done_fct done;	/* NULL for lazy resize */
+	void *priv;
 };
 
 /*
@@ -370,6 +373,9 @@ static pthread_mutex_t cds_lfht_fork_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static struct urcu_atfork cds_lfht_atfork;
 
+/* Serializes starting the resize worker of tables without auto resize. */
+static pthread_mutex_t cds_lfht_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * atfork handler nesting counters. Handle being registered to many urcu
  * flavors, thus being possibly invoked more than once in the
@@ -578,6 +584,11 @@ int cds_lfht_get_count_order_ulong(unsigned long x)
 	return cds_lfht_fls_ulong(x - 1);
 }
 
+unsigned long cds_lfht_bit_reverse_ulong(unsigned long v)
+{
+	return bit_reverse_ulong(v);
+}
+
 static
 void cds_lfht_resize_lazy_grow(struct cds_lfht *ht, unsigned long size, int growth);
 
@@ -585,6 +596,9 @@ static
 void cds_lfht_resize_lazy_count(struct cds_lfht *ht, unsigned long size,
 				unsigned long count);
 
+static
+void cds_lfht_queue_bloom_rebuild(struct cds_lfht *ht);
+
 static void mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
@@ -705,6 +719,13 @@ void ht_count_add(struct cds_lfht *ht, unsigned long size, unsigned long hash)
 	dbg_printf("add split count %lu\n", split_count);
 	count = uatomic_add_return(&ht->count,
 				   1UL << COUNT_COMMIT_ORDER);
+	if (caa_unlikely(ht->stats))
+		CMM_STORE_SHARED(ht->stats->count, count < 0 ? 0 : count);
+	/* The table is used as reserved: shrink it normally from now on. */
+	if (caa_unlikely(CMM_LOAD_SHARED(ht->reserve_size))
+			&& (count >> (CHAIN_LEN_TARGET - 1))
+				>= CMM_LOAD_SHARED(ht->reserve_size))
+		CMM_STORE_SHARED(ht->reserve_size, 0);
 	if (caa_likely(count & (count - 1)))
 		return;
 	/* Only if global count is power of 2 */
@@ -734,6 +755,8 @@ void ht_count_del(struct cds_lfht *ht, unsigned long size, unsigned long hash)
 	dbg_printf("del split count %lu\n", split_count);
 	count = uatomic_add_return(&ht->count,
 				   -(1UL << COUNT_COMMIT_ORDER));
+	if (caa_unlikely(ht->stats))
+		CMM_STORE_SHARED(ht->stats->count, count < 0 ? 0 : count);
 	if (caa_likely(count & (count - 1)))
 		return;
 	/* Only if global count is power of 2 */
@@ -852,6 +875,44 @@ int is_end(struct cds_lfht_node *node)
 	return clear_flag(node) == (struct cds_lfht_node *) END_VALUE;
 }
 
+/*
+ * Set the bits of hash in the Bloom filters, before the node is linked.
+ * bloom_next is read first: cds_lfht_bloom_rebuild() publishes the new
+ * filter as bloom before clearing bloom_next, so a node is never only
+ * added to a filter about to be freed.
+ */
+static
+void bloom_add(struct cds_lfht *ht, unsigned long hash)
+{
+	struct cds_lfht_bloom *bloom, *bloom_next;
+
+	bloom_next = rcu_dereference(ht->bloom_next);
+	cmm_smp_rmb();
+	bloom = rcu_dereference(ht->bloom);
+	if (caa_likely(!bloom && !bloom_next))
+		return;
+	if (bloom)
+		cds_lfht_bloom_set(bloom, hash);
+	if (bloom_next && bloom_next != bloom)
+		cds_lfht_bloom_set(bloom_next, hash);
+}
+
+/*
+ * Count a removal from the Bloom filter, whose bits stay set. The
+ * removal reaching max_removed queues a rebuild, once per filter.
+ */
+static
+void bloom_del(struct cds_lfht *ht)
+{
+	struct cds_lfht_bloom *bloom;
+
+	bloom = rcu_dereference(ht->bloom);
+	if (caa_likely(!bloom))
+		return;
+	if (uatomic_add_return(&bloom->nr_removed, 1) == bloom->max_removed)
+		cds_lfht_queue_bloom_rebuild(ht);
+}
+
 static
 unsigned long _uatomic_xchg_monotonic_increase(unsigned long *ptr,
 		unsigned long v)
@@ -898,11 +959,38 @@ struct cds_lfht_node *lookup_bucket(struct cds_lfht *ht, unsigned long size,
 	return bucket_at(ht, hash & (size - 1));
 }
 
+/*
+ * Reverse hash of node, whose next pointer is next. Compact bucket nodes
+ * do not store it: it is derived from their index.
+ */
+static inline
+unsigned long node_reverse_hash(struct cds_lfht *ht, struct cds_lfht_node *node,
+		struct cds_lfht_node *next)
+{
+	if (caa_unlikely(is_bucket(next)) && ht->compact_buckets)
+		return bit_reverse_ulong((struct cds_lfht_compact_bucket *) node
+			- ht->tbl_mmap_compact);
+	return node->reverse_hash;
+}
+
+/*
+ * Set the reverse hash of the bucket node at index, unless compact.
+ */
+static inline
+void init_bucket_reverse_hash(struct cds_lfht *ht, struct cds_lfht_node *node,
+		unsigned long index)
+{
+	if (!ht->compact_buckets)
+		node->reverse_hash = bit_reverse_ulong(index);
+}
+
 /*
  * Remove all logically deleted nodes from a bucket up to a certain node key.
+ * reverse_hash is the reverse hash of node.
  */
 static
-void _cds_lfht_gc_bucket(struct cds_lfht_node *bucket, struct cds_lfht_node *node)
+void _cds_lfht_gc_bucket(struct cds_lfht *ht, struct cds_lfht_node *bucket,
+		struct cds_lfht_node *node, unsigned long reverse_hash)
 {
 	struct cds_lfht_node *iter_prev, *iter, *next, *new_next;
 
@@ -918,7 +1006,7 @@ void _cds_lfht_gc_bucket(struct cds_lfht_node *bucket, struct cds_lfht_node *nod
 		iter = rcu_dereference(iter_prev->next);
 		assert(!is_removed(iter));
 		assert(!is_removal_owner(iter));
-		assert(iter_prev->reverse_hash <= node->reverse_hash);
+		assert(node_reverse_hash(ht, iter_prev, iter) <= reverse_hash);
 		/*
 		 * We should never be called with bucket (start of chain)
 		 * and logically removed node (end of path compression
@@ -929,9 +1017,10 @@ void _cds_lfht_gc_bucket(struct cds_lfht_node *bucket, struct cds_lfht_node *nod
 		for (;;) {
 			if (caa_unlikely(is_end(iter)))
 				return;
-			if (caa_likely(clear_flag(iter)->reverse_hash > node->reverse_hash))
-				return;
 			next = rcu_dereference(clear_flag(iter)->next);
+			if (caa_likely(node_reverse_hash(ht, clear_flag(iter), next)
+					> reverse_hash))
+				return;
 			if (caa_likely(is_removed(next)))
 				break;
 			iter_prev = clear_flag(iter);
@@ -1011,7 +1100,7 @@ int _cds_lfht_replace(struct cds_lfht *ht, unsigned long size,
 	 * logically removed node) if found.
 	 */
 	bucket = lookup_bucket(ht, size, bit_reverse_ulong(old_node->reverse_hash));
-	_cds_lfht_gc_bucket(bucket, new_node);
+	_cds_lfht_gc_bucket(ht, bucket, new_node, new_node->reverse_hash);
 
 	assert(is_removed(CMM_LOAD_SHARED(old_node->next)));
 	return 0;
@@ -1034,10 +1123,13 @@ void _cds_lfht_add(struct cds_lfht *ht,
 	struct cds_lfht_node *iter_prev, *iter, *next, *new_node, *new_next,
 			*return_node;
 	struct cds_lfht_node *bucket;
+	unsigned long reverse_hash, prev_hash, iter_hash;
 
 	assert(!is_bucket(node));
 	assert(!is_removed(node));
 	assert(!is_removal_owner(node));
+	/* node may be a compact bucket node: do not read its reverse hash */
+	reverse_hash = bit_reverse_ulong(hash);
 	bucket = lookup_bucket(ht, size, hash);
 	for (;;) {
 		uint32_t chain_len = 0;
@@ -1047,27 +1139,29 @@ void _cds_lfht_add(struct cds_lfht *ht,
 		 * insert location.
 		 */
 		iter_prev = bucket;
+		prev_hash = bit_reverse_ulong(hash & (size - 1));
 		/* We can always skip the bucket node initially */
 		iter = rcu_dereference(iter_prev->next);
-		assert(iter_prev->reverse_hash <= node->reverse_hash);
+		assert(prev_hash <= reverse_hash);
 		for (;;) {
 			if (caa_unlikely(is_end(iter)))
 				goto insert;
-			if (caa_likely(clear_flag(iter)->reverse_hash > node->reverse_hash))
+			next = rcu_dereference(clear_flag(iter)->next);
+			iter_hash = node_reverse_hash(ht, clear_flag(iter), next);
+			if (caa_likely(iter_hash > reverse_hash))
 				goto insert;
 
 			/* bucket node is the first node of the identical-hash-value chain */
-			if (bucket_flag && clear_flag(iter)->reverse_hash == node->reverse_hash)
+			if (bucket_flag && iter_hash == reverse_hash)
 				goto insert;
 
-			next = rcu_dereference(clear_flag(iter)->next);
 			if (caa_unlikely(is_removed(next)))
 				goto gc_node;
 
 			/* uniquely add */
 			if (unique_ret
 			    && !is_bucket(next)
-			    && clear_flag(iter)->reverse_hash == node->reverse_hash) {
+			    && iter_hash == reverse_hash) {
 				struct cds_lfht_iter d_iter = { .node = node, .next = iter, };
 
 				/*
@@ -1088,10 +1182,11 @@ void _cds_lfht_add(struct cds_lfht *ht,
 			}
 
 			/* Only account for identical reverse hash once */
-			if (iter_prev->reverse_hash != clear_flag(iter)->reverse_hash
+			if (prev_hash != iter_hash
 			    && !is_bucket(next))
 				check_resize(ht, size, ++chain_len);
 			iter_prev = clear_flag(iter);
+			prev_hash = iter_hash;
 			iter = next;
 		}
 
@@ -1179,7 +1274,7 @@ int _cds_lfht_del(struct cds_lfht *ht, unsigned long size,
 	 * if found.
 	 */
 	bucket = lookup_bucket(ht, size, bit_reverse_ulong(node->reverse_hash));
-	_cds_lfht_gc_bucket(bucket, node);
+	_cds_lfht_gc_bucket(ht, bucket, node, node->reverse_hash);
 
 	assert(is_removed(CMM_LOAD_SHARED(node->next)));
 	/*
@@ -1307,7 +1402,7 @@ void init_table_populate_partition(struct cds_lfht *ht, unsigned long i,
 		assert(j >= size && j < (size << 1));
 		dbg_printf("init populate: order %lu index %lu hash %lu\n",
 			   i, j, j);
-		new_node->reverse_hash = bit_reverse_ulong(j);
+		init_bucket_reverse_hash(ht, new_node, j);
 		_cds_lfht_add(ht, j, NULL, NULL, size, new_node, NULL, 1);
 	}
 	ht->flavor->read_unlock();
@@ -1402,7 +1497,8 @@ void remove_table_partition(struct cds_lfht *ht, unsigned long i,
 			   i, j, j);
 		/* Set the REMOVED_FLAG to freeze the ->next for gc */
 		uatomic_or(&fini_bucket->next, REMOVED_FLAG);
-		_cds_lfht_gc_bucket(parent_bucket, fini_bucket);
+		_cds_lfht_gc_bucket(ht, parent_bucket, fini_bucket,
+				bit_reverse_ulong(j));
 	}
 	ht->flavor->read_unlock();
 }
@@ -1414,62 +1510,65 @@ void remove_table(struct cds_lfht *ht, unsigned long i, unsigned long len)
 }
 
 /*
- * fini_table() is never called for first_order == 0, which is why
- * free_by_rcu_order == 0 can be used as criterion to know if free must
- * be called.
+ * Shrink the table to 1UL << (first_order - 1) buckets, removing orders
+ * last_order down to first_order.
+ *
+ * Every order is covered by the same two grace periods: publishing the
+ * smallest size at once is equivalent to publishing each intermediate
+ * size, since the bucket nodes of all removed orders stay linked until
+ * the first grace period guarantees no add operation uses them as
+ * insert position anymore. The second grace period guarantees no reader
+ * still traverses the unlinked bucket nodes before their tables are
+ * freed. This keeps the resize worker from serializing one grace period
+ * per order while holding the resize mutex.
+ *
+ * fini_table() is never called for first_order == 0.
  */
 static
 void fini_table(struct cds_lfht *ht,
 		unsigned long first_order, unsigned long last_order)
 {
+	unsigned long target;
 	long i;
-	unsigned long free_by_rcu_order = 0;
 
 	dbg_printf("fini table: first_order %lu last_order %lu\n",
 		   first_order, last_order);
 	assert(first_order > MIN_TABLE_ORDER);
-	for (i = last_order; i >= first_order; i--) {
-		unsigned long len;
-
-		len = 1UL << (i - 1);
-		dbg_printf("fini order %ld len: %lu\n", i, len);
-
-		/* Stop shrink if the resize target changes under us */
-		if (CMM_LOAD_SHARED(ht->resize_target) > (1UL << (i - 1)))
-			break;
 
-		cmm_smp_wmb();	/* populate data before RCU size */
-		CMM_STORE_SHARED(ht->size, 1UL << (i - 1));
-
-		/*
-		 * We need to wait for all add operations to reach Q.S. (and
-		 * thus use the new table for lookups) before we can start
-		 * releasing the old bucket nodes. Otherwise their lookup will
-		 * return a logically removed node as insert position.
-		 */
-		ht->flavor->update_synchronize_rcu();
-		if (free_by_rcu_order)
-			cds_lfht_free_bucket_table(ht, free_by_rcu_order);
+	/* Stop shrink where the resize target changed under us */
+	target = CMM_LOAD_SHARED(ht->resize_target);
+	while (first_order <= last_order && target > (1UL << (first_order - 1)))
+		first_order++;
+	if (first_order > last_order || CMM_LOAD_SHARED(ht->in_progress_destroy))
+		return;
 
-		/*
-		 * Set "removed" flag in bucket nodes about to be removed.
-		 * Unlink all now-logically-removed bucket node pointers.
-		 * Concurrent add/remove operation are helping us doing
-		 * the gc.
-		 */
-		remove_table(ht, i, len);
+	cmm_smp_wmb();	/* populate data before RCU size */
+	CMM_STORE_SHARED(ht->size, 1UL << (first_order - 1));
+	dbg_printf("fini new size: %lu\n", 1UL << (first_order - 1));
 
-		free_by_rcu_order = i;
+	/*
+	 * We need to wait for all add operations to reach Q.S. (and
+	 * thus use the new table for lookups) before we can start
+	 * releasing the old bucket nodes. Otherwise their lookup will
+	 * return a logically removed node as insert position.
+	 */
+	ht->flavor->update_synchronize_rcu();
 
-		dbg_printf("fini new size: %lu\n", 1UL << i);
-		if (CMM_LOAD_SHARED(ht->in_progress_destroy))
-			break;
+	/*
+	 * Set "removed" flag in bucket nodes about to be removed.
+	 * Unlink all now-logically-removed bucket node pointers.
+	 * Concurrent add/remove operation are helping us doing
+	 * the gc. Higher orders first, so the parent bucket of each
+	 * removed bucket is still linked.
+	 */
+	for (i = last_order; i >= (long) first_order; i--) {
+		dbg_printf("fini order %ld len: %lu\n", i, 1UL << (i - 1));
+		remove_table(ht, i, 1UL << (i - 1));
 	}
 
-	if (free_by_rcu_order) {
-		ht->flavor->update_synchronize_rcu();
-		cds_lfht_free_bucket_table(ht, free_by_rcu_order);
-	}
+	ht->flavor->update_synchronize_rcu();
+	for (i = last_order; i >= (long) first_order; i--)
+		cds_lfht_free_bucket_table(ht, i);
 }
 
 static
@@ -1483,7 +1582,7 @@ void cds_lfht_create_bucket(struct cds_lfht *ht, unsigned long size)
 	dbg_printf("create bucket: order 0 index 0 hash 0\n");
 	node = bucket_at(ht, 0);
 	node->next = flag_bucket(get_end());
-	node->reverse_hash = 0;
+	init_bucket_reverse_hash(ht, node, 0);
 
 	for (order = 1; order < cds_lfht_get_count_order_ulong(size) + 1; order++) {
 		len = 1UL << (order - 1);
@@ -1506,7 +1605,7 @@ void cds_lfht_create_bucket(struct cds_lfht *ht, unsigned long size)
 
 			dbg_printf("create bucket: order %lu index %lu hash %lu\n",
 				   order, len + i, len + i);
-			node->reverse_hash = bit_reverse_ulong(len + i);
+			init_bucket_reverse_hash(ht, node, len + i);
 
 			/* insert after prev */
 			assert(is_bucket(prev->next));
@@ -1590,6 +1689,14 @@ struct cds_lfht *_cds_lfht_new(unsigned long init_size,
 	ht->resize_target = 1UL << order;
 	cds_lfht_create_bucket(ht, 1UL << order);
 	ht->size = 1UL << order;
+	ht->stats = urcu_stats_lfht_alloc();
+	if (ht->stats) {
+		ht->stats->flags = flags;
+		ht->stats->size = ht->size;
+		ht->stats->resize_target = ht->resize_target;
+		ht->stats->min_nr_alloc_buckets = ht->min_nr_alloc_buckets;
+		ht->stats->max_nr_buckets = ht->max_nr_buckets;
+	}
 	return ht;
 }
 
@@ -1598,8 +1705,14 @@ void cds_lfht_lookup(struct cds_lfht *ht, unsigned long hash,
 		struct cds_lfht_iter *iter)
 {
 	struct cds_lfht_node *node, *next, *bucket;
+	struct cds_lfht_bloom *bloom;
 	unsigned long reverse_hash, size;
 
+	bloom = rcu_dereference(ht->bloom);
+	if (bloom && !cds_lfht_bloom_test(bloom, hash)) {
+		iter->node = iter->next = NULL;
+		return;
+	}
 	reverse_hash = bit_reverse_ulong(hash);
 
 	size = rcu_dereference(ht->size);
@@ -1612,11 +1725,11 @@ void cds_lfht_lookup(struct cds_lfht *ht, unsigned long hash,
 			node = next = NULL;
 			break;
 		}
-		if (caa_unlikely(node->reverse_hash > reverse_hash)) {
+		next = rcu_dereference(node->next);
+		if (caa_unlikely(node_reverse_hash(ht, node, next) > reverse_hash)) {
 			node = next = NULL;
 			break;
 		}
-		next = rcu_dereference(node->next);
 		assert(node == clear_flag(node));
 		if (caa_likely(!is_removed(next))
 		    && !is_bucket(next)
@@ -1647,11 +1760,11 @@ void cds_lfht_next_duplicate(struct cds_lfht *ht, cds_lfht_match_fct match,
 			node = next = NULL;
 			break;
 		}
-		if (caa_unlikely(node->reverse_hash > reverse_hash)) {
+		next = rcu_dereference(node->next);
+		if (caa_unlikely(node_reverse_hash(ht, node, next) > reverse_hash)) {
 			node = next = NULL;
 			break;
 		}
-		next = rcu_dereference(node->next);
 		if (caa_likely(!is_removed(next))
 		    && !is_bucket(next)
 		    && caa_likely(match(node, key))) {
@@ -1696,12 +1809,75 @@ void cds_lfht_first(struct cds_lfht *ht, struct cds_lfht_iter *iter)
 	cds_lfht_next(ht, iter);
 }
 
+void cds_lfht_cursor_first(struct cds_lfht *ht,
+		struct cds_lfht_cursor *cursor, unsigned long batch)
+{
+	cursor->batch = batch;
+	cursor->count = 0;
+	cds_lfht_first(ht, &cursor->iter);
+}
+
+/*
+ * Position iter on the first node following reverse_hash. The bucket
+ * node of reverse_hash precedes it in the list for any table size.
+ */
+static
+void cds_lfht_cursor_seek(struct cds_lfht *ht, struct cds_lfht_iter *iter,
+		unsigned long reverse_hash)
+{
+	struct cds_lfht_node *node, *next, *bucket;
+	unsigned long size;
+
+	size = rcu_dereference(ht->size);
+	bucket = lookup_bucket(ht, size, bit_reverse_ulong(reverse_hash));
+	/* We can always skip the bucket node initially */
+	node = clear_flag(rcu_dereference(bucket->next));
+	for (;;) {
+		if (caa_unlikely(is_end(node))) {
+			node = next = NULL;
+			break;
+		}
+		next = rcu_dereference(node->next);
+		if (caa_likely(!is_removed(next))
+		    && !is_bucket(next)
+		    && node->reverse_hash > reverse_hash)
+			break;
+		node = clear_flag(next);
+	}
+	assert(!node || !is_bucket(CMM_LOAD_SHARED(node->next)));
+	iter->node = node;
+	iter->next = next;
+}
+
+void cds_lfht_cursor_next(struct cds_lfht *ht, struct cds_lfht_cursor *cursor)
+{
+	unsigned long reverse_hash;
+
+	reverse_hash = cursor->iter.node->reverse_hash;
+	cds_lfht_next(ht, &cursor->iter);
+	if (!cursor->batch || ++cursor->count < cursor->batch)
+		return;
+	/*
+	 * Resuming after reverse_hash would skip the following nodes
+	 * with the same hash value: yield after the last of them.
+	 */
+	if (!cursor->iter.node
+	    || cursor->iter.node->reverse_hash == reverse_hash)
+		return;
+	cursor->count = 0;
+	ht->flavor->read_unlock();
+	ht->flavor->read_quiescent_state();
+	ht->flavor->read_lock();
+	cds_lfht_cursor_seek(ht, &cursor->iter, reverse_hash);
+}
+
 void cds_lfht_add(struct cds_lfht *ht, unsigned long hash,
 		struct cds_lfht_node *node)
 {
 	unsigned long size;
 
 	node->reverse_hash = bit_reverse_ulong(hash);
+	bloom_add(ht, hash);
 	size = rcu_dereference(ht->size);
 	_cds_lfht_add(ht, hash, NULL, NULL, size, node, NULL, 0);
 	ht_count_add(ht, size, hash);
@@ -1717,6 +1893,7 @@ struct cds_lfht_node *cds_lfht_add_unique(struct cds_lfht *ht,
 	struct cds_lfht_iter iter;
 
 	node->reverse_hash = bit_reverse_ulong(hash);
+	bloom_add(ht, hash);
 	size = rcu_dereference(ht->size);
 	_cds_lfht_add(ht, hash, match, key, size, node, &iter, 0);
 	if (iter.node == node)
@@ -1734,6 +1911,7 @@ struct cds_lfht_node *cds_lfht_add_replace(struct cds_lfht *ht,
 	struct cds_lfht_iter iter;
 
 	node->reverse_hash = bit_reverse_ulong(hash);
+	bloom_add(ht, hash);
 	size = rcu_dereference(ht->size);
 	for (;;) {
 		_cds_lfht_add(ht, hash, match, key, size, node, &iter, 0);
@@ -1763,6 +1941,7 @@ int cds_lfht_replace(struct cds_lfht *ht,
 		return -EINVAL;
 	if (caa_unlikely(!match(old_iter->node, key)))
 		return -EINVAL;
+	bloom_add(ht, hash);
 	size = rcu_dereference(ht->size);
 	return _cds_lfht_replace(ht, size, old_iter->node, old_iter->next,
 			new_node);
@@ -1780,6 +1959,7 @@ int cds_lfht_del(struct cds_lfht *ht, struct cds_lfht_node *node)
 
 		hash = bit_reverse_ulong(node->reverse_hash);
 		ht_count_del(ht, size, hash);
+		bloom_del(ht);
 	}
 	return ret;
 }
@@ -1789,6 +1969,63 @@ int cds_lfht_is_node_deleted(struct cds_lfht_node *node)
 	return is_removed(CMM_LOAD_SHARED(node->next));
 }
 
+void cds_lfht_bulk_begin(struct cds_lfht *ht, struct cds_lfht_bulk *bulk)
+{
+	mutex_lock(&ht->resize_mutex);
+	bulk->size = ht->size;
+	bulk->prev = bucket_at(ht, 0);
+	bulk->prev_hash = 0;
+}
+
+/*
+ * Link node right after the last node preceding it in the list. When
+ * nodes are added in increasing reverse hash order, the insert position
+ * only moves forward, so that loading n nodes walks the list once
+ * instead of walking one chain per node. The split-ordered list gives
+ * the bucket node of each hash its place among them, so the walk can
+ * also jump ahead to the bucket of the node.
+ */
+void cds_lfht_bulk_add(struct cds_lfht *ht, struct cds_lfht_bulk *bulk,
+		unsigned long hash, struct cds_lfht_node *node)
+{
+	struct cds_lfht_node *iter, *next;
+	unsigned long reverse_hash, bucket_hash, iter_hash;
+
+	reverse_hash = bit_reverse_ulong(hash);
+	node->reverse_hash = reverse_hash;
+	bucket_hash = bit_reverse_ulong(hash & (bulk->size - 1));
+	if (bulk->prev_hash > reverse_hash || bulk->prev_hash < bucket_hash) {
+		/* Out of order node, or its bucket lies ahead: restart there. */
+		bulk->prev = lookup_bucket(ht, bulk->size, hash);
+		bulk->prev_hash = bucket_hash;
+	}
+	for (;;) {
+		iter = bulk->prev->next;
+		if (is_end(iter))
+			break;
+		next = clear_flag(iter)->next;
+		/* Updaters are excluded: no node is logically removed. */
+		assert(!is_removed(next));
+		iter_hash = node_reverse_hash(ht, clear_flag(iter), next);
+		if (iter_hash > reverse_hash)
+			break;
+		bulk->prev = clear_flag(iter);
+		bulk->prev_hash = iter_hash;
+	}
+	node->next = clear_flag(iter);
+	bloom_add(ht, hash);
+	rcu_assign_pointer(bulk->prev->next,
+			is_bucket(iter) ? flag_bucket(node) : node);
+	bulk->prev = node;
+	bulk->prev_hash = reverse_hash;
+	ht_count_add(ht, bulk->size, hash);
+}
+
+void cds_lfht_bulk_end(struct cds_lfht *ht, struct cds_lfht_bulk *bulk)
+{
+	mutex_unlock(&ht->resize_mutex);
+}
+
 static
 int cds_lfht_delete_bucket(struct cds_lfht *ht)
 {
@@ -1813,7 +2050,8 @@ int cds_lfht_delete_bucket(struct cds_lfht *ht)
 	for (i = 0; i < size; i++) {
 		node = bucket_at(ht, i);
 		dbg_printf("delete bucket: index %lu expected hash %lu hash %lu\n",
-			i, i, bit_reverse_ulong(node->reverse_hash));
+			i, i, bit_reverse_ulong(node_reverse_hash(ht, node,
+				node->next)));
 		assert(is_bucket(node->next));
 	}
 
@@ -1831,23 +2069,32 @@ int cds_lfht_destroy(struct cds_lfht *ht, pthread_attr_t **attr)
 {
 	int ret;
 
-	if (ht->flags & CDS_LFHT_AUTO_RESIZE) {
-		/* Cancel ongoing resize operations. */
-		_CMM_STORE_SHARED(ht->in_progress_destroy, 1);
+	/* Cancel ongoing resize operations, refuse new ones. */
+	CMM_STORE_SHARED(ht->in_progress_destroy, 1);
+	cmm_smp_mb();
+	if ((ht->flags & CDS_LFHT_AUTO_RESIZE) || ht->async_worker
+			|| ht->bloom_worker) {
 		/* Wait for in-flight resize operations to complete */
 		urcu_workqueue_flush_queued_work(cds_lfht_workqueue);
 	}
 	ret = cds_lfht_delete_bucket(ht);
-	if (ret)
+	if (ret) {
+		/* The table is not empty, and stays usable. */
+		CMM_STORE_SHARED(ht->in_progress_destroy, 0);
 		return ret;
+	}
 	free_split_items_count(ht);
+	cds_lfht_bloom_free(ht->bloom);
 	if (attr)
 		*attr = ht->resize_attr;
 	ret = pthread_mutex_destroy(&ht->resize_mutex);
 	if (ret)
 		ret = -EBUSY;
-	if (ht->flags & CDS_LFHT_AUTO_RESIZE)
+	if ((ht->flags & CDS_LFHT_AUTO_RESIZE) || ht->async_worker)
+		cds_lfht_fini_worker(ht->flavor);
+	if (ht->bloom_worker)
 		cds_lfht_fini_worker(ht->flavor);
+	urcu_stats_lfht_free(ht->stats);
 	poison_free(ht);
 	return ret;
 }
@@ -1900,6 +2147,18 @@ void cds_lfht_count_nodes(struct cds_lfht *ht,
 	}
 }
 
+void cds_lfht_get_buckets(struct cds_lfht *ht,
+		unsigned long *nr_buckets,
+		unsigned long *nr_alloc_buckets,
+		size_t *bucket_node_size)
+{
+	*nr_buckets = CMM_LOAD_SHARED(ht->size);
+	*nr_alloc_buckets = max(*nr_buckets, ht->min_nr_alloc_buckets);
+	*bucket_node_size = ht->compact_buckets ?
+		sizeof(struct cds_lfht_compact_bucket) :
+		sizeof(struct cds_lfht_node);
+}
+
 /* called with resize mutex held */
 static
 void _do_cds_lfht_grow(struct cds_lfht *ht,
@@ -1938,7 +2197,11 @@ void _do_cds_lfht_shrink(struct cds_lfht *ht,
 static
 void _do_cds_lfht_resize(struct cds_lfht *ht)
 {
-	unsigned long new_size, old_size;
+	unsigned long new_size, old_size, start_size = ht->size;
+	uint64_t start = 0;
+
+	if (caa_unlikely(ht->stats))
+		start = urcu_stats_now();
 
 	/*
 	 * Resize table, re-do if the target size has changed under us.
@@ -1957,6 +2220,20 @@ void _do_cds_lfht_resize(struct cds_lfht *ht)
 		/* write resize_initiated before read resize_target */
 		cmm_smp_mb();
 	} while (ht->size != CMM_LOAD_SHARED(ht->resize_target));
+
+	if (ht->size != start_size && ht->bloom_bits_per_node
+			&& !CMM_LOAD_SHARED(ht->in_progress_destroy))
+		(void) cds_lfht_bloom_rebuild(ht);
+
+	if (caa_unlikely(ht->stats) && ht->size != start_size) {
+		uint64_t duration = urcu_stats_now() - start;
+
+		CMM_STORE_SHARED(ht->stats->size, ht->size);
+		CMM_STORE_SHARED(ht->stats->resize_target, ht->resize_target);
+		CMM_STORE_SHARED(ht->stats->resize_last_ns, duration);
+		urcu_stats_add(ht->stats->resize_total_ns, duration);
+		urcu_stats_add(ht->stats->nr_resize, 1);
+	}
 }
 
 static
@@ -1994,10 +2271,161 @@ void do_resize_cb(struct urcu_work *work)
 	mutex_lock(&ht->resize_mutex);
 	_do_cds_lfht_resize(ht);
 	mutex_unlock(&ht->resize_mutex);
+	if (resize_work->done)
+		resize_work->done(ht, CMM_LOAD_SHARED(ht->size),
+			resize_work->priv);
 	ht->flavor->unregister_thread();
 	poison_free(work);
 }
 
+/*
+ * Tables created without CDS_LFHT_AUTO_RESIZE hold a reference on the
+ * resize worker from their first asynchronous resize on.
+ */
+static
+void cds_lfht_async_init_worker(struct cds_lfht *ht)
+{
+	if ((ht->flags & CDS_LFHT_AUTO_RESIZE)
+			|| CMM_LOAD_SHARED(ht->async_worker)) {
+		/* Read async_worker before cds_lfht_workqueue. */
+		cmm_smp_rmb();
+		return;
+	}
+	mutex_lock(&cds_lfht_async_mutex);
+	if (!ht->async_worker) {
+		cds_lfht_init_worker(ht->flavor);
+		/* Write cds_lfht_workqueue before async_worker. */
+		cmm_smp_wmb();
+		CMM_STORE_SHARED(ht->async_worker, 1);
+	}
+	mutex_unlock(&cds_lfht_async_mutex);
+}
+
+static
+int cds_lfht_queue_resize(struct cds_lfht *ht, cds_lfht_resize_done_fct done,
+		void *priv)
+{
+	struct resize_work *work;
+
+	/* Store resize_target before read in_progress_destroy. */
+	cmm_smp_mb();
+	if (CMM_LOAD_SHARED(ht->in_progress_destroy))
+		return -EBUSY;
+	work = malloc(sizeof(*work));
+	if (!work)
+		return -ENOMEM;
+	work->ht = ht;
+	work->done = done;
+	work->priv = priv;
+	cds_lfht_async_init_worker(ht);
+	if (caa_unlikely(ht->stats))
+		CMM_STORE_SHARED(ht->stats->resize_target,
+			CMM_LOAD_SHARED(ht->resize_target));
+	urcu_workqueue_queue_work(cds_lfht_workqueue, &work->work,
+		do_resize_cb);
+	CMM_STORE_SHARED(ht->resize_initiated, 1);
+	return 0;
+}
+
+static
+void do_bloom_rebuild_cb(struct urcu_work *work)
+{
+	struct resize_work *resize_work =
+		caa_container_of(work, struct resize_work, work);
+	struct cds_lfht *ht = resize_work->ht;
+
+	ht->flavor->register_thread();
+	mutex_lock(&ht->resize_mutex);
+	/* Skip if the filter was disabled or rebuilt by a resize since. */
+	if (ht->bloom && !CMM_LOAD_SHARED(ht->in_progress_destroy)
+			&& uatomic_read(&ht->bloom->nr_removed)
+				>= ht->bloom->max_removed)
+		(void) cds_lfht_bloom_rebuild(ht);
+	mutex_unlock(&ht->resize_mutex);
+	ht->flavor->unregister_thread();
+	poison_free(work);
+}
+
+/*
+ * Rebuild the Bloom filter from the resize worker. On allocation
+ * failure, the filter is rebuilt at the next resize instead.
+ */
+static
+void cds_lfht_queue_bloom_rebuild(struct cds_lfht *ht)
+{
+	struct resize_work *work;
+
+	if (CMM_LOAD_SHARED(ht->in_progress_destroy))
+		return;
+	work = malloc(sizeof(*work));
+	if (!work)
+		return;
+	work->ht = ht;
+	work->done = NULL;
+	work->priv = NULL;
+	/*
+	 * The worker is held by cds_lfht_bloom_enable(). Read ht->bloom
+	 * before cds_lfht_workqueue, see cds_lfht_bloom_get_worker().
+	 */
+	cmm_smp_rmb();
+	urcu_workqueue_queue_work(cds_lfht_workqueue, &work->work,
+		do_bloom_rebuild_cb);
+}
+
+/*
+ * Hold the resize worker while the table has a Bloom filter, so that
+ * cds_lfht_del() only queues rebuilds. Called with resize_mutex held,
+ * before the filter is published with rcu_assign_pointer(), which
+ * orders the cds_lfht_workqueue store before it.
+ */
+void cds_lfht_bloom_get_worker(struct cds_lfht *ht)
+{
+	if ((ht->flags & CDS_LFHT_AUTO_RESIZE) || ht->bloom_worker)
+		return;
+	cds_lfht_init_worker(ht->flavor);
+	ht->bloom_worker = 1;
+}
+
+/*
+ * Release the worker held by cds_lfht_bloom_get_worker(), once the
+ * filter is unpublished and a grace period has elapsed: no removal can
+ * queue a rebuild anymore. Called without resize_mutex held, which
+ * queued rebuilds take.
+ */
+void cds_lfht_bloom_put_worker(struct cds_lfht *ht)
+{
+	urcu_workqueue_flush_queued_work(cds_lfht_workqueue);
+	cds_lfht_fini_worker(ht->flavor);
+}
+
+int cds_lfht_resize_async(struct cds_lfht *ht, unsigned long new_size,
+		cds_lfht_resize_done_fct done, void *priv)
+{
+	new_size = max(new_size, MIN_TABLE_SIZE);
+	new_size = 1UL << cds_lfht_get_count_order_ulong(new_size);
+	resize_target_update_count(ht, new_size);
+	return cds_lfht_queue_resize(ht, done, priv);
+}
+
+int cds_lfht_reserve(struct cds_lfht *ht, unsigned long nr_nodes)
+{
+	unsigned long size;
+
+	if (!nr_nodes) {
+		CMM_STORE_SHARED(ht->reserve_size, 0);
+		return 0;
+	}
+	size = max(nr_nodes >> (CHAIN_LEN_TARGET - 1), MIN_TABLE_SIZE);
+	size = 1UL << cds_lfht_get_count_order_ulong(size);
+	size = min(size, ht->max_nr_buckets);
+	CMM_STORE_SHARED(ht->reserve_size, size);
+	/* Store reserve_size before growing resize_target. */
+	cmm_smp_mb();
+	if (resize_target_grow(ht, size) >= size)
+		return 0;
+	return cds_lfht_queue_resize(ht, NULL, NULL);
+}
+
 static
 void __cds_lfht_resize_lazy_launch(struct cds_lfht *ht)
 {
@@ -2015,6 +2443,11 @@ void __cds_lfht_resize_lazy_launch(struct cds_lfht *ht)
 			return;
 		}
 		work->ht = ht;
+		work->done = NULL;
+		work->priv = NULL;
+		if (caa_unlikely(ht->stats))
+			CMM_STORE_SHARED(ht->stats->resize_target,
+				CMM_LOAD_SHARED(ht->resize_target));
 		urcu_workqueue_queue_work(cds_lfht_workqueue,
 			&work->work, do_resize_cb);
 		CMM_STORE_SHARED(ht->resize_initiated, 1);
@@ -2046,6 +2479,8 @@ void cds_lfht_resize_lazy_count(struct cds_lfht *ht, unsigned long size,
 		return;
 	count = max(count, MIN_TABLE_SIZE);
 	count = min(count, ht->max_nr_buckets);
+	if (count < size)	/* do not shrink below a reservation */
+		count = max(count, CMM_LOAD_SHARED(ht->reserve_size));
 	if (count == size)
 		return;		/* Already the right size, no resize needed */
 	if (count > size) {	/* lazy grow */
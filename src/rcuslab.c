@@ -0,0 +1,498 @@
+/*
+ * rcuslab.c
+ *
+ * Userspace RCU library - RCU-aware slab allocator
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Each slab cache keeps, for each thread using it, two magazines:
+ *
+ * - the "loaded" magazine, from which objects are allocated, and into
+ *   which objects are immediately recycled by cds_slab_free() for
+ *   CDS_SLAB_TYPESAFE_BY_RCU caches,
+ * - the "pending" magazine, which gathers objects released by
+ *   cds_slab_free_rcu(). When it is full, the whole magazine is handed
+ *   to call_rcu. After the grace period, the call_rcu worker pushes it
+ *   onto the depot of the CPU which filled it.
+ *
+ * When the loaded magazine is exhausted, a full magazine is taken from
+ * the local CPU depot, then from the other depots, and only then are
+ * new objects carved out of a slab under the cache mutex. Depots are
+ * cds_lfs stacks: pushes are lock-free, and pops take the pop mutex of
+ * the stack, which cds_lfs_pop_blocking() needs against ABA. The
+ * call_rcu worker only pushes, so it never waits for allocating
+ * threads, which only contend with each other on the pop mutexes.
+ *
+ * Objects are carved out of slabs, so they cannot be handed back to
+ * malloc one by one. If a free cannot allocate the thread state or the
+ * magazine it needs, the object is dropped: it is never reallocated,
+ * and its memory is released with its slab by cds_slab_cache_destroy().
+ */
+
+#define _LGPL_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <urcu/arch.h>
+#include <urcu/compiler.h>
+#include <urcu/uatomic.h>
+#include <urcu/list.h>
+#include <urcu-pointer.h>
+#include <urcu-call-rcu.h>
+#include <urcu-flavor.h>
+#include <urcu/rcuslab.h>
+#include <urcu/lfstack.h>
+
+#include "compat-getcpu.h"
+#include "urcu-die.h"
+
+/* Number of objects held by a magazine. */
+#define SLAB_MAGAZINE_SIZE	64
+/* Minimum slab size, in bytes. */
+#define SLAB_MIN_BYTES		16384
+
+#ifndef max
+#define max(a, b)	((a) > (b) ? (a) : (b))
+#endif
+
+struct slab_magazine {
+	struct cds_lfs_node node;	/* depot or empty stack linkage */
+	struct rcu_head head;		/* grace period before reuse */
+	struct cds_slab_cache *cache;
+	int cpu;			/* depot to return to */
+	unsigned int nr;		/* number of objects in objs[] */
+	void *objs[SLAB_MAGAZINE_SIZE];
+};
+
+/* Per-CPU depot of full magazines. */
+struct slab_depot {
+	struct cds_lfs_stack full;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+/* Per-thread state. */
+struct slab_thread {
+	struct slab_magazine *loaded;
+	struct slab_magazine *pending;
+	struct cds_slab_cache *cache;
+	struct cds_list_head list;	/* cache->threads */
+};
+
+/* Slab header, followed by the objects. */
+struct slab {
+	struct slab *next;
+};
+
+struct cds_slab_cache {
+	size_t size;			/* object size, rounded to align */
+	size_t align;
+	int flags;
+	void (*ctor)(void *obj);
+	const struct rcu_flavor_struct *flavor;
+
+	pthread_key_t key;		/* struct slab_thread */
+	unsigned long nr_depots;	/* power of two */
+	struct slab_depot *depots;
+	struct cds_lfs_stack empty;	/* empty magazines */
+
+	/* Protected by lock. */
+	pthread_mutex_t lock;
+	struct cds_list_head threads;
+	struct slab *slabs;
+	char *slab_cur, *slab_end;	/* carving position in slabs */
+	size_t slab_bytes;
+	unsigned long nr_slabs;
+};
+
+static
+void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static
+struct slab_depot *local_depot(struct cds_slab_cache *cache, int *cpup)
+{
+	int cpu;
+
+	cpu = urcu_sched_getcpu();
+	if (caa_unlikely(cpu < 0))
+		cpu = 0;
+	cpu &= cache->nr_depots - 1;
+	if (cpup)
+		*cpup = cpu;
+	return &cache->depots[cpu];
+}
+
+/* Return NULL if no magazine can be allocated. */
+static
+struct slab_magazine *get_empty_magazine(struct cds_slab_cache *cache)
+{
+	struct cds_lfs_node *snode;
+	struct slab_magazine *mag;
+
+	snode = cds_lfs_pop_blocking(&cache->empty);
+	if (snode) {
+		mag = caa_container_of(snode, struct slab_magazine, node);
+	} else {
+		mag = malloc(sizeof(*mag));
+		if (!mag)
+			return NULL;
+		cds_lfs_node_init(&mag->node);
+		mag->cache = cache;
+	}
+	mag->nr = 0;
+	return mag;
+}
+
+static
+void put_empty_magazine(struct cds_slab_cache *cache,
+		struct slab_magazine *mag)
+{
+	(void) cds_lfs_push(&cache->empty, &mag->node);
+}
+
+static
+void push_full_magazine(struct cds_slab_cache *cache,
+		struct slab_magazine *mag, int cpu)
+{
+	(void) cds_lfs_push(&cache->depots[cpu].full, &mag->node);
+}
+
+/*
+ * Take a full magazine from the local depot, or steal one from another
+ * CPU depot. Return NULL if all depots are empty.
+ */
+static
+struct slab_magazine *get_full_magazine(struct cds_slab_cache *cache)
+{
+	struct cds_lfs_node *snode;
+	unsigned long i;
+	int cpu;
+
+	snode = cds_lfs_pop_blocking(&local_depot(cache, &cpu)->full);
+	for (i = 1; !snode && i < cache->nr_depots; i++) {
+		snode = cds_lfs_pop_blocking(&cache->depots[(cpu + i)
+				& (cache->nr_depots - 1)].full);
+	}
+	if (!snode)
+		return NULL;
+	return caa_container_of(snode, struct slab_magazine, node);
+}
+
+/*
+ * Fill @mag with objects carved out of slabs. Return 0 on success,
+ * -ENOMEM if no object at all could be allocated.
+ */
+static
+int refill_magazine(struct cds_slab_cache *cache, struct slab_magazine *mag)
+{
+	mutex_lock(&cache->lock);
+	while (mag->nr < SLAB_MAGAZINE_SIZE) {
+		void *obj;
+
+		if (cache->slab_cur + cache->size > cache->slab_end) {
+			struct slab *slab;
+			size_t hdr;
+
+			if (posix_memalign((void **) &slab, cache->align,
+					cache->slab_bytes))
+				break;
+			slab->next = cache->slabs;
+			cache->slabs = slab;
+			cache->nr_slabs++;
+			hdr = (sizeof(*slab) + cache->align - 1)
+				& ~(cache->align - 1);
+			cache->slab_cur = (char *) slab + hdr;
+			cache->slab_end = (char *) slab + cache->slab_bytes;
+		}
+		obj = cache->slab_cur;
+		cache->slab_cur += cache->size;
+		if (cache->ctor)
+			cache->ctor(obj);
+		mag->objs[mag->nr++] = obj;
+	}
+	mutex_unlock(&cache->lock);
+	return mag->nr ? 0 : -ENOMEM;
+}
+
+static
+struct slab_thread *thread_state(struct cds_slab_cache *cache)
+{
+	struct slab_thread *st;
+
+	st = pthread_getspecific(cache->key);
+	if (caa_likely(st))
+		return st;
+
+	st = malloc(sizeof(*st));
+	if (!st)
+		return NULL;
+	st->cache = cache;
+	st->loaded = get_empty_magazine(cache);
+	if (!st->loaded)
+		goto error_free;
+	st->pending = get_empty_magazine(cache);
+	if (!st->pending)
+		goto error_loaded;
+	mutex_lock(&cache->lock);
+	cds_list_add(&st->list, &cache->threads);
+	mutex_unlock(&cache->lock);
+	if (pthread_setspecific(cache->key, st)) {
+		mutex_lock(&cache->lock);
+		cds_list_del(&st->list);
+		mutex_unlock(&cache->lock);
+		put_empty_magazine(cache, st->pending);
+		goto error_loaded;
+	}
+	return st;
+
+error_loaded:
+	put_empty_magazine(cache, st->loaded);
+error_free:
+	free(st);
+	return NULL;
+}
+
+/*
+ * Called on thread exit. Give the magazines of the exiting thread back
+ * to the depots so other threads can use the objects. Objects awaiting
+ * a grace period in a partially filled magazine are waited for
+ * synchronously, since the exiting thread may not be allowed to use
+ * call_rcu anymore.
+ */
+static
+void thread_exit(void *arg)
+{
+	struct slab_thread *st = arg;
+	struct cds_slab_cache *cache = st->cache;
+	int cpu;
+
+	(void) local_depot(cache, &cpu);
+	if (st->loaded->nr)
+		push_full_magazine(cache, st->loaded, cpu);
+	else
+		put_empty_magazine(cache, st->loaded);
+	/* pending is NULL if no magazine could replace the last one. */
+	if (st->pending && st->pending->nr) {
+		cache->flavor->update_synchronize_rcu();
+		push_full_magazine(cache, st->pending, cpu);
+	} else if (st->pending) {
+		put_empty_magazine(cache, st->pending);
+	}
+	mutex_lock(&cache->lock);
+	cds_list_del(&st->list);
+	mutex_unlock(&cache->lock);
+	free(st);
+}
+
+static
+void magazine_reclaim_cb(struct rcu_head *head)
+{
+	struct slab_magazine *mag =
+		caa_container_of(head, struct slab_magazine, head);
+
+	push_full_magazine(mag->cache, mag, mag->cpu);
+}
+
+struct cds_slab_cache *_cds_slab_cache_create(size_t size, size_t align,
+			int flags, void (*ctor)(void *obj),
+			const struct rcu_flavor_struct *flavor)
+{
+	struct cds_slab_cache *cache;
+	unsigned long i;
+	long nr_cpus;
+	int ret;
+
+	if (!size)
+		return NULL;
+	if (!align)
+		align = sizeof(void *);
+	if (align & (align - 1))
+		return NULL;
+	align = max(align, sizeof(void *));
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->size = (size + align - 1) & ~(align - 1);
+	cache->align = align;
+	cache->flags = flags;
+	cache->ctor = ctor;
+	cache->flavor = flavor;
+	cache->slab_bytes = max((size_t) SLAB_MIN_BYTES,
+			align + SLAB_MAGAZINE_SIZE * cache->size);
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (nr_cpus <= 0)
+		nr_cpus = 1;
+	for (cache->nr_depots = 1; cache->nr_depots < nr_cpus;
+			cache->nr_depots <<= 1)
+		;
+	ret = posix_memalign((void **) &cache->depots,
+			CAA_CACHE_LINE_SIZE,
+			cache->nr_depots * sizeof(*cache->depots));
+	if (ret)
+		goto error_free;
+	for (i = 0; i < cache->nr_depots; i++)
+		cds_lfs_init(&cache->depots[i].full);
+	cds_lfs_init(&cache->empty);
+
+	ret = pthread_mutex_init(&cache->lock, NULL);
+	if (ret)
+		urcu_die(ret);
+	CDS_INIT_LIST_HEAD(&cache->threads);
+	if (pthread_key_create(&cache->key, thread_exit))
+		goto error_depots;
+	return cache;
+
+error_depots:
+	free(cache->depots);
+error_free:
+	free(cache);
+	return NULL;
+}
+
+static
+void free_magazine_stack(struct cds_lfs_stack *s)
+{
+	struct cds_lfs_node *snode;
+
+	while ((snode = cds_lfs_pop_blocking(s)) != NULL)
+		free(caa_container_of(snode, struct slab_magazine, node));
+	cds_lfs_destroy(s);
+}
+
+void cds_slab_cache_destroy(struct cds_slab_cache *cache)
+{
+	struct slab_thread *st, *tmp;
+	struct slab *slab, *next;
+	unsigned long i;
+	int ret;
+
+	/* Thread exit handlers must not run from now on. */
+	ret = pthread_key_delete(cache->key);
+	if (ret)
+		urcu_die(ret);
+	/* Wait for magazines in flight through call_rcu. */
+	cache->flavor->barrier();
+
+	cds_list_for_each_entry_safe(st, tmp, &cache->threads, list) {
+		free(st->loaded);
+		free(st->pending);
+		free(st);
+	}
+	for (i = 0; i < cache->nr_depots; i++)
+		free_magazine_stack(&cache->depots[i].full);
+	free_magazine_stack(&cache->empty);
+	free(cache->depots);
+	for (slab = cache->slabs; slab; slab = next) {
+		next = slab->next;
+		free(slab);
+	}
+	ret = pthread_mutex_destroy(&cache->lock);
+	if (ret)
+		urcu_die(ret);
+	free(cache);
+}
+
+void *cds_slab_alloc(struct cds_slab_cache *cache)
+{
+	struct slab_thread *st;
+	struct slab_magazine *mag;
+
+	st = thread_state(cache);
+	if (caa_unlikely(!st))
+		return NULL;
+	if (caa_unlikely(!st->loaded->nr)) {
+		mag = get_full_magazine(cache);
+		if (mag) {
+			put_empty_magazine(cache, st->loaded);
+			st->loaded = mag;
+		} else if (refill_magazine(cache, st->loaded)) {
+			return NULL;
+		}
+	}
+	mag = st->loaded;
+	return mag->objs[--mag->nr];
+}
+
+void cds_slab_free(struct cds_slab_cache *cache, void *obj)
+{
+	struct slab_thread *st;
+	struct slab_magazine *mag;
+	int cpu;
+
+	if (!(cache->flags & CDS_SLAB_TYPESAFE_BY_RCU)) {
+		cds_slab_free_rcu(cache, obj);
+		return;
+	}
+	st = thread_state(cache);
+	if (caa_unlikely(!st))
+		return;		/* Out of memory: obj is dropped. */
+	mag = st->loaded;
+	if (caa_unlikely(mag->nr == SLAB_MAGAZINE_SIZE)) {
+		struct slab_magazine *empty;
+
+		empty = get_empty_magazine(cache);
+		if (caa_unlikely(!empty))
+			return;
+		(void) local_depot(cache, &cpu);
+		push_full_magazine(cache, mag, cpu);
+		mag = st->loaded = empty;
+	}
+	mag->objs[mag->nr++] = obj;
+}
+
+void cds_slab_free_rcu(struct cds_slab_cache *cache, void *obj)
+{
+	struct slab_thread *st;
+	struct slab_magazine *mag;
+
+	st = thread_state(cache);
+	if (caa_unlikely(!st))
+		return;		/* Out of memory: obj is dropped. */
+	if (caa_unlikely(!st->pending)) {
+		st->pending = get_empty_magazine(cache);
+		if (!st->pending)
+			return;
+	}
+	mag = st->pending;
+	mag->objs[mag->nr++] = obj;
+	if (caa_unlikely(mag->nr == SLAB_MAGAZINE_SIZE)) {
+		(void) local_depot(cache, &mag->cpu);
+		cache->flavor->update_call_rcu(&mag->head,
+				magazine_reclaim_cb);
+		st->pending = get_empty_magazine(cache);
+	}
+}
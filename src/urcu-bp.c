@@ -43,6 +43,7 @@
 #include "urcu/tls-compat.h"
 
 #include "urcu-die.h"
+#include "urcu-stats.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -146,6 +147,10 @@ DEFINE_URCU_TLS(struct rcu_reader *, rcu_reader);
 
 static CDS_LIST_HEAD(registry);
 
+static struct rcu_gp_stats gp_stats;
+
+#define URCU_STATS_FLAVOR	URCU_STATS_FLAVOR_BP
+
 struct registry_chunk {
 	size_t data_len;		/* data length */
 	size_t used;			/* amount of data used */
@@ -246,10 +251,12 @@ static void wait_for_readers(struct cds_list_head *input_readers,
 		} else {
 			/* Temporarily unlock the registry lock. */
 			mutex_unlock(&rcu_registry_lock);
-			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS)
+			if (wait_loops >= RCU_QS_ACTIVE_ATTEMPTS) {
+				uatomic_inc(&gp_stats.nr_wait);
 				(void) poll(NULL, 0, RCU_SLEEP_DELAY_MS);
-			else
+			} else {
 				caa_cpu_relax();
+			}
 			/* Re-lock the registry lock before the next loop. */
 			mutex_lock(&rcu_registry_lock);
 		}
@@ -261,6 +268,8 @@ void synchronize_rcu(void)
 	CDS_LIST_HEAD(cur_snap_readers);
 	CDS_LIST_HEAD(qsreaders);
 	sigset_t newmask, oldmask;
+	struct urcu_stats_flavor *fs;
+	uint64_t start = 0;
 	int ret;
 
 	ret = sigfillset(&newmask);
@@ -268,6 +277,10 @@ void synchronize_rcu(void)
 	ret = pthread_sigmask(SIG_BLOCK, &newmask, &oldmask);
 	assert(!ret);
 
+	fs = urcu_stats_flavor(URCU_STATS_FLAVOR);
+	if (caa_unlikely(fs))
+		start = urcu_stats_now();
+
 	mutex_lock(&rcu_gp_lock);
 
 	mutex_lock(&rcu_registry_lock);
@@ -329,12 +342,23 @@ void synchronize_rcu(void)
 	 */
 	smp_mb_master();
 out:
+	uatomic_inc(&gp_stats.nr_gp);
+	if (caa_unlikely(fs))
+		urcu_stats_gp_end(fs, start, gp_stats.nr_gp,
+			gp_stats.nr_gp_shared, gp_stats.nr_wait);
 	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	ret = pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
 	assert(!ret);
 }
 
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	stats->nr_gp = uatomic_read(&gp_stats.nr_gp);
+	stats->nr_gp_shared = uatomic_read(&gp_stats.nr_gp_shared);
+	stats->nr_wait = uatomic_read(&gp_stats.nr_wait);
+}
+
 /*
  * library wrappers to be used by non-LGPL compatible source code.
  */
@@ -473,6 +497,8 @@ void add_thread(void)
 	rcu_reader_reg->tid = pthread_self();
 	assert(rcu_reader_reg->ctr == 0);
 	cds_list_add(&rcu_reader_reg->node, &registry);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), 1);
 	/*
 	 * Reader threads are pointing to the reader registry. This is
 	 * why its memory should never be relocated.
@@ -487,6 +513,8 @@ void cleanup_thread(struct registry_chunk *chunk,
 {
 	rcu_reader_reg->ctr = 0;
 	cds_list_del(&rcu_reader_reg->node);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), -1);
 	rcu_reader_reg->tid = 0;
 	rcu_reader_reg->alloc = 0;
 	chunk->used -= sizeof(struct rcu_reader);
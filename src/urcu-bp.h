@@ -140,6 +140,13 @@ extern void *rcu_set_pointer_sym_bp(void **p, void *v);
 
 extern void synchronize_rcu(void);
 
+/*
+ * Grace period statistics. The bp flavor polls readers: nr_wait counts
+ * its sleeps between polls.
+ */
+struct rcu_gp_stats;
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+
 /*
  * rcu_bp_before_fork, rcu_bp_after_fork_parent and rcu_bp_after_fork_child
  * should be called around fork() system calls when the child process is not
@@ -43,6 +43,7 @@
 #include "urcu/tls-compat.h"
 #include "urcu/ref.h"
 #include "urcu-die.h"
+#include "urcu-stats.h"
 
 #define SET_AFFINITY_CHECK_PERIOD		(1U << 8)	/* 256 */
 #define SET_AFFINITY_CHECK_PERIOD_MASK		(SET_AFFINITY_CHECK_PERIOD - 1)
@@ -66,6 +67,7 @@ struct call_rcu_data {
 	int cpu_affinity;
 	unsigned long gp_count;
 	struct cds_list_head list;
+	struct urcu_stats_call_rcu *stats; /* NULL unless stats enabled. */
 } __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
 
 struct call_rcu_completion {
@@ -372,6 +374,12 @@ static void *call_rcu_thread(void *arg)
 				cbcount++;
 			}
 			uatomic_sub(&crdp->qlen, cbcount);
+			if (caa_unlikely(crdp->stats)) {
+				CMM_STORE_SHARED(crdp->stats->qlen,
+					uatomic_read(&crdp->qlen));
+				urcu_stats_add(crdp->stats->nr_invoked, cbcount);
+				urcu_stats_add(crdp->stats->nr_batches, 1);
+			}
 		}
 		if (uatomic_read(&crdp->flags) & URCU_CALL_RCU_STOP)
 			break;
@@ -431,6 +439,12 @@ static void call_rcu_data_init(struct call_rcu_data **crdpp,
 	cds_list_add(&crdp->list, &call_rcu_data_list);
 	crdp->cpu_affinity = cpu_affinity;
 	crdp->gp_count = 0;
+	crdp->stats = urcu_stats_call_rcu_alloc();
+	if (crdp->stats) {
+		crdp->stats->flavor = URCU_STATS_FLAVOR;
+		crdp->stats->cpu = cpu_affinity;
+		crdp->stats->flags = flags;
+	}
 	cmm_smp_mb();  /* Structure initialized before pointer is planted. */
 	*crdpp = crdp;
 	ret = pthread_create(&crdp->tid, NULL, call_rcu_thread, crdp);
@@ -685,7 +699,11 @@ static void _call_rcu(struct rcu_head *head,
 	cds_wfcq_node_init(&head->next);
 	head->func = func;
 	cds_wfcq_enqueue(&crdp->cbs_head, &crdp->cbs_tail, &head->next);
-	uatomic_inc(&crdp->qlen);
+	if (caa_unlikely(crdp->stats))
+		CMM_STORE_SHARED(crdp->stats->qlen,
+			uatomic_add_return(&crdp->qlen, 1));
+	else
+		uatomic_inc(&crdp->qlen);
 	wake_call_rcu_thread(crdp);
 }
 
@@ -767,6 +785,7 @@ void call_rcu_data_free(struct call_rcu_data *crdp)
 	cds_list_del(&crdp->list);
 	call_rcu_unlock(&call_rcu_mutex);
 
+	urcu_stats_call_rcu_free(crdp->stats);
 	free(crdp);
 }
 
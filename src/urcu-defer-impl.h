@@ -50,6 +50,7 @@
 #include <urcu/system.h>
 #include <urcu/tls-compat.h>
 #include "urcu-die.h"
+#include "urcu-stats.h"
 
 /*
  * Number of entries in the per-thread defer queue. Must be power of 2.
@@ -170,6 +171,9 @@ static unsigned long rcu_defer_num_callbacks(void)
 		head = CMM_LOAD_SHARED(index->head);
 		num_items += head - index->tail;
 	}
+	if (caa_unlikely(urcu_stats))
+		CMM_STORE_SHARED(urcu_stats_flavor(URCU_STATS_FLAVOR)->defer_fill,
+			num_items);
 	mutex_unlock(&rcu_defer_mutex);
 	return num_items;
 }
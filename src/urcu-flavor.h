@@ -37,6 +37,16 @@ struct urcu_atfork {
 void urcu_register_rculfhash_atfork(struct urcu_atfork *atfork);
 void urcu_unregister_rculfhash_atfork(struct urcu_atfork *atfork);
 
+/*
+ * Grace period statistics of a flavor, cumulative since the library was
+ * loaded. See rcu_get_gp_stats().
+ */
+struct rcu_gp_stats {
+	unsigned long nr_gp;		/* grace periods performed */
+	unsigned long nr_gp_shared;	/* synchronize_rcu() served by a concurrent grace period */
+	unsigned long nr_wait;		/* futex waits for readers */
+};
+
 struct rcu_flavor_struct {
 	void (*read_lock)(void);
 	void (*read_unlock)(void);
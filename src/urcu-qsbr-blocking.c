@@ -0,0 +1,155 @@
+/*
+ * urcu-qsbr-blocking.c
+ *
+ * Userspace RCU QSBR library - blocking calls which put the calling
+ * thread offline while they block.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <urcu/futex.h>
+#include "urcu/map/urcu-qsbr.h"
+#include "urcu/static/urcu-qsbr.h"
+#include "urcu-qsbr-blocking.h"
+
+/*
+ * Put the thread offline before a blocking call. Returns whether the
+ * thread was online, and must be put back online by block_end().
+ */
+static inline
+int block_begin(void)
+{
+	if (!_rcu_read_ongoing())
+		return 0;
+	_rcu_thread_offline();
+	return 1;
+}
+
+static inline
+void block_end(int online)
+{
+	int saved_errno;
+
+	if (!online)
+		return;
+	saved_errno = errno;
+	_rcu_thread_online();
+	errno = saved_errno;
+}
+
+int rcu_qsbr_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	int ret, online;
+
+	ret = poll(fds, nfds, 0);
+	if (ret || !timeout)
+		return ret;
+	online = block_begin();
+	ret = poll(fds, nfds, timeout);
+	block_end(online);
+	return ret;
+}
+
+#ifdef __linux__
+int rcu_qsbr_epoll_wait(int epfd, struct epoll_event *events,
+		int maxevents, int timeout)
+{
+	int ret, online;
+
+	ret = epoll_wait(epfd, events, maxevents, 0);
+	if (ret || !timeout)
+		return ret;
+	online = block_begin();
+	ret = epoll_wait(epfd, events, maxevents, timeout);
+	block_end(online);
+	return ret;
+}
+#endif
+
+ssize_t rcu_qsbr_read(int fd, void *buf, size_t count)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	ssize_t ret;
+	int online;
+
+	/*
+	 * Ready, error or hangup: read() does not block. If poll() itself
+	 * fails, read() may block: go offline.
+	 */
+	if (poll(&pfd, 1, 0) > 0)
+		return read(fd, buf, count);
+	online = block_begin();
+	ret = read(fd, buf, count);
+	block_end(online);
+	return ret;
+}
+
+int rcu_qsbr_nanosleep(const struct timespec *req, struct timespec *rem)
+{
+	int ret, online;
+
+	if (!req->tv_sec && !req->tv_nsec)
+		return nanosleep(req, rem);
+	online = block_begin();
+	ret = nanosleep(req, rem);
+	block_end(online);
+	return ret;
+}
+
+int rcu_qsbr_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+	int ret, online;
+
+	online = block_begin();
+	ret = pthread_cond_wait(cond, mutex);
+	block_end(online);
+	return ret;
+}
+
+int rcu_qsbr_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+		const struct timespec *abstime)
+{
+	int ret, online;
+
+	online = block_begin();
+	ret = pthread_cond_timedwait(cond, mutex, abstime);
+	block_end(online);
+	return ret;
+}
+
+int rcu_qsbr_futex_wait(int32_t *uaddr, int32_t val,
+		const struct timespec *timeout)
+{
+	int ret, online;
+
+	if (CMM_LOAD_SHARED(*uaddr) != val) {
+		errno = EAGAIN;
+		return -1;
+	}
+	online = block_begin();
+	ret = futex_async(uaddr, FUTEX_WAIT, val, timeout, NULL, 0);
+	block_end(online);
+	return ret;
+}
@@ -0,0 +1,113 @@
+#ifndef _URCU_QSBR_BLOCKING_H
+#define _URCU_QSBR_BLOCKING_H
+
+/*
+ * urcu-qsbr-blocking.h
+ *
+ * Userspace RCU QSBR header - blocking calls which put the calling
+ * thread offline while they block.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A QSBR reader thread which blocks while online delays every grace
+ * period until it wakes up. The following wrappers behave like the
+ * call they wrap, but put the calling thread offline for the time it
+ * actually blocks: the call is first attempted without blocking, and
+ * if it completes, it returns without touching the reader state, hence
+ * without any memory barrier. Otherwise the thread goes offline, blocks
+ * and goes back online before returning.
+ *
+ * The calling thread must be registered with the QSBR flavor, and be
+ * outside of any RCU read-side critical section. A thread which is
+ * already offline stays offline. errno is set as by the wrapped call.
+ * Link with -lurcu-qsbr.
+ */
+
+/*
+ * rcu_qsbr_poll - poll(2), offline while blocking.
+ */
+extern int rcu_qsbr_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
+#ifdef __linux__
+struct epoll_event;
+
+/*
+ * rcu_qsbr_epoll_wait - epoll_wait(2), offline while blocking.
+ */
+extern int rcu_qsbr_epoll_wait(int epfd, struct epoll_event *events,
+		int maxevents, int timeout);
+#endif
+
+/*
+ * rcu_qsbr_read - read(2), offline while blocking.
+ *
+ * The file descriptor is polled first: if no input is ready, the
+ * thread is put offline before calling read().
+ */
+extern ssize_t rcu_qsbr_read(int fd, void *buf, size_t count);
+
+/*
+ * rcu_qsbr_nanosleep - nanosleep(2), offline while sleeping.
+ *
+ * A zero duration does not put the thread offline.
+ */
+extern int rcu_qsbr_nanosleep(const struct timespec *req,
+		struct timespec *rem);
+
+/*
+ * rcu_qsbr_cond_wait - pthread_cond_wait(3), offline while waiting.
+ * rcu_qsbr_cond_timedwait - pthread_cond_timedwait(3), offline while
+ * waiting.
+ *
+ * Waiting on a condition always blocks, so the caller is expected to
+ * check its predicate first, as usual, which is the non-blocking path.
+ * The thread goes back online after the mutex is acquired again.
+ * Return the error number, like the wrapped calls.
+ */
+extern int rcu_qsbr_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+extern int rcu_qsbr_cond_timedwait(pthread_cond_t *cond,
+		pthread_mutex_t *mutex, const struct timespec *abstime);
+
+/*
+ * rcu_qsbr_futex_wait - FUTEX_WAIT on a 32-bit word, offline while
+ * blocking.
+ * @uaddr: the futex word.
+ * @val: value expected at @uaddr.
+ * @timeout: relative timeout, or NULL to wait forever.
+ *
+ * If *@uaddr differs from @val, return -1 with errno set to EAGAIN
+ * without entering the kernel. Otherwise behave as futex_async()
+ * FUTEX_WAIT; waiters must be woken up with futex_async() FUTEX_WAKE.
+ */
+extern int rcu_qsbr_futex_wait(int32_t *uaddr, int32_t val,
+		const struct timespec *timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _URCU_QSBR_BLOCKING_H */
@@ -43,6 +43,7 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-stats.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -87,6 +88,10 @@ static CDS_LIST_HEAD(registry);
  */
 static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
 
+static struct rcu_gp_stats gp_stats;
+
+#define URCU_STATS_FLAVOR	URCU_STATS_FLAVOR_QSBR
+
 static void mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
@@ -122,6 +127,7 @@ static void wait_gp(void)
 	cmm_smp_rmb();
 	if (uatomic_read(&rcu_gp.futex) != -1)
 		return;
+	uatomic_inc(&gp_stats.nr_wait);
 	while (futex_noasync(&rcu_gp.futex, FUTEX_WAIT, -1,
 			NULL, NULL, 0)) {
 		switch (errno) {
@@ -231,6 +237,8 @@ void synchronize_rcu(void)
 	unsigned long was_online;
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct urcu_stats_flavor *fs;
+	uint64_t start = 0;
 
 	was_online = rcu_read_ongoing();
 
@@ -255,11 +263,16 @@ void synchronize_rcu(void)
 	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
 		urcu_adaptative_busy_wait(&wait);
+		uatomic_inc(&gp_stats.nr_gp_shared);
 		goto gp_end;
 	}
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
+	fs = urcu_stats_flavor(URCU_STATS_FLAVOR);
+	if (caa_unlikely(fs))
+		start = urcu_stats_now();
+
 	mutex_lock(&rcu_gp_lock);
 
 	/*
@@ -327,6 +340,10 @@ void synchronize_rcu(void)
 	 */
 	cds_list_splice(&qsreaders, &registry);
 out:
+	uatomic_inc(&gp_stats.nr_gp);
+	if (caa_unlikely(fs))
+		urcu_stats_gp_end(fs, start, gp_stats.nr_gp,
+			uatomic_read(&gp_stats.nr_gp_shared), gp_stats.nr_wait);
 	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	urcu_wake_all_waiters(&waiters);
@@ -347,6 +364,8 @@ void synchronize_rcu(void)
 	unsigned long was_online;
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct urcu_stats_flavor *fs;
+	uint64_t start = 0;
 
 	was_online = rcu_read_ongoing();
 
@@ -368,11 +387,16 @@ void synchronize_rcu(void)
 	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
 		urcu_adaptative_busy_wait(&wait);
+		uatomic_inc(&gp_stats.nr_gp_shared);
 		goto gp_end;
 	}
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
+	fs = urcu_stats_flavor(URCU_STATS_FLAVOR);
+	if (caa_unlikely(fs))
+		start = urcu_stats_now();
+
 	mutex_lock(&rcu_gp_lock);
 
 	/*
@@ -416,6 +440,10 @@ void synchronize_rcu(void)
 	 */
 	cds_list_splice(&qsreaders, &registry);
 out:
+	uatomic_inc(&gp_stats.nr_gp);
+	if (caa_unlikely(fs))
+		urcu_stats_gp_end(fs, start, gp_stats.nr_gp,
+			uatomic_read(&gp_stats.nr_gp_shared), gp_stats.nr_wait);
 	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 	urcu_wake_all_waiters(&waiters);
@@ -427,6 +455,13 @@ gp_end:
 }
 #endif  /* !(CAA_BITS_PER_LONG < 64) */
 
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	stats->nr_gp = uatomic_read(&gp_stats.nr_gp);
+	stats->nr_gp_shared = uatomic_read(&gp_stats.nr_gp_shared);
+	stats->nr_wait = uatomic_read(&gp_stats.nr_wait);
+}
+
 /*
  * library wrappers to be used by non-LGPL compatible source code.
  */
@@ -470,6 +505,8 @@ void rcu_register_thread(void)
 	assert(!URCU_TLS(rcu_reader).registered);
 	URCU_TLS(rcu_reader).registered = 1;
 	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), 1);
 	mutex_unlock(&rcu_registry_lock);
 	_rcu_thread_online();
 }
@@ -485,6 +522,8 @@ void rcu_unregister_thread(void)
 	URCU_TLS(rcu_reader).registered = 0;
 	mutex_lock(&rcu_registry_lock);
 	cds_list_del(&URCU_TLS(rcu_reader).node);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), -1);
 	mutex_unlock(&rcu_registry_lock);
 }
 
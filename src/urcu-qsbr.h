@@ -123,6 +123,9 @@ extern void rcu_thread_online(void);
 
 extern void synchronize_rcu(void);
 
+struct rcu_gp_stats;
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+
 /*
  * Reader thread registration.
  */
@@ -0,0 +1,408 @@
+/*
+ * urcu-read-profile.c
+ *
+ * Userspace RCU library - read-side critical section duration profiler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include <urcu/list.h>
+#include <urcu/read-profile.h>
+#include "urcu-die.h"
+
+/*
+ * Per-thread histogram. When the thread exits, it is folded into
+ * exited_hist and freed.
+ */
+struct urcu_read_profile_hist {
+	struct cds_list_head node;
+	unsigned long tid;
+	uint64_t buckets[URCU_READ_PROFILE_NR_BUCKETS];
+	uint64_t nr_samples;
+	uint64_t max_ns;
+};
+
+struct slow_section {
+	uint64_t duration_ns;
+	unsigned long tid;
+	int nr_frames;
+	void *frames[URCU_READ_PROFILE_NR_FRAMES];
+};
+
+unsigned long urcu_read_profile_period;
+DEFINE_URCU_TLS(struct urcu_read_profile_thread, urcu_read_profile_thread);
+
+static uint64_t threshold_ns;
+
+/*
+ * profile_mutex protects the histogram list and the slow sections. It is
+ * only taken by a profiled thread for its first sample and for sections
+ * over the threshold.
+ */
+static pthread_mutex_t profile_mutex = PTHREAD_MUTEX_INITIALIZER;
+static CDS_LIST_HEAD(hist_list);
+static struct urcu_read_profile_hist exited_hist;
+static unsigned int nr_exited;
+static pthread_key_t hist_key;
+static struct slow_section slow[URCU_READ_PROFILE_NR_SLOW];
+static unsigned int nr_slow_kept;
+static uint64_t nr_slow;
+
+static void __attribute__((constructor)) urcu_read_profile_init(void);
+static void __attribute__((destructor)) urcu_read_profile_exit(void);
+static int dump_at_exit;
+
+static void mutex_lock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_lock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static void mutex_unlock(pthread_mutex_t *mutex)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(mutex);
+	if (ret)
+		urcu_die(ret);
+}
+
+static uint64_t profile_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 1;
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int bucket_index(uint64_t ns)
+{
+	if (!ns)
+		return 0;
+	return 63 - __builtin_clzll(ns);
+}
+
+static struct urcu_read_profile_hist *hist_register(void)
+{
+	struct urcu_read_profile_hist *hist;
+
+	hist = calloc(1, sizeof(*hist));
+	if (!hist)
+		return NULL;
+	hist->tid = (unsigned long) pthread_self();
+	if (pthread_setspecific(hist_key, hist)) {
+		free(hist);
+		return NULL;
+	}
+	mutex_lock(&profile_mutex);
+	cds_list_add_tail(&hist->node, &hist_list);
+	mutex_unlock(&profile_mutex);
+	return hist;
+}
+
+/* hist_key destructor: fold the histogram of an exiting thread. */
+static void hist_unregister(void *arg)
+{
+	struct urcu_read_profile_hist *hist = arg;
+	unsigned int i;
+
+	mutex_lock(&profile_mutex);
+	cds_list_del(&hist->node);
+	for (i = 0; i < URCU_READ_PROFILE_NR_BUCKETS; i++)
+		exited_hist.buckets[i] += hist->buckets[i];
+	exited_hist.nr_samples += hist->nr_samples;
+	if (hist->max_ns > exited_hist.max_ns)
+		exited_hist.max_ns = hist->max_ns;
+	nr_exited++;
+	mutex_unlock(&profile_mutex);
+	/* Sections ending in later destructors register a new histogram. */
+	URCU_TLS(urcu_read_profile_thread).hist = NULL;
+	free(hist);
+}
+
+/* Keep the longest sections over the threshold. */
+static void record_slow(uint64_t duration)
+{
+	struct slow_section *s = NULL;
+	unsigned int i;
+
+	mutex_lock(&profile_mutex);
+	nr_slow++;
+	if (nr_slow_kept < URCU_READ_PROFILE_NR_SLOW) {
+		s = &slow[nr_slow_kept++];
+	} else {
+		for (i = 0; i < URCU_READ_PROFILE_NR_SLOW; i++) {
+			if (slow[i].duration_ns >= duration)
+				continue;
+			if (!s || slow[i].duration_ns < s->duration_ns)
+				s = &slow[i];
+		}
+	}
+	if (s) {
+		s->duration_ns = duration;
+		s->tid = (unsigned long) pthread_self();
+#ifdef HAVE_EXECINFO_H
+		s->nr_frames = backtrace(s->frames, URCU_READ_PROFILE_NR_FRAMES);
+#else
+		s->nr_frames = 0;
+#endif
+	}
+	mutex_unlock(&profile_mutex);
+}
+
+void urcu_read_profile_sample_begin(void)
+{
+	URCU_TLS(urcu_read_profile_thread).start = profile_now();
+}
+
+void urcu_read_profile_sample_stop(void)
+{
+	URCU_TLS(urcu_read_profile_thread).stop = profile_now();
+}
+
+void urcu_read_profile_sample_end(void)
+{
+	struct urcu_read_profile_thread *t = &URCU_TLS(urcu_read_profile_thread);
+	struct urcu_read_profile_hist *hist;
+	uint64_t duration, threshold;
+
+	duration = t->stop - t->start;
+	t->start = 0;
+	t->stop = 0;
+	if (caa_unlikely(!t->hist)) {
+		t->hist = hist_register();
+		if (!t->hist)
+			return;
+	}
+	hist = t->hist;
+	/* Single writer: dumps may read slightly stale values. */
+	CMM_STORE_SHARED(hist->buckets[bucket_index(duration)],
+		hist->buckets[bucket_index(duration)] + 1);
+	CMM_STORE_SHARED(hist->nr_samples, hist->nr_samples + 1);
+	if (duration > hist->max_ns)
+		CMM_STORE_SHARED(hist->max_ns, duration);
+	threshold = CMM_LOAD_SHARED(threshold_ns);
+	if (threshold && duration >= threshold)
+		record_slow(duration);
+}
+
+int urcu_read_profile_enable(unsigned long period, uint64_t threshold)
+{
+	if (!period || (period & (period - 1)))
+		return -EINVAL;
+#ifdef HAVE_EXECINFO_H
+	if (threshold) {
+		void *frame;
+
+		/* Load the unwinder now rather than within a section. */
+		(void) backtrace(&frame, 1);
+	}
+#endif
+	CMM_STORE_SHARED(threshold_ns, threshold);
+	CMM_STORE_SHARED(urcu_read_profile_period, period);
+	return 0;
+}
+
+void urcu_read_profile_disable(void)
+{
+	CMM_STORE_SHARED(urcu_read_profile_period, 0);
+}
+
+void urcu_read_profile_reset(void)
+{
+	struct urcu_read_profile_hist *hist;
+
+	mutex_lock(&profile_mutex);
+	cds_list_for_each_entry(hist, &hist_list, node) {
+		memset(hist->buckets, 0, sizeof(hist->buckets));
+		hist->nr_samples = 0;
+		hist->max_ns = 0;
+	}
+	memset(&exited_hist, 0, sizeof(exited_hist));
+	nr_exited = 0;
+	memset(slow, 0, sizeof(slow));
+	nr_slow_kept = 0;
+	nr_slow = 0;
+	mutex_unlock(&profile_mutex);
+}
+
+static void hist_add(struct urcu_read_profile_summary *summary,
+		const struct urcu_read_profile_hist *hist)
+{
+	unsigned int i;
+
+	for (i = 0; i < URCU_READ_PROFILE_NR_BUCKETS; i++)
+		summary->buckets[i] += CMM_LOAD_SHARED(hist->buckets[i]);
+	summary->nr_samples += CMM_LOAD_SHARED(hist->nr_samples);
+	if (CMM_LOAD_SHARED(hist->max_ns) > summary->max_ns)
+		summary->max_ns = CMM_LOAD_SHARED(hist->max_ns);
+}
+
+void urcu_read_profile_get(struct urcu_read_profile_summary *summary)
+{
+	struct urcu_read_profile_hist *hist;
+
+	memset(summary, 0, sizeof(*summary));
+	mutex_lock(&profile_mutex);
+	cds_list_for_each_entry(hist, &hist_list, node) {
+		hist_add(summary, hist);
+		summary->nr_threads++;
+	}
+	hist_add(summary, &exited_hist);
+	summary->nr_threads += nr_exited;
+	summary->nr_slow = nr_slow;
+	mutex_unlock(&profile_mutex);
+}
+
+/* Upper bound of the bucket holding the ratio-th sample. */
+static uint64_t percentile(const struct urcu_read_profile_summary *summary,
+		double ratio)
+{
+	uint64_t target, sum = 0;
+	unsigned int i;
+
+	if (!summary->nr_samples)
+		return 0;
+	target = (uint64_t) (summary->nr_samples * ratio);
+	if (target >= summary->nr_samples)
+		target = summary->nr_samples - 1;
+	for (i = 0; i < URCU_READ_PROFILE_NR_BUCKETS - 1; i++) {
+		sum += summary->buckets[i];
+		if (sum > target)
+			break;
+	}
+	return (2ULL << i) - 1;
+}
+
+static void print_summary(FILE *fp, const char *who,
+		const struct urcu_read_profile_summary *summary)
+{
+	fprintf(fp, "READPROFILE %-20s samples %12llu p50_ns %12llu "
+		"p99_ns %12llu max_ns %12llu\n", who,
+		(unsigned long long) summary->nr_samples,
+		(unsigned long long) percentile(summary, 0.50),
+		(unsigned long long) percentile(summary, 0.99),
+		(unsigned long long) summary->max_ns);
+}
+
+void urcu_read_profile_dump(FILE *fp)
+{
+	struct urcu_read_profile_summary all, one;
+	struct urcu_read_profile_hist *hist;
+	char who[32];
+	unsigned int i;
+	int j;
+
+	memset(&all, 0, sizeof(all));
+	mutex_lock(&profile_mutex);
+	cds_list_for_each_entry(hist, &hist_list, node) {
+		memset(&one, 0, sizeof(one));
+		hist_add(&one, hist);
+		hist_add(&all, hist);
+		snprintf(who, sizeof(who), "thread-%lx", hist->tid);
+		print_summary(fp, who, &one);
+	}
+	if (nr_exited) {
+		memset(&one, 0, sizeof(one));
+		hist_add(&one, &exited_hist);
+		hist_add(&all, &exited_hist);
+		snprintf(who, sizeof(who), "exited-%u", nr_exited);
+		print_summary(fp, who, &one);
+	}
+	print_summary(fp, "all", &all);
+	for (i = 0; i < URCU_READ_PROFILE_NR_BUCKETS; i++) {
+		if (!all.buckets[i])
+			continue;
+		fprintf(fp, "READPROFILE bucket_ns %20llu count %12llu\n",
+			1ULL << i, (unsigned long long) all.buckets[i]);
+	}
+	fprintf(fp, "READPROFILE slow_sections %llu threshold_ns %llu\n",
+		(unsigned long long) nr_slow,
+		(unsigned long long) threshold_ns);
+	for (i = 0; i < nr_slow_kept; i++) {
+		fprintf(fp, "SLOWSECTION duration_ns %llu thread-%lx\n",
+			(unsigned long long) slow[i].duration_ns, slow[i].tid);
+#ifdef HAVE_EXECINFO_H
+		{
+			char **symbols;
+
+			symbols = backtrace_symbols(slow[i].frames,
+				slow[i].nr_frames);
+			for (j = 0; j < slow[i].nr_frames; j++)
+				fprintf(fp, "\t%s\n", symbols ? symbols[j] : "?");
+			free(symbols);
+		}
+#else
+		for (j = 0; j < slow[i].nr_frames; j++)
+			fprintf(fp, "\t%p\n", slow[i].frames[j]);
+#endif
+	}
+	mutex_unlock(&profile_mutex);
+	fflush(fp);
+}
+
+/*
+ * URCU_READ_PROFILE="period[,threshold_us]" enables the profiler from
+ * library load to unload.
+ */
+static void urcu_read_profile_init(void)
+{
+	const char *env;
+	unsigned long period;
+	unsigned long long threshold_us = 0;
+	char *end;
+	int ret;
+
+	ret = pthread_key_create(&hist_key, hist_unregister);
+	if (ret)
+		urcu_die(ret);
+	env = getenv(URCU_READ_PROFILE_ENV);
+	if (!env || !*env)
+		return;
+	period = strtoul(env, &end, 0);
+	if (*end == ',')
+		threshold_us = strtoull(end + 1, &end, 0);
+	if (*end || urcu_read_profile_enable(period, threshold_us * 1000)) {
+		fprintf(stderr, "[error] liburcu: invalid %s=\"%s\", expecting \"period[,threshold_us]\" with a power of two period\n",
+			URCU_READ_PROFILE_ENV, env);
+		return;
+	}
+	dump_at_exit = 1;
+}
+
+static void urcu_read_profile_exit(void)
+{
+	int ret;
+
+	if (dump_at_exit)
+		urcu_read_profile_dump(stderr);
+	ret = pthread_key_delete(hist_key);
+	if (ret)
+		urcu_die(ret);
+}
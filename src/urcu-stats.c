@@ -0,0 +1,194 @@
+/*
+ * urcu-stats.c
+ *
+ * Userspace RCU library - live statistics in shared memory
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <urcu/arch.h>
+#include <urcu/uatomic.h>
+#include "urcu-stats.h"
+
+struct urcu_stats *urcu_stats;
+
+#ifdef HAVE_SHM_OPEN
+
+static char stats_name[64];
+
+static void __attribute__((constructor)) urcu_stats_init(void);
+static void __attribute__((destructor)) urcu_stats_exit(void);
+
+/*
+ * The child of a fork() must not update the counters of its parent:
+ * replace the shared mapping by a private copy at the same address, so
+ * slots already handed out stay valid.
+ */
+static void urcu_stats_after_fork_child(void)
+{
+	struct urcu_stats *copy;
+	void *p;
+
+	copy = malloc(sizeof(*copy));
+	if (!copy)
+		abort();
+	memcpy(copy, urcu_stats, sizeof(*copy));
+	p = mmap(urcu_stats, sizeof(*urcu_stats), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	if (p != urcu_stats)
+		abort();
+	memcpy(urcu_stats, copy, sizeof(*copy));
+	free(copy);
+	urcu_stats->pid = getpid();
+	stats_name[0] = '\0';
+}
+
+static void urcu_stats_init(void)
+{
+	const char *env;
+	struct urcu_stats *stats;
+	int fd;
+
+	env = getenv(URCU_STATS_ENV);
+	if (!env || !*env || !strcmp(env, "0"))
+		return;
+	if (env[0] == '/')
+		snprintf(stats_name, sizeof(stats_name), "%s", env);
+	else
+		snprintf(stats_name, sizeof(stats_name), URCU_STATS_NAME_FMT,
+			(int) getpid());
+
+	fd = shm_open(stats_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		goto error;
+	if (ftruncate(fd, sizeof(*stats)) < 0) {
+		close(fd);
+		shm_unlink(stats_name);
+		goto error;
+	}
+	stats = mmap(NULL, sizeof(*stats), PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	close(fd);
+	if (stats == MAP_FAILED) {
+		shm_unlink(stats_name);
+		goto error;
+	}
+	stats->version = URCU_STATS_VERSION;
+	stats->size = sizeof(*stats);
+	stats->pid = getpid();
+	/* Layout initialized before the magic number is observable. */
+	cmm_smp_wmb();
+	CMM_STORE_SHARED(stats->magic, URCU_STATS_MAGIC);
+	urcu_stats = stats;
+	(void) pthread_atfork(NULL, NULL, urcu_stats_after_fork_child);
+	return;
+
+error:
+	fprintf(stderr, "[error] liburcu: unable to create statistics shared memory %s\n",
+		stats_name);
+	stats_name[0] = '\0';
+}
+
+static void urcu_stats_exit(void)
+{
+	/*
+	 * Keep the mapping: threads still running at exit may update
+	 * their counters. Only remove the name.
+	 */
+	if (stats_name[0])
+		shm_unlink(stats_name);
+}
+
+#endif /* HAVE_SHM_OPEN */
+
+static
+void *slot_alloc(void *slots, size_t stride, unsigned int nr)
+{
+	unsigned int i;
+
+	if (!urcu_stats)
+		return NULL;
+	for (i = 0; i < nr; i++) {
+		uint32_t *state = (uint32_t *) ((char *) slots + i * stride);
+
+		if (uatomic_read(state) != URCU_STATS_SLOT_FREE)
+			continue;
+		if (uatomic_cmpxchg(state, URCU_STATS_SLOT_FREE,
+				URCU_STATS_SLOT_USED) == URCU_STATS_SLOT_FREE)
+			return state;
+	}
+	return NULL;
+}
+
+struct urcu_stats_call_rcu *urcu_stats_call_rcu_alloc(void)
+{
+	struct urcu_stats_call_rcu *slot;
+
+	slot = slot_alloc(urcu_stats ? urcu_stats->call_rcu : NULL,
+		sizeof(*slot), URCU_STATS_NR_CALL_RCU);
+	if (!slot)
+		return NULL;
+	slot->flavor = -1;
+	slot->cpu = -1;
+	slot->flags = 0;
+	slot->qlen = 0;
+	slot->nr_invoked = 0;
+	slot->nr_batches = 0;
+	return slot;
+}
+
+void urcu_stats_call_rcu_free(struct urcu_stats_call_rcu *slot)
+{
+	if (!slot)
+		return;
+	uatomic_set(&slot->state, URCU_STATS_SLOT_FREE);
+}
+
+struct urcu_stats_lfht *urcu_stats_lfht_alloc(void)
+{
+	struct urcu_stats_lfht *slot;
+
+	slot = slot_alloc(urcu_stats ? urcu_stats->lfht : NULL,
+		sizeof(*slot), URCU_STATS_NR_LFHT);
+	if (!slot)
+		return NULL;
+	slot->flags = 0;
+	slot->size = 0;
+	slot->resize_target = 0;
+	slot->count = 0;
+	slot->min_nr_alloc_buckets = 0;
+	slot->max_nr_buckets = 0;
+	slot->nr_resize = 0;
+	slot->resize_last_ns = 0;
+	slot->resize_total_ns = 0;
+	return slot;
+}
+
+void urcu_stats_lfht_free(struct urcu_stats_lfht *slot)
+{
+	if (!slot)
+		return;
+	uatomic_set(&slot->state, URCU_STATS_SLOT_FREE);
+}
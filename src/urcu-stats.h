@@ -0,0 +1,103 @@
+#ifndef _URCU_STATS_INTERNAL_H
+#define _URCU_STATS_INTERNAL_H
+
+/*
+ * urcu-stats.h
+ *
+ * Userspace RCU library - live statistics, internal helpers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <urcu/compiler.h>
+#include <urcu/system.h>
+#include <urcu/stats.h>
+
+/*
+ * NULL unless statistics are enabled. Set by the liburcu-common
+ * constructor, before any other liburcu code runs.
+ */
+extern struct urcu_stats *urcu_stats;
+
+/* Slot allocation returns NULL when disabled or when all slots are used. */
+extern struct urcu_stats_call_rcu *urcu_stats_call_rcu_alloc(void);
+extern void urcu_stats_call_rcu_free(struct urcu_stats_call_rcu *slot);
+extern struct urcu_stats_lfht *urcu_stats_lfht_alloc(void);
+extern void urcu_stats_lfht_free(struct urcu_stats_lfht *slot);
+
+/*
+ * Counters are only updated by a single thread at a time, so plain
+ * read-modify-write sequences are enough. Gauges such as the call_rcu
+ * qlen are instead stored by several threads (the worker and every
+ * enqueuer); each store copies the current value, and the last writer
+ * wins, which is accepted for a monitoring snapshot. The stores are
+ * visible to other processes in any order.
+ */
+#define urcu_stats_add(field, v)					\
+	CMM_STORE_SHARED(field, (field) + (v))
+
+static inline
+struct urcu_stats_flavor *urcu_stats_flavor(int id)
+{
+	if (caa_likely(!urcu_stats))
+		return NULL;
+	return &urcu_stats->flavor[id];
+}
+
+static inline
+uint64_t urcu_stats_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Account for a grace period started at "start", and publish the
+ * flavor grace period counters. Called by the grace period leader.
+ */
+static inline
+void urcu_stats_gp_end(struct urcu_stats_flavor *fs, uint64_t start,
+		unsigned long nr_gp, unsigned long nr_gp_shared,
+		unsigned long nr_wait)
+{
+	uint64_t duration = urcu_stats_now() - start;
+
+	CMM_STORE_SHARED(fs->active, 1);
+	CMM_STORE_SHARED(fs->gp_last_ns, duration);
+	if (duration > fs->gp_max_ns)
+		CMM_STORE_SHARED(fs->gp_max_ns, duration);
+	urcu_stats_add(fs->gp_total_ns, duration);
+	CMM_STORE_SHARED(fs->nr_gp, nr_gp);
+	CMM_STORE_SHARED(fs->nr_gp_shared, nr_gp_shared);
+	CMM_STORE_SHARED(fs->nr_wait, nr_wait);
+}
+
+/* Called with the flavor registry lock held. */
+static inline
+void urcu_stats_threads(struct urcu_stats_flavor *fs, long delta)
+{
+	CMM_STORE_SHARED(fs->active, 1);
+	/* Threads registered before the region was created are not counted. */
+	if (delta < 0 && !fs->nr_threads)
+		return;
+	urcu_stats_add(fs->nr_threads, delta);
+}
+
+#endif /* _URCU_STATS_INTERNAL_H */
@@ -45,6 +45,7 @@
 
 #include "urcu-die.h"
 #include "urcu-wait.h"
+#include "urcu-stats.h"
 
 /* Do not #define _LGPL_SOURCE to ensure we can emit the wrapper symbols */
 #undef _LGPL_SOURCE
@@ -128,6 +129,16 @@ static CDS_LIST_HEAD(registry);
  */
 static DEFINE_URCU_WAIT_QUEUE(gp_waiters);
 
+static struct rcu_gp_stats gp_stats;
+
+#ifdef RCU_MEMBARRIER
+#define URCU_STATS_FLAVOR	URCU_STATS_FLAVOR_MEMB
+#elif defined(RCU_MB)
+#define URCU_STATS_FLAVOR	URCU_STATS_FLAVOR_MB
+#else
+#define URCU_STATS_FLAVOR	URCU_STATS_FLAVOR_SIGNAL
+#endif
+
 static void mutex_lock(pthread_mutex_t *mutex)
 {
 	int ret;
@@ -242,6 +253,7 @@ static void wait_gp(void)
 	mutex_unlock(&rcu_registry_lock);
 	if (uatomic_read(&rcu_gp.futex) != -1)
 		goto end;
+	uatomic_inc(&gp_stats.nr_wait);
 	while (futex_async(&rcu_gp.futex, FUTEX_WAIT, -1,
 			NULL, NULL, 0)) {
 		switch (errno) {
@@ -380,6 +392,8 @@ void synchronize_rcu(void)
 	CDS_LIST_HEAD(qsreaders);
 	DEFINE_URCU_WAIT_NODE(wait, URCU_WAIT_WAITING);
 	struct urcu_waiters waiters;
+	struct urcu_stats_flavor *fs;
+	uint64_t start = 0;
 
 	/*
 	 * Add ourself to gp_waiters queue of threads awaiting to wait
@@ -392,6 +406,7 @@ void synchronize_rcu(void)
 	if (urcu_wait_add(&gp_waiters, &wait) != 0) {
 		/* Not first in queue: will be awakened by another thread. */
 		urcu_adaptative_busy_wait(&wait);
+		uatomic_inc(&gp_stats.nr_gp_shared);
 		/* Order following memory accesses after grace period. */
 		cmm_smp_mb();
 		return;
@@ -399,6 +414,10 @@ void synchronize_rcu(void)
 	/* We won't need to wake ourself up */
 	urcu_wait_set_state(&wait, URCU_WAIT_RUNNING);
 
+	fs = urcu_stats_flavor(URCU_STATS_FLAVOR);
+	if (caa_unlikely(fs))
+		start = urcu_stats_now();
+
 	mutex_lock(&rcu_gp_lock);
 
 	/*
@@ -480,6 +499,10 @@ void synchronize_rcu(void)
 	 */
 	smp_mb_master();
 out:
+	uatomic_inc(&gp_stats.nr_gp);
+	if (caa_unlikely(fs))
+		urcu_stats_gp_end(fs, start, gp_stats.nr_gp,
+			uatomic_read(&gp_stats.nr_gp_shared), gp_stats.nr_wait);
 	mutex_unlock(&rcu_registry_lock);
 	mutex_unlock(&rcu_gp_lock);
 
@@ -491,6 +514,13 @@ out:
 	urcu_wake_all_waiters(&waiters);
 }
 
+void rcu_get_gp_stats(struct rcu_gp_stats *stats)
+{
+	stats->nr_gp = uatomic_read(&gp_stats.nr_gp);
+	stats->nr_gp_shared = uatomic_read(&gp_stats.nr_gp_shared);
+	stats->nr_wait = uatomic_read(&gp_stats.nr_wait);
+}
+
 /*
  * library wrappers to be used by non-LGPL compatible source code.
  */
@@ -521,6 +551,8 @@ void rcu_register_thread(void)
 	URCU_TLS(rcu_reader).registered = 1;
 	rcu_init();	/* In case gcc does not support constructor attribute */
 	cds_list_add(&URCU_TLS(rcu_reader).node, &registry);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), 1);
 	mutex_unlock(&rcu_registry_lock);
 }
 
@@ -530,6 +562,8 @@ void rcu_unregister_thread(void)
 	assert(URCU_TLS(rcu_reader).registered);
 	URCU_TLS(rcu_reader).registered = 0;
 	cds_list_del(&URCU_TLS(rcu_reader).node);
+	if (caa_unlikely(urcu_stats))
+		urcu_stats_threads(urcu_stats_flavor(URCU_STATS_FLAVOR), -1);
 	mutex_unlock(&rcu_registry_lock);
 }
 
@@ -100,6 +100,12 @@ extern int rcu_read_ongoing(void);
 
 extern void synchronize_rcu(void);
 
+/*
+ * Grace period statistics (struct rcu_gp_stats in urcu-flavor.h).
+ */
+struct rcu_gp_stats;
+extern void rcu_get_gp_stats(struct rcu_gp_stats *stats);
+
 /*
  * Reader thread registration.
  */
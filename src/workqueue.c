@@ -44,6 +44,7 @@
 #include "urcu/tls-compat.h"
 #include "urcu/ref.h"
 #include "urcu-die.h"
+#include "urcu-stats.h"
 
 #include "workqueue.h"
 
@@ -231,6 +232,9 @@ static void *workqueue_thread(void *arg)
 				cbcount++;
 			}
 			uatomic_sub(&workqueue->qlen, cbcount);
+			if (caa_unlikely(urcu_stats))
+				CMM_STORE_SHARED(urcu_stats->workqueue_qlen,
+					uatomic_read(&workqueue->qlen));
 		}
 		if (uatomic_read(&workqueue->flags) & URCU_WORKQUEUE_STOP)
 			break;
@@ -352,7 +356,11 @@ void urcu_workqueue_queue_work(struct urcu_workqueue *workqueue,
 	cds_wfcq_node_init(&work->next);
 	work->func = func;
 	cds_wfcq_enqueue(&workqueue->cbs_head, &workqueue->cbs_tail, &work->next);
-	uatomic_inc(&workqueue->qlen);
+	if (caa_unlikely(urcu_stats))
+		CMM_STORE_SHARED(urcu_stats->workqueue_qlen,
+			uatomic_add_return(&workqueue->qlen, 1));
+	else
+		uatomic_inc(&workqueue->qlen);
 	wake_worker_thread(workqueue);
 }
 
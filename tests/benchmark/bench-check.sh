@@ -0,0 +1,303 @@
+#!/bin/bash
+#
+# Copyright (C) 2026 - The Userspace RCU contributors
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; only version 2
+# of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+
+#
+# Performance regression gate. Run a short fixed set of benchmarks
+# several times, and compare throughput and p99 latency of every run
+# against the runs stored in a baseline file.
+#
+# A metric regresses when both:
+#  - a one-sided Mann-Whitney U test finds the current runs worse than
+#    the baseline runs (p-value below alpha), and
+#  - the median moved in the wrong direction by more than the threshold,
+#    or by more than three times the baseline coefficient of variation
+#    if that is larger.
+#
+# A metric of the baseline missing from the current runs, e.g. because
+# its benchmark crashed, fails the gate too.
+#
+# Baselines depend on the machine: record one with -u on the machine
+# running the gate, and keep it next to the results it guards.
+#
+
+REPEAT=5
+DURATION=1
+BASELINE="bench-baseline.txt"
+UPDATE=0
+TPUT_THRESHOLD=10
+LAT_THRESHOLD=25
+ALPHA=0.05
+VERSION="unknown"
+
+BASELINE_FORMAT=1
+
+# "name:program arguments", %d is replaced by the run duration.
+BENCHMARKS=(
+	"urcu:./test_urcu 2 1 %d -H 64"
+	"urcu_qsbr:./test_urcu_qsbr 2 1 %d -H 64"
+	"urcu_hash:./test_urcu_hash 2 2 %d -A -H 64"
+	"call_rcu:./test_urcu_call_rcu 0 1 %d"
+)
+
+function usage()
+{
+	cat <<EOF
+Usage: $0 [OPTIONS]
+
+Options:
+	-n repeat	runs per benchmark (default: ${REPEAT})
+	-d duration	run duration in seconds (default: ${DURATION})
+	-b file		baseline file (default: ${BASELINE})
+	-u		record the runs as the new baseline instead of comparing
+	-t percent	throughput regression threshold (default: ${TPUT_THRESHOLD})
+	-l percent	latency regression threshold (default: ${LAT_THRESHOLD})
+	-a alpha	significance level of the statistical test (default: ${ALPHA})
+	-V version	liburcu version recorded in the baseline
+EOF
+}
+
+function host_id()
+{
+	echo "$(uname -m) cpus $(getconf _NPROCESSORS_ONLN)"
+}
+
+while getopts "n:d:b:ut:l:a:V:h" opt; do
+	case "${opt}" in
+	n)	REPEAT="${OPTARG}" ;;
+	d)	DURATION="${OPTARG}" ;;
+	b)	BASELINE="${OPTARG}" ;;
+	u)	UPDATE=1 ;;
+	t)	TPUT_THRESHOLD="${OPTARG}" ;;
+	l)	LAT_THRESHOLD="${OPTARG}" ;;
+	a)	ALPHA="${OPTARG}" ;;
+	V)	VERSION="${OPTARG}" ;;
+	h)	usage; exit 0 ;;
+	*)	usage; exit 1 ;;
+	esac
+done
+
+if [ "${UPDATE}" -eq 0 ] && [ ! -f "${BASELINE}" ]; then
+	echo "Error: no baseline ${BASELINE}, record one with $0 -u." >&2
+	exit 1
+fi
+
+RUNS=$(mktemp)
+CURRENT=$(mktemp)
+trap 'rm -f ${RUNS} ${CURRENT}' EXIT
+
+# Collect one "metric direction value" line per metric and run.
+for BENCH in "${BENCHMARKS[@]}"; do
+	NAME="${BENCH%%:*}"
+	CMD=$(printf "${BENCH#*:}" "${DURATION}")
+	for (( RUN = 0; RUN < REPEAT; RUN++ )); do
+		echo "Running ${NAME} run ${RUN}: ${CMD}" >&2
+		if ! ${CMD} > "${CURRENT}"; then
+			echo "Error: ${CMD} failed." >&2
+			exit 1
+		fi
+		awk -v name="${NAME}" '
+		$1 == "SUMMARY" {
+			for (i = 3; i < NF; i += 2)
+				f[$i] = $(i + 1)
+			dur = f["testdur"] > 0 ? f["testdur"] : 1
+			print name ".ops_per_s higher " f["nr_ops"] / dur
+		}
+		$1 == "LATENCY" {
+			for (i = 3; i < NF; i += 2)
+				if ($i == "p99")
+					print name "." $2 ".p99_ns lower " $(i + 1)
+		}' "${CURRENT}" >> "${RUNS}"
+	done
+done
+
+# Gather the runs of each metric on one line, keeping the input order.
+function gather()
+{
+	awk '
+	{
+		if (!($1 in values)) {
+			order[++nr] = $1
+			dir[$1] = $2
+			values[$1] = $3
+		} else {
+			values[$1] = values[$1] " " $3
+		}
+	}
+	END {
+		for (i = 1; i <= nr; i++)
+			print order[i], dir[order[i]], values[order[i]]
+	}' "$1"
+}
+
+if [ "${UPDATE}" -eq 1 ]; then
+	{
+		echo "# liburcu benchmark baseline, see bench-check.sh"
+		echo "format ${BASELINE_FORMAT}"
+		echo "version ${VERSION}"
+		echo "host $(host_id)"
+		echo "duration ${DURATION}"
+		gather "${RUNS}"
+	} > "${BASELINE}"
+	echo "Baseline recorded in ${BASELINE}."
+	exit 0
+fi
+
+if [ "$(awk '$1 == "format" { print $2 }' "${BASELINE}")" != "${BASELINE_FORMAT}" ]; then
+	echo "Error: ${BASELINE} is not a format ${BASELINE_FORMAT} baseline, record a new one with $0 -u." >&2
+	exit 1
+fi
+BASE_HOST=$(awk '$1 == "host" { $1 = ""; print substr($0, 2) }' "${BASELINE}")
+if [ "${BASE_HOST}" != "$(host_id)" ]; then
+	echo "Warning: baseline recorded on \"${BASE_HOST}\", running on \"$(host_id)\"." >&2
+fi
+BASE_DURATION=$(awk '$1 == "duration" { print $2 }' "${BASELINE}")
+if [ "${BASE_DURATION}" != "${DURATION}" ]; then
+	echo "Warning: baseline runs lasted ${BASE_DURATION}s, current runs ${DURATION}s." >&2
+fi
+
+gather "${RUNS}" > "${CURRENT}"
+awk -v tput_thr="${TPUT_THRESHOLD}" \
+	-v lat_thr="${LAT_THRESHOLD}" -v alpha="${ALPHA}" '
+function sort(a, n,	i, j, t) {
+	for (i = 2; i <= n; i++) {
+		t = a[i]
+		for (j = i - 1; j >= 1 && a[j] > t; j--)
+			a[j + 1] = a[j]
+		a[j + 1] = t
+	}
+}
+
+function median(a, n,	b, i) {
+	for (i = 1; i <= n; i++)
+		b[i] = a[i]
+	sort(b, n)
+	return n % 2 ? b[(n + 1) / 2] : (b[n / 2] + b[n / 2 + 1]) / 2
+}
+
+# Standard normal cumulative distribution (Abramowitz and Stegun 26.2.17).
+function phi(z,	t, p) {
+	if (z < 0)
+		return 1 - phi(-z)
+	t = 1 / (1 + 0.2316419 * z)
+	p = t * (0.319381530 + t * (-0.356563782 + t * (1.781477937 \
+		+ t * (-1.821255978 + t * 1.330274429))))
+	return 1 - exp(-z * z / 2) / sqrt(2 * 3.14159265358979) * p
+}
+
+# One-sided p-value of the current runs c being worse than base runs b,
+# with the normal approximation of the Mann-Whitney U distribution.
+function mann_whitney(b, nb, c, nc, higher,	i, j, u, mean, sd, z) {
+	u = 0
+	for (i = 1; i <= nb; i++) {
+		for (j = 1; j <= nc; j++) {
+			if (c[j] == b[i])
+				u += 0.5
+			else if ((higher && c[j] < b[i]) || (!higher && c[j] > b[i]))
+				u++
+		}
+	}
+	mean = nb * nc / 2
+	sd = sqrt(nb * nc * (nb + nc + 1) / 12)
+	if (sd == 0)
+		return 1
+	z = (u - mean - 0.5) / sd
+	return 1 - phi(z)
+}
+
+function cv(a, n,	i, sum, mean, var) {
+	sum = 0
+	for (i = 1; i <= n; i++)
+		sum += a[i]
+	mean = sum / n
+	if (n < 2 || mean == 0)
+		return 0
+	var = 0
+	for (i = 1; i <= n; i++)
+		var += (a[i] - mean) ^ 2
+	return sqrt(var / (n - 1)) / mean * 100
+}
+
+NR == FNR {
+	cur[$1] = $0
+	cur_order[++nr_cur] = $1
+	next
+}
+
+$1 == "format" || $1 == "version" || $1 == "host" || $1 == "duration" || /^#/ {
+	next
+}
+
+{
+	base[$1] = $0
+}
+
+END {
+	printf("%-40s %14s %14s %8s %8s %8s  %s\n", "metric", "baseline",
+		"current", "change%", "limit%", "p-value", "result")
+	failed = 0
+	for (k = 1; k <= nr_cur; k++) {
+		m = cur_order[k]
+		if (!(m in base)) {
+			printf("%-40s %14s %14s %8s %8s %8s  %s\n", m, "-", "-",
+				"-", "-", "-", "new")
+			continue
+		}
+		nc = split(cur[m], c, " ")
+		nb = split(base[m], b, " ")
+		higher = c[2] == "higher"
+		# Drop the metric name and direction.
+		for (i = 3; i <= nc; i++)
+			c[i - 2] = c[i]
+		nc -= 2
+		for (i = 3; i <= nb; i++)
+			b[i - 2] = b[i]
+		nb -= 2
+		mb = median(b, nb)
+		mc = median(c, nc)
+		change = mb ? (mc - mb) / mb * 100 : 0
+		worse = higher ? -change : change
+		limit = higher ? tput_thr : lat_thr
+		if (3 * cv(b, nb) > limit)
+			limit = 3 * cv(b, nb)
+		p = mann_whitney(b, nb, c, nc, higher)
+		if (worse > limit && p < alpha) {
+			result = "REGRESSION"
+			failed++
+		} else if (-worse > limit && mann_whitney(c, nc, b, nb, higher) < alpha) {
+			result = "improved"
+		} else {
+			result = "ok"
+		}
+		printf("%-40s %14.1f %14.1f %8.1f %8.1f %8.4f  %s\n", m, mb, mc,
+			change, limit, p, result)
+		delete base[m]
+	}
+	missing = 0
+	for (m in base) {
+		printf("%-40s %14s %14s %8s %8s %8s  %s\n", m, "-", "-",
+			"-", "-", "-", "MISSING")
+		missing++
+	}
+	if (failed)
+		printf("%d metric(s) regressed.\n", failed)
+	if (missing)
+		printf("%d baseline metric(s) missing from this run.\n", missing)
+	if (failed || missing)
+		exit 1
+}' "${CURRENT}" "${BASELINE}"
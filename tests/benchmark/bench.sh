@@ -0,0 +1,273 @@
+#!/bin/bash
+#
+# Copyright (C) 2026 - The Userspace RCU contributors
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; only version 2
+# of the License.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#
+
+#
+# Run a benchmark program across a matrix of RCU flavors, thread counts
+# and CPU placements, repeat each configuration, and report throughput
+# statistics as JSON or CSV.
+#
+# Any program printing a "SUMMARY <prog> key value key value ..." line
+# and taking "nr_readers nr_writers duration [-a cpu]..." arguments can
+# be driven. "%f" in the workload name is replaced by the flavor
+# program suffix, e.g. test_urcu%f_gc runs test_urcu_mb_gc for the mb
+# flavor. Workloads without "%f" run once per configuration, with
+# flavor "none".
+#
+
+FLAVORS="memb mb signal qsbr bp"
+READERS="1 2 4"
+WRITERS="1"
+PLACEMENTS="none"
+REPEAT=5
+DURATION=2
+FORMAT="json"
+BINDIR="."
+OUTPUT=""
+
+function usage()
+{
+	cat <<EOF
+Usage: $0 [OPTIONS] workload [-- program options]
+
+Options:
+	-f "flavors"	RCU flavors (default: "${FLAVORS}")
+	-r "counts"	reader thread counts (default: "${READERS}")
+	-w "counts"	writer thread counts (default: "${WRITERS}")
+	-p "placements"	CPU placements: none, compact, spread (default: "${PLACEMENTS}")
+	-n repeat	runs per configuration (default: ${REPEAT})
+	-d duration	run duration in seconds (default: ${DURATION})
+	-F format	output format: json or csv (default: ${FORMAT})
+	-B bindir	directory holding the benchmark programs (default: ${BINDIR})
+	-o file		output file (default: standard output)
+
+Placements:
+	none		no affinity
+	compact		one thread per CPU, lowest CPU numbers first
+	spread		one thread every other CPU (e.g. one per SMT core)
+
+Example:
+	$0 -f "memb qsbr" -r "1 2 4 8" -p "compact spread" test_urcu%f -- -c 10
+EOF
+}
+
+function flavor_suffix()
+{
+	case "$1" in
+	memb)	echo "" ;;
+	mb)	echo "_mb" ;;
+	signal)	echo "_signal" ;;
+	qsbr)	echo "_qsbr" ;;
+	bp)	echo "_bp" ;;
+	*)	return 1 ;;
+	esac
+}
+
+# Print the affinity options placing nr_threads threads.
+function placement_opts()
+{
+	local placement=$1 nr_threads=$2 nr_cpus=$3 stride i
+
+	case "${placement}" in
+	none)	return 0 ;;
+	compact) stride=1 ;;
+	spread)	stride=2 ;;
+	*)	return 1 ;;
+	esac
+	for (( i = 0; i < nr_threads; i++ )); do
+		# Wrap around, filling the skipped CPUs on the next pass.
+		echo -n "-a $(( (i * stride + (i * stride / nr_cpus)) % nr_cpus )) "
+	done
+}
+
+while getopts "f:r:w:p:n:d:F:B:o:h" opt; do
+	case "${opt}" in
+	f)	FLAVORS="${OPTARG}" ;;
+	r)	READERS="${OPTARG}" ;;
+	w)	WRITERS="${OPTARG}" ;;
+	p)	PLACEMENTS="${OPTARG}" ;;
+	n)	REPEAT="${OPTARG}" ;;
+	d)	DURATION="${OPTARG}" ;;
+	F)	FORMAT="${OPTARG}" ;;
+	B)	BINDIR="${OPTARG}" ;;
+	o)	OUTPUT="${OPTARG}" ;;
+	h)	usage; exit 0 ;;
+	*)	usage; exit 1 ;;
+	esac
+done
+shift $(( OPTIND - 1 ))
+
+WORKLOAD=$1
+if [ -z "${WORKLOAD}" ]; then
+	usage
+	exit 1
+fi
+shift 1
+if [ "$1" == "--" ]; then
+	shift 1
+fi
+EXTRA_OPTS=("$@")
+
+if [ "${FORMAT}" != "json" ] && [ "${FORMAT}" != "csv" ]; then
+	echo "Error: unknown output format ${FORMAT}." >&2
+	exit 1
+fi
+
+if [[ "${WORKLOAD}" != *%f* ]]; then
+	FLAVORS="none"
+fi
+
+NR_CPUS=$(getconf _NPROCESSORS_ONLN)
+
+RESULTS=$(mktemp)
+trap 'rm -f ${RESULTS}' EXIT
+
+# Collect one line per run: configuration followed by SUMMARY values.
+for FLAVOR in ${FLAVORS}; do
+	if [ "${FLAVOR}" == "none" ]; then
+		PROG="${WORKLOAD}"
+	else
+		if ! SUFFIX=$(flavor_suffix "${FLAVOR}"); then
+			echo "Error: unknown flavor ${FLAVOR}." >&2
+			exit 1
+		fi
+		PROG="${WORKLOAD//%f/${SUFFIX}}"
+	fi
+	if [ ! -x "${BINDIR}/${PROG}" ]; then
+		echo "Skipping flavor ${FLAVOR}: ${BINDIR}/${PROG} not found." >&2
+		continue
+	fi
+	for NR_WRITERS in ${WRITERS}; do
+	for NR_READERS in ${READERS}; do
+	for PLACEMENT in ${PLACEMENTS}; do
+		if ! AFFINITY=$(placement_opts "${PLACEMENT}" \
+				$(( NR_READERS + NR_WRITERS )) "${NR_CPUS}"); then
+			echo "Error: unknown placement ${PLACEMENT}." >&2
+			exit 1
+		fi
+		for (( RUN = 0; RUN < REPEAT; RUN++ )); do
+			echo "Running ${PROG} readers ${NR_READERS} writers ${NR_WRITERS} placement ${PLACEMENT} run ${RUN}" >&2
+			SUMMARY=$("${BINDIR}/${PROG}" "${NR_READERS}" "${NR_WRITERS}" \
+					"${DURATION}" ${AFFINITY} "${EXTRA_OPTS[@]}" \
+					| grep "^SUMMARY")
+			if [ -z "${SUMMARY}" ]; then
+				echo "Error: ${PROG} did not report a SUMMARY line." >&2
+				exit 1
+			fi
+			echo "${WORKLOAD} ${FLAVOR} ${NR_READERS} ${NR_WRITERS} ${PLACEMENT} ${SUMMARY}" >> "${RESULTS}"
+		done
+	done
+	done
+	done
+done
+
+# Aggregate runs of each configuration, keeping the input order.
+awk -v format="${FORMAT}" '
+function sort(a, n,	i, j, t) {
+	for (i = 2; i <= n; i++) {
+		t = a[i]
+		for (j = i - 1; j >= 1 && a[j] > t; j--)
+			a[j + 1] = a[j]
+		a[j + 1] = t
+	}
+}
+
+# Nearest-rank percentile of sorted array a of n elements.
+function pct(a, n, p,	r) {
+	r = int(p * n / 100)
+	if (r < p * n / 100)
+		r++
+	if (r < 1)
+		r = 1
+	return a[r]
+}
+
+function stats(key, metric, sep,	n, i, v, a, sum, mean, var) {
+	n = nr_runs[key]
+	sum = 0
+	for (i = 1; i <= n; i++) {
+		a[i] = val[key, metric, i]
+		sum += a[i]
+	}
+	mean = sum / n
+	var = 0
+	for (i = 1; i <= n; i++)
+		var += (a[i] - mean) ^ 2
+	var = n > 1 ? var / (n - 1) : 0
+	sort(a, n)
+	if (format == "csv")
+		return sprintf("%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f",
+			mean, sqrt(var), a[1], pct(a, n, 50), pct(a, n, 90),
+			pct(a, n, 99), a[n])
+	v = sprintf("\"%s\": { \"mean\": %.1f, \"stddev\": %.1f, \"min\": %.1f, " \
+		"\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f, \"runs\": [",
+		metric, mean, sqrt(var), a[1], pct(a, n, 50), pct(a, n, 90),
+		pct(a, n, 99), a[n])
+	for (i = 1; i <= n; i++)
+		v = v sprintf("%s%.1f", i > 1 ? ", " : "", val[key, metric, i])
+	return v " ] }" sep
+}
+
+{
+	key = $1 " " $2 " " $3 " " $4 " " $5
+	if (!(key in nr_runs)) {
+		order[++nr_keys] = key
+		conf[key] = sprintf("\"workload\": \"%s\", \"flavor\": \"%s\", " \
+			"\"nr_readers\": %s, \"nr_writers\": %s, \"placement\": \"%s\"",
+			$1, $2, $3, $4, $5)
+		csvconf[key] = $1 "," $2 "," $3 "," $4 "," $5
+	}
+	n = ++nr_runs[key]
+	# $6 is SUMMARY, $7 the program name, then key/value pairs.
+	for (i = 8; i < NF; i += 2)
+		f[$i] = $(i + 1)
+	dur = f["testdur"] > 0 ? f["testdur"] : 1
+	val[key, "ops_per_s", n] = f["nr_ops"] / dur
+	val[key, "reads_per_s", n] = f["nr_reads"] / dur
+	val[key, "writes_per_s", n] = f["nr_writes"] / dur
+	delete f
+}
+
+END {
+	if (format == "csv") {
+		hdr = "workload,flavor,nr_readers,nr_writers,placement,runs"
+		split("ops_per_s reads_per_s writes_per_s", m, " ")
+		for (i = 1; i <= 3; i++)
+			hdr = hdr sprintf(",%s_mean,%s_stddev,%s_min,%s_p50,%s_p90,%s_p99,%s_max",
+				m[i], m[i], m[i], m[i], m[i], m[i], m[i])
+		print hdr
+		for (k = 1; k <= nr_keys; k++) {
+			key = order[k]
+			print csvconf[key] "," nr_runs[key] "," \
+				stats(key, "ops_per_s") "," \
+				stats(key, "reads_per_s") "," \
+				stats(key, "writes_per_s")
+		}
+		exit
+	}
+	print "["
+	for (k = 1; k <= nr_keys; k++) {
+		key = order[k]
+		print "  { " conf[key] ", \"runs\": " nr_runs[key] ","
+		print "    " stats(key, "ops_per_s", ",")
+		print "    " stats(key, "reads_per_s", ",")
+		print "    " stats(key, "writes_per_s", "")
+		print "  }" (k < nr_keys ? "," : "")
+	}
+	print "]"
+}' "${RESULTS}" > "${OUTPUT:-/dev/stdout}"
@@ -27,10 +27,10 @@ if [[ ${NUM_CPUS} -lt 4 ]]; then
 fi
 
 # batch: 19 * 1 = 19
-# fraction: 15 * 29 =
-# scalabilit NUM_CPUS * 15
-# reader 15 * 23 =
-NUM_TESTS=$(( 19 + 435 + ( ${NUM_CPUS} * 15 ) + 345 ))
+# fraction: 18 * 29 =
+# scalabilit NUM_CPUS * 18
+# reader 18 * 23 =
+NUM_TESTS=$(( 19 + 522 + ( ${NUM_CPUS} * 18 ) + 414 ))
 
 plan_tests	${NUM_TESTS}
 
@@ -83,7 +83,8 @@ done
 TEST_ARRAY="test_urcu_gc test_urcu_signal_gc test_urcu_mb_gc test_urcu_qsbr_gc
             test_urcu_lgc test_urcu_signal_lgc test_urcu_mb_lgc test_urcu_qsbr_lgc
             test_urcu test_urcu_signal test_urcu_mb test_urcu_qsbr
-            test_rwlock test_perthreadlock test_mutex"
+            test_rwlock test_brlock test_perthreadlock
+            test_perthreadlock_brlock test_mutex test_urcu_hazptr"
 
 #setting gc each 32768. ** UPDATE FOR YOUR ARCHITECTURE BASED ON TEST ABOVE **
 EXTRA_OPTS="${EXTRA_OPTS} -b 32768"
@@ -2,7 +2,7 @@
 
 source ../utils/tap.sh
 
-NUM_TESTS=17
+NUM_TESTS=22
 
 plan_tests      ${NUM_TESTS}
 
@@ -97,6 +97,13 @@ okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A -m 1
 okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A -m 1 -n 1048576 -i \
 	-M 100000000 -N 100000000 -O 100000000 -B mmap ${EXTRA_PARAMS}
 
+# rw test, 2 lookup, 2 update threads, add only, auto resize.
+# max buckets: 1048576
+# key range: init, lookup, and update: 0 to 99999999
+# mm backend: "compact"
+okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A -m 1 -n 1048576 -i \
+	-M 100000000 -N 100000000 -O 100000000 -B compact ${EXTRA_PARAMS}
+
 
 # ** key range tests
 
@@ -109,6 +116,10 @@ okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A -m 1
 okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
 	-R 1000000 ${EXTRA_PARAMS}
 
+# Same lookup misses, filtered by a Bloom filter with 10 bits per node.
+okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
+	-R 1000000 -F 10 ${EXTRA_PARAMS}
+
 # ** small key range
 
 # rw test, 2 lookup, 2 update threads, add and del randomly, auto resize.
@@ -156,3 +167,22 @@ okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
 # create long hash chains: using modulo 4 on keys as hash
 okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
 	-U -C 4 ${EXTRA_PARAMS}
+
+# ** Node allocator
+
+# rw test, 2 lookup, 2 update threads, add_replace and del randomly, auto resize.
+# nodes allocated from a RCU slab cache instead of malloc/call_rcu
+# (compare with the same test without -L for allocation churn)
+okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
+	-s -L ${EXTRA_PARAMS}
+
+# ** YCSB workloads
+
+# workload A: 50% read, 50% update through add_replace, zipfian keys.
+# all threads are clients running the operation mix, auto resize.
+okx ${TESTPROG} 0 $((4*${THREAD_MUL})) ${TIME_UNITS} -A \
+	-Y a ${EXTRA_PARAMS}
+
+# workload E: 95% scan, 5% insert, zipfian keys, 2 extra scan threads.
+okx ${TESTPROG} $((2*${THREAD_MUL})) $((2*${THREAD_MUL})) ${TIME_UNITS} -A \
+	-Y e ${EXTRA_PARAMS}
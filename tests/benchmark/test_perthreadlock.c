@@ -48,11 +48,21 @@ struct test_array {
 	int a;
 };
 
+#ifdef TEST_BRLOCK
+#include <urcu/brlock.h>
+
+/*
+ * Big-reader lock, to compare with the per-thread mutexes on the same
+ * workload. Threads taking it are registered RCU readers.
+ */
+static struct cds_brlock *brlock;
+#else
 struct per_thread_lock {
 	pthread_mutex_t lock;
 } __attribute__((aligned(CAA_CACHE_LINE_SIZE)));	/* cache-line aligned */
 
 static struct per_thread_lock *per_thread_lock;
+#endif
 
 static volatile int test_go, test_stop;
 
@@ -146,6 +156,14 @@ unsigned long long __attribute__((aligned(CAA_CACHE_LINE_SIZE))) *tot_nr_reads;
 static unsigned int nr_readers;
 static unsigned int nr_writers;
 
+#ifdef TEST_BRLOCK
+#define test_lock_register_thread()	rcu_register_thread()
+#define test_lock_unregister_thread()	rcu_unregister_thread()
+#define test_read_lock(tidx, cookie)	((cookie) = cds_brlock_read_lock(brlock))
+#define test_read_unlock(tidx, cookie)	cds_brlock_read_unlock(brlock, cookie)
+#define test_write_lock()		cds_brlock_write_lock(brlock)
+#define test_write_unlock()		cds_brlock_write_unlock(brlock)
+#else
 static void urcu_mutex_lock(pthread_mutex_t *lock)
 {
 	int ret;
@@ -170,14 +188,42 @@ static void urcu_mutex_unlock(pthread_mutex_t *lock)
 	}
 }
 
+#define test_lock_register_thread()
+#define test_lock_unregister_thread()
+#define test_read_lock(tidx, cookie)	\
+	((void) (cookie), urcu_mutex_lock(&per_thread_lock[tidx].lock))
+#define test_read_unlock(tidx, cookie)	\
+	urcu_mutex_unlock(&per_thread_lock[tidx].lock)
+
+static void test_write_lock(void)
+{
+	long tidx;
+
+	for (tidx = 0; tidx < nr_readers; tidx++) {
+		urcu_mutex_lock(&per_thread_lock[tidx].lock);
+	}
+}
+
+static void test_write_unlock(void)
+{
+	long tidx;
+
+	for (tidx = (long)nr_readers - 1; tidx >= 0; tidx--) {
+		urcu_mutex_unlock(&per_thread_lock[tidx].lock);
+	}
+}
+#endif
+
 void *thr_reader(void *data)
 {
 	unsigned long tidx = (unsigned long)data;
+	unsigned int cookie = 0;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
 
 	set_affinity();
+	test_lock_register_thread();
 
 	while (!test_go)
 	{
@@ -186,17 +232,18 @@ void *thr_reader(void *data)
 	for (;;) {
 		int v;
 
-		urcu_mutex_lock(&per_thread_lock[tidx].lock);
+		test_read_lock(tidx, cookie);
 		v = test_array.a;
 		assert(v == 8);
 		if (caa_unlikely(rduration))
 			loop_sleep(rduration);
-		urcu_mutex_unlock(&per_thread_lock[tidx].lock);
+		test_read_unlock(tidx, cookie);
 		URCU_TLS(nr_reads)++;
 		if (caa_unlikely(!test_duration_read()))
 			break;
 	}
 
+	test_lock_unregister_thread();
 	tot_nr_reads[tidx] = URCU_TLS(nr_reads);
 	printf_verbose("thread_end %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
@@ -207,12 +254,12 @@ void *thr_reader(void *data)
 void *thr_writer(void *data)
 {
 	unsigned long wtidx = (unsigned long)data;
-	long tidx;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 
 	set_affinity();
+	test_lock_register_thread();
 
 	while (!test_go)
 	{
@@ -220,16 +267,12 @@ void *thr_writer(void *data)
 	cmm_smp_mb();
 
 	for (;;) {
-		for (tidx = 0; tidx < nr_readers; tidx++) {
-			urcu_mutex_lock(&per_thread_lock[tidx].lock);
-		}
+		test_write_lock();
 		test_array.a = 0;
 		test_array.a = 8;
 		if (caa_unlikely(wduration))
 			loop_sleep(wduration);
-		for (tidx = (long)nr_readers - 1; tidx >= 0; tidx--) {
-			urcu_mutex_unlock(&per_thread_lock[tidx].lock);
-		}
+		test_write_unlock();
 		URCU_TLS(nr_writes)++;
 		if (caa_unlikely(!test_duration_write()))
 			break;
@@ -237,6 +280,8 @@ void *thr_writer(void *data)
 			loop_sleep(wdelay);
 	}
 
+	test_lock_unregister_thread();
+
 	printf_verbose("thread_end %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 	tot_nr_writes[wtidx] = URCU_TLS(nr_writes);
@@ -340,10 +385,16 @@ int main(int argc, char **argv)
 	tid_writer = calloc(nr_writers, sizeof(*tid_writer));
 	tot_nr_reads = calloc(nr_readers, sizeof(*tot_nr_reads));
 	tot_nr_writes = calloc(nr_writers, sizeof(*tot_nr_writes));
+#ifdef TEST_BRLOCK
+	brlock = cds_brlock_new();
+	if (!brlock)
+		exit(1);
+#else
 	per_thread_lock = calloc(nr_readers, sizeof(*per_thread_lock));
 	for (i = 0; i < nr_readers; i++) {
 		pthread_mutex_init(&per_thread_lock[i].lock, NULL);
 	}
+#endif
 
 	next_aff = 0;
 
@@ -394,6 +445,10 @@ int main(int argc, char **argv)
 	free(tid_writer);
 	free(tot_nr_reads);
 	free(tot_nr_writes);
+#ifdef TEST_BRLOCK
+	cds_brlock_destroy(brlock);
+#else
 	free(per_thread_lock);
+#endif
 	return 0;
 }
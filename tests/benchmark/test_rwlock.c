@@ -48,8 +48,29 @@ struct test_array {
 	int a;
 };
 
+#ifdef TEST_BRLOCK
+#include <urcu/brlock.h>
+
+/* Big-reader lock: threads taking it are registered RCU readers. */
+static struct cds_brlock *lock;
+
+#define test_lock_register_thread()	rcu_register_thread()
+#define test_lock_unregister_thread()	rcu_unregister_thread()
+#define test_read_lock(cookie)		((cookie) = cds_brlock_read_lock(lock))
+#define test_read_unlock(cookie)	cds_brlock_read_unlock(lock, cookie)
+#define test_write_lock()		cds_brlock_write_lock(lock)
+#define test_write_unlock()		cds_brlock_write_unlock(lock)
+#else
 pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
 
+#define test_lock_register_thread()
+#define test_lock_unregister_thread()
+#define test_read_lock(cookie)		((void) (cookie), pthread_rwlock_rdlock(&lock))
+#define test_read_unlock(cookie)	pthread_rwlock_unlock(&lock)
+#define test_write_lock()		pthread_rwlock_wrlock(&lock)
+#define test_write_unlock()		pthread_rwlock_unlock(&lock)
+#endif
+
 static volatile int test_go, test_stop;
 
 static unsigned long wdelay;
@@ -162,12 +183,15 @@ void rcu_copy_mutex_unlock(void)
 void *thr_reader(void *_count)
 {
 	unsigned long long *count = _count;
+	unsigned int cookie = 0;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
 
 	set_affinity();
 
+	test_lock_register_thread();
+
 	while (!test_go)
 	{
 	}
@@ -175,17 +199,19 @@ void *thr_reader(void *_count)
 	for (;;) {
 		int a;
 
-		pthread_rwlock_rdlock(&lock);
+		test_read_lock(cookie);
 		a = test_array.a;
 		assert(a == 8);
 		if (caa_unlikely(rduration))
 			loop_sleep(rduration);
-		pthread_rwlock_unlock(&lock);
+		test_read_unlock(cookie);
 		URCU_TLS(nr_reads)++;
 		if (caa_unlikely(!test_duration_read()))
 			break;
 	}
 
+	test_lock_unregister_thread();
+
 	*count = URCU_TLS(nr_reads);
 	printf_verbose("thread_end %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
@@ -202,18 +228,20 @@ void *thr_writer(void *_count)
 
 	set_affinity();
 
+	test_lock_register_thread();
+
 	while (!test_go)
 	{
 	}
 	cmm_smp_mb();
 
 	for (;;) {
-		pthread_rwlock_wrlock(&lock);
+		test_write_lock();
 		test_array.a = 0;
 		test_array.a = 8;
 		if (caa_unlikely(wduration))
 			loop_sleep(wduration);
-		pthread_rwlock_unlock(&lock);
+		test_write_unlock();
 		URCU_TLS(nr_writes)++;
 		if (caa_unlikely(!test_duration_write()))
 			break;
@@ -221,6 +249,8 @@ void *thr_writer(void *_count)
 			loop_sleep(wdelay);
 	}
 
+	test_lock_unregister_thread();
+
 	printf_verbose("thread_end %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 	*count = URCU_TLS(nr_writes);
@@ -328,6 +358,12 @@ int main(int argc, char **argv)
 
 	next_aff = 0;
 
+#ifdef TEST_BRLOCK
+	lock = cds_brlock_new();
+	if (!lock)
+		exit(1);
+#endif
+
 	for (i = 0; i < nr_readers; i++) {
 		err = pthread_create(&tid_reader[i], NULL, thr_reader,
 				     &count_reader[i]);
@@ -371,6 +407,9 @@ int main(int argc, char **argv)
 		nr_writers, wdelay, tot_reads, tot_writes,
 		tot_reads + tot_writes);
 
+#ifdef TEST_BRLOCK
+	cds_brlock_destroy(lock);
+#endif
 	free(tid_reader);
 	free(tid_writer);
 	free(count_reader);
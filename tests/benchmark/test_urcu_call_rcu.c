@@ -0,0 +1,589 @@
+/*
+ * test_urcu_call_rcu.c
+ *
+ * Userspace RCU library - test program, call_rcu throughput and
+ * callback latency
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Writers (producers) allocate objects and hand them to call_rcu(),
+ * either as fast as possible or at a fixed rate, while readers run
+ * read-side critical sections. Callbacks are queued on the default
+ * call_rcu worker, on per-CPU workers or on one worker per producer.
+ *
+ * One call_rcu() every "-H period" is timed (enqueue cost), and its
+ * object carries its enqueue time so the callback can record the
+ * enqueue-to-invocation delay. The main thread samples the number of
+ * pending callbacks every millisecond to report the peak queue length
+ * and memory, and times the final rcu_barrier().
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <urcu/arch.h>
+#include <urcu/tls-compat.h>
+#include "cpuset.h"
+#include "thread-id.h"
+#include "histogram.h"
+
+/* hardcoded number of CPUs */
+#define NR_CPUS 16384
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+
+enum crdp_mode {
+	CRDP_MODE_DEFAULT,
+	CRDP_MODE_CPU,
+	CRDP_MODE_THREAD,
+};
+
+static const char *crdp_mode_str[] = {
+	[CRDP_MODE_DEFAULT] = "default",
+	[CRDP_MODE_CPU] = "cpu",
+	[CRDP_MODE_THREAD] = "thread",
+};
+
+struct test_obj {
+	struct rcu_head head;
+	uint64_t enqueue_ns;	/* 0 if not sampled */
+	unsigned char payload[];
+};
+
+/* Per-producer counter, read by the main thread. */
+struct producer_count {
+	unsigned long long enqueued;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+/* Per call_rcu worker statistics, allocated by its first callback. */
+struct worker_stats {
+	unsigned long long invoked;
+	struct urcu_hist hist;
+	struct worker_stats *next;
+} __attribute__((aligned(CAA_CACHE_LINE_SIZE)));
+
+static volatile int test_go, test_stop;
+
+static unsigned long duration;
+
+static enum crdp_mode crdp_mode = CRDP_MODE_DEFAULT;
+
+/* callbacks per second per producer, 0 for unbounded */
+static unsigned long rate;
+
+/* object payload size, in bytes */
+static size_t payload_size;
+
+/* latency sampling period (power of two), 0 to disable */
+static unsigned long hist_period = 64;
+static struct urcu_hist enqueue_hist;
+
+/* read-side C.S. duration, in loops */
+static unsigned long rduration;
+
+static struct producer_count *producer_counts;
+
+static pthread_mutex_t worker_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct worker_stats *worker_stats_list;
+static DEFINE_URCU_TLS(struct worker_stats *, worker_stats);
+
+static inline void loop_sleep(unsigned long loops)
+{
+	while (loops-- != 0)
+		caa_cpu_relax();
+}
+
+static int verbose_mode;
+
+#define printf_verbose(fmt, args...)		\
+	do {					\
+		if (verbose_mode)		\
+			printf(fmt, args);	\
+	} while (0)
+
+static unsigned int cpu_affinities[NR_CPUS];
+static unsigned int next_aff = 0;
+static int use_affinity = 0;
+
+pthread_mutex_t affinity_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void set_affinity(void)
+{
+#if HAVE_SCHED_SETAFFINITY
+	cpu_set_t mask;
+	int cpu, ret;
+#endif /* HAVE_SCHED_SETAFFINITY */
+
+	if (!use_affinity)
+		return;
+
+#if HAVE_SCHED_SETAFFINITY
+	ret = pthread_mutex_lock(&affinity_mutex);
+	if (ret) {
+		perror("Error in pthread mutex lock");
+		exit(-1);
+	}
+	cpu = cpu_affinities[next_aff++];
+	ret = pthread_mutex_unlock(&affinity_mutex);
+	if (ret) {
+		perror("Error in pthread mutex unlock");
+		exit(-1);
+	}
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+#if SCHED_SETAFFINITY_ARGS == 2
+	sched_setaffinity(0, &mask);
+#else
+	sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+#endif /* HAVE_SCHED_SETAFFINITY */
+}
+
+static DEFINE_URCU_TLS(unsigned long long, nr_reads);
+
+static unsigned int nr_readers;
+static unsigned int nr_writers;
+
+static
+struct worker_stats *get_worker_stats(void)
+{
+	struct worker_stats *ws = URCU_TLS(worker_stats);
+	int ret;
+
+	if (caa_likely(ws))
+		return ws;
+	ret = posix_memalign((void **) &ws, CAA_CACHE_LINE_SIZE, sizeof(*ws));
+	if (ret) {
+		errno = ret;
+		perror("posix_memalign");
+		exit(-1);
+	}
+	memset(ws, 0, sizeof(*ws));
+	ret = pthread_mutex_lock(&worker_stats_mutex);
+	if (ret) {
+		perror("Error in pthread mutex lock");
+		exit(-1);
+	}
+	ws->next = worker_stats_list;
+	worker_stats_list = ws;
+	ret = pthread_mutex_unlock(&worker_stats_mutex);
+	if (ret) {
+		perror("Error in pthread mutex unlock");
+		exit(-1);
+	}
+	URCU_TLS(worker_stats) = ws;
+	return ws;
+}
+
+static
+void free_obj_cb(struct rcu_head *head)
+{
+	struct test_obj *obj = caa_container_of(head, struct test_obj, head);
+	struct worker_stats *ws = get_worker_stats();
+
+	if (obj->enqueue_ns)
+		urcu_hist_record(&ws->hist, urcu_hist_now() - obj->enqueue_ns);
+	free(obj);
+	CMM_STORE_SHARED(ws->invoked, ws->invoked + 1);
+}
+
+static
+unsigned long long sum_enqueued(void)
+{
+	unsigned long long sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < nr_writers; i++)
+		sum += CMM_LOAD_SHARED(producer_counts[i].enqueued);
+	return sum;
+}
+
+static
+unsigned long long sum_invoked(void)
+{
+	struct worker_stats *ws;
+	unsigned long long sum = 0;
+
+	pthread_mutex_lock(&worker_stats_mutex);
+	for (ws = worker_stats_list; ws; ws = ws->next)
+		sum += CMM_LOAD_SHARED(ws->invoked);
+	pthread_mutex_unlock(&worker_stats_mutex);
+	return sum;
+}
+
+/* Wait until absolute CLOCK_MONOTONIC time "deadline" (ns). */
+static
+void wait_until(uint64_t deadline)
+{
+	struct timespec ts;
+
+	ts.tv_sec = deadline / 1000000000ULL;
+	ts.tv_nsec = deadline % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+			== EINTR)
+		;
+}
+
+void *thr_reader(void *_count)
+{
+	unsigned long long *count = _count;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+
+	set_affinity();
+
+	rcu_register_thread();
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+
+	for (;;) {
+		rcu_read_lock();
+		if (caa_unlikely(rduration))
+			loop_sleep(rduration);
+		rcu_read_unlock();
+		URCU_TLS(nr_reads)++;
+		if (caa_unlikely(test_stop))
+			break;
+	}
+
+	rcu_unregister_thread();
+
+	*count = URCU_TLS(nr_reads);
+	printf_verbose("thread_end %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+	return ((void*)1);
+}
+
+void *thr_writer(void *_count)
+{
+	struct producer_count *count = _count;
+	struct call_rcu_data *crdp = NULL;
+	struct urcu_hist *hist = NULL;
+	unsigned long long nr = 0;
+	uint64_t period_ns = 0, deadline = 0, start = 0;
+	struct test_obj *obj;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
+	set_affinity();
+
+	rcu_register_thread();
+
+	if (crdp_mode == CRDP_MODE_THREAD) {
+		crdp = create_call_rcu_data(0, -1);
+		if (!crdp) {
+			printf("Error creating call_rcu data.\n");
+			exit(-1);
+		}
+		set_thread_call_rcu_data(crdp);
+	}
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+
+	if (rate) {
+		period_ns = 1000000000ULL / rate;
+		deadline = urcu_hist_now();
+	}
+	for (;;) {
+		int sample = urcu_hist_sample(hist_period, nr);
+
+		obj = malloc(sizeof(*obj) + payload_size);
+		assert(obj);
+		obj->enqueue_ns = 0;
+		if (sample) {
+			start = urcu_hist_now();
+			obj->enqueue_ns = start;
+		}
+		call_rcu(&obj->head, free_obj_cb);
+		if (sample)
+			urcu_hist_record(hist, urcu_hist_now() - start);
+		CMM_STORE_SHARED(count->enqueued, ++nr);
+		if (caa_unlikely(test_stop))
+			break;
+		if (rate) {
+			deadline += period_ns;
+			wait_until(deadline);
+		}
+	}
+
+	if (crdp) {
+		/* Pending callbacks are moved to the default worker. */
+		set_thread_call_rcu_data(NULL);
+		call_rcu_data_free(crdp);
+	}
+
+	rcu_unregister_thread();
+
+	if (hist) {
+		urcu_hist_merge(&enqueue_hist, hist);
+		free(hist);
+	}
+	printf_verbose("thread_end %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+	return ((void*)2);
+}
+
+void show_usage(int argc, char **argv)
+{
+	printf("Usage : %s nr_readers nr_writers duration (s) <OPTIONS>\n",
+		argv[0]);
+	printf("OPTIONS:\n");
+	printf("	[-m default|cpu|thread] (call_rcu worker: default, per-CPU, per writer)\n");
+	printf("	[-R rate] (call_rcu per second per writer, default: unbounded)\n");
+	printf("	[-s size] (object payload size in bytes)\n");
+	printf("	[-c duration] (reader C.S. duration (in loops))\n");
+	printf("	[-H period] (latency sampling period, 0 to disable, default: 64)\n");
+	printf("	[-v] (verbose output)\n");
+	printf("	[-a cpu#] [-a cpu#]... (affinity)\n");
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	int err;
+	pthread_t *tid_reader, *tid_writer;
+	void *tret;
+	unsigned long long *count_reader;
+	unsigned long long tot_reads = 0, tot_writes, pending, peak_pending = 0;
+	struct urcu_hist callback_hist;
+	struct worker_stats *ws;
+	uint64_t barrier_start, barrier_ns, end;
+	int i, a;
+
+	if (argc < 4) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	err = sscanf(argv[1], "%u", &nr_readers);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	err = sscanf(argv[2], "%u", &nr_writers);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	err = sscanf(argv[3], "%lu", &duration);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	for (i = 4; i < argc; i++) {
+		if (argv[i][0] != '-')
+			continue;
+		switch (argv[i][1]) {
+		case 'a':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			a = atoi(argv[++i]);
+			cpu_affinities[next_aff++] = a;
+			use_affinity = 1;
+			printf_verbose("Adding CPU %d affinity\n", a);
+			break;
+		case 'c':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			rduration = atol(argv[++i]);
+			break;
+		case 'm':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			i++;
+			if (!strcmp(argv[i], "default")) {
+				crdp_mode = CRDP_MODE_DEFAULT;
+			} else if (!strcmp(argv[i], "cpu")) {
+				crdp_mode = CRDP_MODE_CPU;
+			} else if (!strcmp(argv[i], "thread")) {
+				crdp_mode = CRDP_MODE_THREAD;
+			} else {
+				show_usage(argc, argv);
+				return -1;
+			}
+			break;
+		case 'R':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			rate = strtoul(argv[++i], NULL, 0);
+			break;
+		case 's':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			payload_size = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'H':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			hist_period = urcu_hist_parse_period(argv[++i]);
+			break;
+		case 'v':
+			verbose_mode = 1;
+			break;
+		}
+	}
+
+	printf_verbose("running test for %lu seconds, %u readers, %u writers.\n",
+		duration, nr_readers, nr_writers);
+	printf_verbose("call_rcu worker : %s, rate : %lu.\n",
+		crdp_mode_str[crdp_mode], rate);
+	printf_verbose("thread %-6s, tid %lu\n",
+			"main", urcu_get_thread_id());
+
+	if (crdp_mode == CRDP_MODE_CPU && create_all_cpu_call_rcu_data(0)) {
+		perror("create_all_cpu_call_rcu_data");
+		return -1;
+	}
+
+	tid_reader = calloc(nr_readers, sizeof(*tid_reader));
+	tid_writer = calloc(nr_writers, sizeof(*tid_writer));
+	count_reader = calloc(nr_readers, sizeof(*count_reader));
+	err = posix_memalign((void **) &producer_counts, CAA_CACHE_LINE_SIZE,
+			nr_writers * sizeof(*producer_counts));
+	if (err) {
+		errno = err;
+		perror("posix_memalign");
+		return -1;
+	}
+	memset(producer_counts, 0, nr_writers * sizeof(*producer_counts));
+
+	next_aff = 0;
+
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_create(&tid_reader[i], NULL, thr_reader,
+				     &count_reader[i]);
+		if (err != 0)
+			exit(1);
+	}
+	for (i = 0; i < nr_writers; i++) {
+		err = pthread_create(&tid_writer[i], NULL, thr_writer,
+				     &producer_counts[i]);
+		if (err != 0)
+			exit(1);
+	}
+
+	rcu_register_thread();
+
+	cmm_smp_mb();
+
+	test_go = 1;
+
+	/* Sample the number of pending callbacks every millisecond. */
+	end = urcu_hist_now() + (uint64_t) duration * 1000000000ULL;
+	while (urcu_hist_now() < end) {
+		/* Read invocations first: pending is never underestimated. */
+		pending = sum_invoked();
+		pending = sum_enqueued() - pending;
+		if (pending > peak_pending)
+			peak_pending = pending;
+		(void) poll(NULL, 0, 1);
+	}
+
+	test_stop = 1;
+
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_join(tid_reader[i], &tret);
+		if (err != 0)
+			exit(1);
+		tot_reads += count_reader[i];
+	}
+	for (i = 0; i < nr_writers; i++) {
+		err = pthread_join(tid_writer[i], &tret);
+		if (err != 0)
+			exit(1);
+	}
+	tot_writes = sum_enqueued();
+
+	pending = tot_writes - sum_invoked();
+	barrier_start = urcu_hist_now();
+	rcu_barrier();
+	barrier_ns = urcu_hist_now() - barrier_start;
+
+	rcu_unregister_thread();
+
+	memset(&callback_hist, 0, sizeof(callback_hist));
+	for (ws = worker_stats_list; ws; ws = ws->next)
+		urcu_hist_merge(&callback_hist, &ws->hist);
+
+	printf("SUMMARY %-25s testdur %4lu nr_readers %3u rdur %6lu "
+		"nr_writers %3u mode %-7s rate %8lu "
+		"nr_reads %12llu nr_writes %12llu nr_ops %12llu\n",
+		argv[0], duration, nr_readers, rduration, nr_writers,
+		crdp_mode_str[crdp_mode], rate, tot_reads, tot_writes,
+		tot_reads + tot_writes);
+	if (hist_period) {
+		urcu_hist_print("call_rcu", &enqueue_hist);
+		urcu_hist_print("callback_delay", &callback_hist);
+	}
+	printf("CALLRCU peak_pending %12llu peak_bytes %14llu "
+		"barrier_pending %12llu barrier_us %12.1f invoked %12llu\n",
+		peak_pending,
+		peak_pending * (unsigned long long) (sizeof(struct test_obj)
+			+ payload_size),
+		pending, (double) barrier_ns / 1000, sum_invoked());
+
+	if (crdp_mode == CRDP_MODE_CPU)
+		free_all_cpu_call_rcu_data();
+	while (worker_stats_list) {
+		ws = worker_stats_list;
+		worker_stats_list = ws->next;
+		free(ws);
+	}
+	free(tid_reader);
+	free(tid_writer);
+	free(count_reader);
+	free(producer_counts);
+	return 0;
+}
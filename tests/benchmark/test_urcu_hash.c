@@ -25,6 +25,7 @@
 enum test_hash {
 	TEST_HASH_RW,
 	TEST_HASH_UNIQUE,
+	TEST_HASH_YCSB,
 };
 
 struct test_hash_cb {
@@ -51,6 +52,13 @@ struct test_hash_cb test_hash_cb[] = {
 		test_hash_unique_thr_writer,
 		test_hash_unique_populate_hash,
 	},
+	[TEST_HASH_YCSB] = {
+		test_hash_ycsb_sigusr1_handler,
+		test_hash_rw_sigusr2_handler,
+		test_hash_ycsb_thr_reader,
+		test_hash_ycsb_thr_writer,
+		test_hash_ycsb_populate_hash,
+	},
 
 };
 
@@ -100,13 +108,24 @@ unsigned long duration;
 /* read-side C.S. duration, in loops */
 unsigned long rduration;
 
+/* latency sampling period (power of two), 0 to disable */
+unsigned long hist_period;
+struct urcu_hist lookup_hist, add_hist, del_hist;
+
+/* hardware counters, if URCU_BENCH_PERF is set */
+struct urcu_perf_totals read_perf = URCU_PERF_TOTALS_INIT,
+	write_perf = URCU_PERF_TOTALS_INIT;
+
 unsigned long init_hash_size = DEFAULT_HASH_SIZE;
 unsigned long min_hash_alloc_size = DEFAULT_MIN_ALLOC_SIZE;
 unsigned long max_hash_buckets_size = (1UL << 20);
 unsigned long init_populate;
 int opt_auto_resize;
+unsigned int bloom_bits;		/* 0: no Bloom filter */
 int add_only, add_unique, add_replace;
 const struct cds_lfht_mm_type *memory_backend;
+struct cds_slab_cache *node_cache;	/* NULL: use malloc */
+unsigned long node_payload_size;	/* bytes following each node */
 
 unsigned long init_pool_offset, lookup_pool_offset, write_pool_offset;
 unsigned long init_pool_size = DEFAULT_RAND_POOL,
@@ -245,6 +264,30 @@ void free_node_cb(struct rcu_head *head)
 	free(node);
 }
 
+struct lfht_test_node *test_node_alloc(void)
+{
+	if (node_cache)
+		return cds_slab_alloc(node_cache);
+	return malloc(sizeof(struct lfht_test_node) + node_payload_size);
+}
+
+/* Free a node which was never published in the hash table. */
+void test_node_free(struct lfht_test_node *node)
+{
+	if (node_cache)
+		cds_slab_free(node_cache, node);
+	else
+		free(node);
+}
+
+void test_node_free_rcu(struct lfht_test_node *node)
+{
+	if (node_cache)
+		cds_slab_free_rcu(node_cache, node);
+	else
+		call_rcu(&node->head, free_node_cb);
+}
+
 static
 void test_delete_all_nodes(struct cds_lfht *ht)
 {
@@ -257,7 +300,7 @@ void test_delete_all_nodes(struct cds_lfht *ht)
 
 		ret = cds_lfht_del(test_ht, cds_lfht_iter_get_node(&iter));
 		assert(!ret);
-		call_rcu(&node->head, free_node_cb);
+		test_node_free_rcu(node);
 		count++;
 	}
 	printf("deleted %lu nodes.\n", count);
@@ -282,7 +325,7 @@ printf("        [not -u nor -s] Add entries (supports redundant keys).\n");
 	printf("        [-i] Add only (no removal).\n");
 	printf("        [-k nr_nodes] Number of nodes to insert initially.\n");
 	printf("        [-A] Automatically resize hash table.\n");
-	printf("        [-B order|chunk|mmap] Specify the memory backend.\n");
+	printf("        [-B order|chunk|mmap|compact] Specify the memory backend.\n");
 	printf("        [-R offset] Lookup pool offset.\n");
 	printf("        [-S offset] Write pool offset.\n");
 	printf("        [-T offset] Init pool offset.\n");
@@ -294,6 +337,13 @@ printf("        [not -u nor -s] Add entries (supports redundant keys).\n");
 	printf("		with different write range)\n");
 	printf("	[-U] Uniqueness test.\n");
 	printf("	[-C] Number of hash chains.\n");
+	printf("	[-L] Allocate nodes from a RCU slab cache.\n");
+	printf("	[-H period] Sample operation latency every period operations.\n");
+	printf("	[-Y a|b|c|d|e|f] YCSB workload (-k: record count).\n");
+	printf("	[-D uniform|zipfian|latest|hotspot] YCSB key distribution.\n");
+	printf("	[-K size] YCSB key size (bytes).\n");
+	printf("	[-E size] YCSB value size (bytes).\n");
+	printf("	[-F bits] Bloom filter bits per node (lookup misses).\n");
 	printf("\n");
 }
 
@@ -305,7 +355,8 @@ int main(int argc, char **argv)
 	unsigned long long *count_reader;
 	struct wr_count *count_writer;
 	unsigned long long tot_reads = 0, tot_writes = 0,
-		tot_add = 0, tot_add_exist = 0, tot_remove = 0;
+		tot_add = 0, tot_add_exist = 0, tot_remove = 0,
+		tot_writer_ops = 0;
 	unsigned long count;
 	long approx_before, approx_after;
 	int i, a, ret, err, mainret = 0;
@@ -313,6 +364,7 @@ int main(int argc, char **argv)
 	unsigned int remain;
 	unsigned int nr_readers_created = 0, nr_writers_created = 0;
 	long long nr_leaked;
+	int use_node_cache = 0;
 
 	if (argc < 4) {
 		show_usage(argc, argv);
@@ -441,8 +493,10 @@ int main(int argc, char **argv)
 				memory_backend = &cds_lfht_mm_chunk;
 			else if (!strcmp("mmap", argv[i]))
 				memory_backend = &cds_lfht_mm_mmap;
+			else if (!strcmp("compact", argv[i]))
+				memory_backend = &cds_lfht_mm_mmap_compact;
 			else {
-				printf("Please specify memory backend with order|chunk|mmap.\n");
+				printf("Please specify memory backend with order|chunk|mmap|compact.\n");
 				mainret = 1;
 				goto end;
 			}
@@ -474,9 +528,67 @@ int main(int argc, char **argv)
 		case 'C':
 			nr_hash_chains = atol(argv[++i]);
 			break;
+		case 'L':
+			use_node_cache = 1;
+			break;
+		case 'H':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			hist_period = urcu_hist_parse_period(argv[++i]);
+			break;
+		case 'Y':
+			if (argc < i + 2
+					|| test_hash_ycsb_set_workload(argv[++i])) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			test_choice = TEST_HASH_YCSB;
+			break;
+		case 'D':
+			if (argc < i + 2
+					|| test_hash_ycsb_set_dist(argv[++i])) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			break;
+		case 'K':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			if (test_hash_ycsb_set_key_size(atol(argv[++i]))) {
+				mainret = 1;
+				goto end;
+			}
+			break;
+		case 'E':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			value_size = atol(argv[++i]);
+			break;
+		case 'F':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				mainret = 1;
+				goto end;
+			}
+			bloom_bits = atol(argv[++i]);
+			break;
 		}
 	}
 
+	if (test_choice == TEST_HASH_YCSB)
+		node_payload_size = key_size + value_size;
+
 	/* Check if hash size is power of 2 */
 	if (init_hash_size && init_hash_size & (init_hash_size - 1)) {
 		printf("Error: Initial number of buckets (%lu) is not a power of 2.\n",
@@ -542,6 +654,9 @@ int main(int argc, char **argv)
 		write_pool_offset, write_pool_size);
 	printf_verbose("Number of hash chains: %lu.\n",
 		nr_hash_chains);
+	printf_verbose("Node allocator: %s.\n",
+		use_node_cache ? "slab" : "malloc");
+	printf_verbose("Bloom filter: %u bits per node.\n", bloom_bits);
 	printf_verbose("thread %-6s, tid %lu\n",
 			"main", urcu_get_thread_id());
 
@@ -571,6 +686,16 @@ int main(int argc, char **argv)
 		printf("Per-CPU call_rcu() worker threads unavailable. Using default global worker thread.\n");
 	}
 
+	if (use_node_cache) {
+		node_cache = cds_slab_cache_create(sizeof(struct lfht_test_node)
+				+ node_payload_size, 0, 0, NULL);
+		if (!node_cache) {
+			printf("Error allocating node slab cache.\n");
+			mainret = 1;
+			goto end_free_call_rcu_data;
+		}
+	}
+
 	if (memory_backend) {
 		test_ht = _cds_lfht_new(init_hash_size, min_hash_alloc_size,
 				max_hash_buckets_size,
@@ -586,7 +711,7 @@ int main(int argc, char **argv)
 	if (!test_ht) {
 		printf("Error allocating hash table.\n");
 		mainret = 1;
-		goto end_free_call_rcu_data;
+		goto end_destroy_node_cache;
 	}
 
 	/*
@@ -594,6 +719,15 @@ int main(int argc, char **argv)
 	 * thread from the point of view of resize.
 	 */
 	rcu_register_thread();
+	if (bloom_bits && cds_lfht_bloom_enable(test_ht, bloom_bits, 0)) {
+		printf("Error enabling Bloom filter (%u bits per node).\n",
+			bloom_bits);
+		ret = cds_lfht_destroy(test_ht, NULL);
+		assert(!ret);
+		rcu_unregister_thread();
+		mainret = 1;
+		goto end_destroy_node_cache;
+	}
 	ret = (get_populate_hash_cb())();
 	assert(!ret);
 
@@ -601,6 +735,9 @@ int main(int argc, char **argv)
 
 	next_aff = 0;
 
+	urcu_perf_init(&read_perf);
+	urcu_perf_init(&write_perf);
+
 	ret = pipe(count_pipe);
 	if (ret == -1) {
 		perror("pipe");
@@ -672,6 +809,9 @@ end_pthread_join:
 			perror("pthread_join");
 		}
 		tot_writes += count_writer[i].update_ops;
+		tot_reads += count_writer[i].read_ops;
+		tot_writer_ops += count_writer[i].update_ops
+			+ count_writer[i].read_ops;
 		tot_add += count_writer[i].add;
 		tot_add_exist += count_writer[i].add_exist;
 		tot_remove += count_writer[i].remove;
@@ -746,12 +886,27 @@ end_online:
 		nr_writers, wdelay, tot_reads, tot_writes,
 		tot_reads + tot_writes, tot_add, tot_add_exist, tot_remove,
 		nr_leaked);
+	urcu_perf_print("reader", &read_perf, nr_readers_created,
+		tot_reads - (tot_writer_ops - tot_writes));
+	urcu_perf_print("writer", &write_perf, nr_writers_created,
+		tot_writer_ops);
+	if (hist_period) {
+		if (lookup_hist.count)
+			urcu_hist_print("lookup", &lookup_hist);
+		if (add_hist.count)
+			urcu_hist_print("add", &add_hist);
+		if (del_hist.count)
+			urcu_hist_print("del", &del_hist);
+	}
 	if (nr_leaked != 0) {
 		mainret = 1;
 		printf("WARNING: %lld nodes were leaked!\n", nr_leaked);
 	}
 
 	rcu_unregister_thread();
+end_destroy_node_cache:
+	if (node_cache)
+		cds_slab_cache_destroy(node_cache);
 end_free_call_rcu_data:
 	free_all_cpu_call_rcu_data();
 	free(count_writer);
@@ -39,6 +39,8 @@
 #include <compat-rand.h>
 #include "cpuset.h"
 #include "thread-id.h"
+#include "histogram.h"
+#include "perf-counters.h"
 #include "../common/debug-yield.h"
 
 #define DEFAULT_HASH_SIZE	32
@@ -73,10 +75,12 @@
 #endif
 #include <urcu-qsbr.h>
 #include <urcu/rculfhash.h>
+#include <urcu/rcuslab.h>
 #include <urcu-call-rcu.h>
 
 struct wr_count {
 	unsigned long update_ops;
+	unsigned long read_ops;		/* lookups done by update threads */
 	unsigned long add;
 	unsigned long add_exist;
 	unsigned long remove;
@@ -103,6 +107,7 @@ struct lfht_test_node {
 	unsigned int key_len;
 	/* cache-cold for iteration */
 	struct rcu_head head;
+	unsigned char payload[];	/* node_payload_size bytes */
 };
 
 static inline struct lfht_test_node *
@@ -135,6 +140,11 @@ extern unsigned long duration;
 /* read-side C.S. duration, in loops */
 extern unsigned long rduration;
 
+extern unsigned long hist_period;
+extern struct urcu_hist lookup_hist, add_hist, del_hist;
+
+extern struct urcu_perf_totals read_perf, write_perf;
+
 extern unsigned long init_hash_size;
 extern unsigned long min_hash_alloc_size;
 extern unsigned long max_hash_buckets_size;
@@ -142,6 +152,7 @@ extern unsigned long init_populate;
 extern int opt_auto_resize;
 extern int add_only, add_unique, add_replace;
 extern const struct cds_lfht_mm_type *memory_backend;
+extern unsigned long node_payload_size;
 
 extern unsigned long init_pool_offset, lookup_pool_offset, write_pool_offset;
 extern unsigned long init_pool_size,
@@ -374,6 +385,11 @@ void cds_lfht_test_lookup(struct cds_lfht *ht, void *key, size_t key_len,
 
 void free_node_cb(struct rcu_head *head);
 
+/* Node allocation, from malloc or from the slab cache (-L). */
+struct lfht_test_node *test_node_alloc(void);
+void test_node_free(struct lfht_test_node *node);
+void test_node_free_rcu(struct lfht_test_node *node);
+
 /* rw test */
 void test_hash_rw_sigusr1_handler(int signo);
 void test_hash_rw_sigusr2_handler(int signo);
@@ -388,4 +404,14 @@ void *test_hash_unique_thr_reader(void *_count);
 void *test_hash_unique_thr_writer(void *_count);
 int test_hash_unique_populate_hash(void);
 
+/* ycsb test */
+extern unsigned long key_size, value_size;
+int test_hash_ycsb_set_workload(const char *name);
+int test_hash_ycsb_set_dist(const char *name);
+int test_hash_ycsb_set_key_size(unsigned long size);
+void test_hash_ycsb_sigusr1_handler(int signo);
+void *test_hash_ycsb_thr_reader(void *_count);
+void *test_hash_ycsb_thr_writer(void *_count);
+int test_hash_ycsb_populate_hash(void);
+
 #endif /* _TEST_URCU_HASH_H */
@@ -0,0 +1,336 @@
+/*
+ * test_urcu_hash_footprint.c
+ *
+ * Userspace RCU library - test program, memory footprint of the hash
+ * table bucket memory backends
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Grow a table one order at a time up to the number of entries, filling
+ * it to one entry per bucket before each doubling, then delete all
+ * entries and shrink it back one order at a time. After each step,
+ * print a "FOOTPRINT" line with the table size, the resize time, the
+ * resident set size, the bucket table bytes, the bytes per entry and
+ * the page faults taken by the step.
+ *
+ * Bucket table bytes are the allocated buckets (never fewer than the
+ * effective min_nr_alloc_buckets) times the bucket size. The resident
+ * set size includes the nodes: freeing memory back to malloc does not
+ * necessarily return it to the system, whereas the mmap backend
+ * discards the pages of shrunk bucket table orders.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+#include "histogram.h"
+#include "lfht-test-node.h"
+
+struct footprint_node {
+	struct test_node tnode;
+	unsigned char payload[];
+};
+
+struct footprint_sample {
+	long rss_kb;
+	long minflt, majflt;
+};
+
+static const char *backend = "order";
+static unsigned long nr_entries = 1UL << 20;
+static unsigned long min_nr_alloc_buckets = 1;
+static unsigned long max_nr_buckets;
+static size_t payload_size;
+static size_t node_size;
+
+/* Resident set size in kB, -1 if unknown. */
+static
+long read_rss_kb(void)
+{
+	unsigned long size, resident;
+	FILE *fp;
+	int ret;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (!fp)
+		return -1;
+	ret = fscanf(fp, "%lu %lu", &size, &resident);
+	fclose(fp);
+	if (ret != 2)
+		return -1;
+	return (long) (resident * (sysconf(_SC_PAGESIZE) / 1024));
+}
+
+static
+void take_sample(struct footprint_sample *s)
+{
+	struct rusage usage;
+
+	s->rss_kb = read_rss_kb();
+	if (getrusage(RUSAGE_SELF, &usage)) {
+		perror("getrusage");
+		exit(-1);
+	}
+	s->minflt = usage.ru_minflt;
+	s->majflt = usage.ru_majflt;
+}
+
+static
+unsigned long table_size(struct cds_lfht *ht)
+{
+	unsigned long size, nr_alloc;
+	size_t bucket_node_size;
+
+	cds_lfht_get_buckets(ht, &size, &nr_alloc, &bucket_node_size);
+	return size;
+}
+
+static
+void print_step(const char *phase, struct cds_lfht *ht,
+		unsigned long entries, uint64_t time_ns,
+		const struct footprint_sample *base,
+		const struct footprint_sample *prev,
+		struct footprint_sample *cur)
+{
+	unsigned long size = 0, nr_alloc = 0, bucket_bytes;
+	size_t bucket_node_size = 0;
+	double per_entry = 0;
+
+	take_sample(cur);
+	if (ht)
+		cds_lfht_get_buckets(ht, &size, &nr_alloc, &bucket_node_size);
+	bucket_bytes = nr_alloc * bucket_node_size;
+	if (entries && cur->rss_kb >= 0 && base->rss_kb >= 0)
+		per_entry = (double) (cur->rss_kb - base->rss_kb) * 1024
+			/ entries;
+	printf("FOOTPRINT %-7s backend %-5s buckets %10lu entries %10lu "
+		"time_us %10.1f rss_kb %8ld bucket_bytes %11lu "
+		"bytes_per_entry %8.1f minflt %8ld majflt %4ld\n",
+		phase, backend, size, entries, (double) time_ns / 1000,
+		cur->rss_kb, bucket_bytes, per_entry,
+		cur->minflt - prev->minflt, cur->majflt - prev->majflt);
+}
+
+static
+void add_entries(struct cds_lfht *ht, unsigned long *nr, unsigned long to)
+{
+	struct footprint_node *fnode;
+
+	for (; *nr < to; (*nr)++) {
+		fnode = calloc(1, node_size);
+		if (!fnode) {
+			perror("calloc");
+			exit(-1);
+		}
+		fnode->tnode.key = *nr;
+		rcu_read_lock();
+		cds_lfht_add(ht, hash_key(fnode->tnode.key),
+			&fnode->tnode.node);
+		rcu_read_unlock();
+	}
+}
+
+static
+void del_entries(struct cds_lfht *ht)
+{
+	struct cds_lfht_iter iter;
+	struct footprint_node *fnode;
+	int ret;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(ht, &iter, fnode, tnode.node) {
+		ret = cds_lfht_del(ht, &fnode->tnode.node);
+		assert(!ret);
+		call_rcu(&fnode->tnode.head, free_node_cb);
+	}
+	rcu_read_unlock();
+	/* Return the nodes to malloc before sampling. */
+	rcu_barrier();
+}
+
+/* Resize to new_size, return the time taken in nanoseconds. */
+static
+uint64_t timed_resize(struct cds_lfht *ht, unsigned long new_size)
+{
+	uint64_t start;
+
+	start = urcu_hist_now();
+	cds_lfht_resize(ht, new_size);
+	return urcu_hist_now() - start;
+}
+
+static
+void show_usage(int argc, char **argv)
+{
+	printf("Usage : %s [OPTIONS]\n", argv[0]);
+	printf("OPTIONS:\n");
+	printf("	[-B order|chunk|mmap|compact] (bucket memory backend, default: order)\n");
+	printf("	[-n entries] (number of entries, default: %lu)\n",
+		nr_entries);
+	printf("	[-m size] (minimum number of allocated buckets, default: 1)\n");
+	printf("	[-M size] (maximum number of buckets, default: entries rounded up to a power of two)\n");
+	printf("	[-s size] (node payload size in bytes, default: 0)\n");
+	printf("\n\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct cds_lfht_mm_type *mm;
+	struct footprint_sample base, prev, cur;
+	struct cds_lfht *ht;
+	unsigned long size, nr_alloc, nr = 0;
+	size_t bucket_node_size;
+	uint64_t time_ns;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			continue;
+		switch (argv[i][1]) {
+		case 'B':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			backend = argv[++i];
+			break;
+		case 'n':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			nr_entries = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'm':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			min_nr_alloc_buckets = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'M':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			max_nr_buckets = strtoul(argv[++i], NULL, 0);
+			break;
+		case 's':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			payload_size = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'h':
+			show_usage(argc, argv);
+			return 0;
+		}
+	}
+
+	if (!strcmp(backend, "order")) {
+		mm = &cds_lfht_mm_order;
+	} else if (!strcmp(backend, "chunk")) {
+		mm = &cds_lfht_mm_chunk;
+	} else if (!strcmp(backend, "mmap")) {
+		mm = &cds_lfht_mm_mmap;
+	} else if (!strcmp(backend, "compact")) {
+		mm = &cds_lfht_mm_mmap_compact;
+	} else {
+		printf("Unknown backend %s.\n", backend);
+		show_usage(argc, argv);
+		return -1;
+	}
+	if (!nr_entries) {
+		printf("Please specify at least one entry.\n");
+		return -1;
+	}
+	if (!max_nr_buckets) {
+		for (max_nr_buckets = 1; max_nr_buckets < nr_entries;
+				max_nr_buckets <<= 1)
+			;
+	}
+	node_size = sizeof(struct footprint_node) + payload_size;
+
+	rcu_register_thread();
+	take_sample(&base);
+	prev = base;
+
+	ht = _cds_lfht_new(1, min_nr_alloc_buckets, max_nr_buckets, 0,
+			mm, &rcu_flavor, NULL);
+	if (!ht) {
+		printf("Error allocating hash table (min_alloc and max_buckets "
+			"must be powers of two, min_alloc <= max_buckets).\n");
+		rcu_unregister_thread();
+		return -1;
+	}
+	cds_lfht_get_buckets(ht, &size, &nr_alloc, &bucket_node_size);
+	printf("# backend %s entries %lu min_alloc %lu max_buckets %lu "
+		"node_bytes %zu bucket_node_bytes %zu\n",
+		backend, nr_entries, min_nr_alloc_buckets, max_nr_buckets,
+		node_size, bucket_node_size);
+	print_step("create", ht, nr, 0, &base, &prev, &cur);
+	prev = cur;
+
+	/* Grow one order at a time, at one entry per bucket. */
+	for (;;) {
+		size = table_size(ht);
+		add_entries(ht, &nr, size < nr_entries ? size : nr_entries);
+		if (size >= nr_entries || size >= max_nr_buckets)
+			break;
+		time_ns = timed_resize(ht, size << 1);
+		if (table_size(ht) == size)
+			break;
+		print_step("grow", ht, nr, time_ns, &base, &prev, &cur);
+		prev = cur;
+	}
+	add_entries(ht, &nr, nr_entries);
+	print_step("full", ht, nr, 0, &base, &prev, &cur);
+	prev = cur;
+
+	del_entries(ht);
+	print_step("delete", ht, 0, 0, &base, &prev, &cur);
+	prev = cur;
+
+	/* Shrink one order at a time, down to a single bucket. */
+	while ((size = table_size(ht)) > 1) {
+		time_ns = timed_resize(ht, size >> 1);
+		if (table_size(ht) == size)
+			break;
+		print_step("shrink", ht, 0, time_ns, &base, &prev, &cur);
+		prev = cur;
+	}
+
+	if (cds_lfht_destroy(ht, NULL)) {
+		printf("Error destroying hash table.\n");
+		rcu_unregister_thread();
+		return -1;
+	}
+	print_step("destroy", NULL, 0, 0, &base, &prev, &cur);
+
+	rcu_unregister_thread();
+	return 0;
+}
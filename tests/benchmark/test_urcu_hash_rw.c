@@ -61,12 +61,17 @@ void test_hash_rw_sigusr2_handler(int signo)
 void *test_hash_rw_thr_reader(void *_count)
 {
 	unsigned long long *count = _count;
+	struct urcu_perf_thread perf;
 	struct lfht_test_node *node;
 	struct cds_lfht_iter iter;
+	struct urcu_hist *hist = NULL;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
 
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
 	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
 
 	set_affinity();
@@ -77,8 +82,14 @@ void *test_hash_rw_thr_reader(void *_count)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &read_perf);
 
 	for (;;) {
+		int sample = urcu_hist_sample(hist_period, URCU_TLS(nr_reads));
+		uint64_t start = 0;
+
+		if (sample)
+			start = urcu_hist_now();
 		rcu_read_lock();
 		cds_lfht_test_lookup(test_ht,
 			(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % lookup_pool_size) + lookup_pool_offset),
@@ -97,15 +108,23 @@ void *test_hash_rw_thr_reader(void *_count)
 		if (caa_unlikely(rduration))
 			loop_sleep(rduration);
 		rcu_read_unlock();
+		if (sample)
+			urcu_hist_record(hist, urcu_hist_now() - start);
 		URCU_TLS(nr_reads)++;
 		if (caa_unlikely(!test_duration_read()))
 			break;
 		if (caa_unlikely((URCU_TLS(nr_reads) & ((1 << 10) - 1)) == 0))
 			rcu_quiescent_state();
 	}
+	urcu_perf_thread_end(&perf, &read_perf);
 
 	rcu_unregister_thread();
 
+	if (hist) {
+		urcu_hist_merge(&lookup_hist, hist);
+		free(hist);
+	}
+
 	*count = URCU_TLS(nr_reads);
 	printf_verbose("thread_end %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
@@ -120,13 +139,20 @@ void *test_hash_rw_thr_reader(void *_count)
 void *test_hash_rw_thr_writer(void *_count)
 {
 	struct lfht_test_node *node;
+	struct urcu_perf_thread perf;
 	struct cds_lfht_iter iter;
 	struct wr_count *count = _count;
+	struct urcu_hist *hist_add = NULL, *hist_del = NULL;
 	int ret;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 
+	if (hist_period) {
+		hist_add = urcu_hist_alloc();
+		hist_del = urcu_hist_alloc();
+	}
+
 	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
 
 	set_affinity();
@@ -137,16 +163,21 @@ void *test_hash_rw_thr_writer(void *_count)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &write_perf);
 
 	for (;;) {
 		struct cds_lfht_node *ret_node = NULL;
+		int sample = urcu_hist_sample(hist_period, URCU_TLS(nr_writes));
+		uint64_t start = 0;
 
 		if ((addremove == AR_ADD || add_only)
 				|| (addremove == AR_RANDOM && rand_r(&URCU_TLS(rand_lookup)) & 1)) {
-			node = malloc(sizeof(struct lfht_test_node));
+			node = test_node_alloc();
 			lfht_test_node_init(node,
 				(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % write_pool_size) + write_pool_offset),
 				sizeof(void *));
+			if (sample)
+				start = urcu_hist_now();
 			rcu_read_lock();
 			if (add_unique) {
 				ret_node = cds_lfht_add_unique(test_ht,
@@ -163,13 +194,14 @@ void *test_hash_rw_thr_writer(void *_count)
 						&node->node);
 			}
 			rcu_read_unlock();
+			if (sample)
+				urcu_hist_record(hist_add, urcu_hist_now() - start);
 			if (add_unique && ret_node != &node->node) {
-				free(node);
+				test_node_free(node);
 				URCU_TLS(nr_addexist)++;
 			} else {
 				if (add_replace && ret_node) {
-					call_rcu(&to_test_node(ret_node)->head,
-							free_node_cb);
+					test_node_free_rcu(to_test_node(ret_node));
 					URCU_TLS(nr_addexist)++;
 				} else {
 					URCU_TLS(nr_add)++;
@@ -177,15 +209,19 @@ void *test_hash_rw_thr_writer(void *_count)
 			}
 		} else {
 			/* May delete */
+			if (sample)
+				start = urcu_hist_now();
 			rcu_read_lock();
 			cds_lfht_test_lookup(test_ht,
 				(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % write_pool_size) + write_pool_offset),
 				sizeof(void *), &iter);
 			ret = cds_lfht_del(test_ht, cds_lfht_iter_get_node(&iter));
 			rcu_read_unlock();
+			if (sample)
+				urcu_hist_record(hist_del, urcu_hist_now() - start);
 			if (ret == 0) {
 				node = cds_lfht_iter_get_test_node(&iter);
-				call_rcu(&node->head, free_node_cb);
+				test_node_free_rcu(node);
 				URCU_TLS(nr_del)++;
 			} else
 				URCU_TLS(nr_delnoent)++;
@@ -210,9 +246,17 @@ void *test_hash_rw_thr_writer(void *_count)
 		if (caa_unlikely((URCU_TLS(nr_writes) & ((1 << 10) - 1)) == 0))
 			rcu_quiescent_state();
 	}
+	urcu_perf_thread_end(&perf, &write_perf);
 
 	rcu_unregister_thread();
 
+	if (hist_period) {
+		urcu_hist_merge(&add_hist, hist_add);
+		urcu_hist_merge(&del_hist, hist_del);
+		free(hist_add);
+		free(hist_del);
+	}
+
 	printf_verbose("thread_end %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 	printf_verbose("info tid %lu: nr_add %lu, nr_addexist %lu, nr_del %lu, "
@@ -248,7 +292,7 @@ int test_hash_rw_populate_hash(void)
 	while (URCU_TLS(nr_add) < init_populate) {
 		struct cds_lfht_node *ret_node = NULL;
 
-		node = malloc(sizeof(struct lfht_test_node));
+		node = test_node_alloc();
 		lfht_test_node_init(node,
 			(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % init_pool_size) + init_pool_offset),
 			sizeof(void *));
@@ -269,11 +313,11 @@ int test_hash_rw_populate_hash(void)
 		}
 		rcu_read_unlock();
 		if (add_unique && ret_node != &node->node) {
-			free(node);
+			test_node_free(node);
 			URCU_TLS(nr_addexist)++;
 		} else {
 			if (add_replace && ret_node) {
-				call_rcu(&to_test_node(ret_node)->head, free_node_cb);
+				test_node_free_rcu(to_test_node(ret_node));
 				URCU_TLS(nr_addexist)++;
 			} else {
 				URCU_TLS(nr_add)++;
@@ -0,0 +1,288 @@
+/*
+ * test_urcu_hash_shrink.c
+ *
+ * Userspace RCU library - test program, hash table shrink latency with
+ * concurrent lookups
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Each iteration grows the table to 2^max_order buckets, then shrinks it
+ * by "-o orders" with a single cds_lfht_resize() call, while reader
+ * threads keep looking up the table entries. Besides the SUMMARY line,
+ * the program prints the latency distribution of the shrinks, and the
+ * number of grace periods they waited for.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+#include "rculfhash-internal.h"
+#include "thread-id.h"
+#include "histogram.h"
+#include "lfht-test-node.h"
+
+static volatile int test_go, test_stop;
+
+static const char *backend = "order";
+static unsigned int max_order = 16;
+static unsigned int shrink_orders;
+static unsigned long nr_iter = 100;
+static unsigned long nr_entries = 1024;
+static unsigned int nr_readers = 1;
+
+static struct cds_lfht *test_ht;
+
+static struct urcu_hist shrink_hist;
+
+static
+unsigned long table_size(struct cds_lfht *ht)
+{
+	return CMM_LOAD_SHARED(ht->size);
+}
+
+void *thr_reader(void *_count)
+{
+	unsigned long long *count = _count;
+	unsigned long long nr_lookups = 0;
+	unsigned long key = 0;
+	struct cds_lfht_iter iter;
+
+	rcu_register_thread();
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+
+	for (;;) {
+		rcu_read_lock();
+		cds_lfht_lookup(test_ht, hash_key(key), match_key, &key, &iter);
+		if (!cds_lfht_iter_get_node(&iter)) {
+			fprintf(stderr, "Entry %lu not found\n", key);
+			abort();
+		}
+		rcu_read_unlock();
+		if (++key == nr_entries)
+			key = 0;
+		nr_lookups++;
+		if (caa_unlikely(test_stop))
+			break;
+	}
+
+	rcu_unregister_thread();
+
+	*count = nr_lookups;
+	return ((void*)1);
+}
+
+void show_usage(int argc, char **argv)
+{
+	printf("Usage : %s [OPTIONS]\n", argv[0]);
+	printf("OPTIONS:\n");
+	printf("	[-B order|chunk|mmap|compact] (bucket memory backend, default: order)\n");
+	printf("	[-M order] (grow to 2^order buckets, default: %u)\n",
+		max_order);
+	printf("	[-o orders] (orders removed by each shrink, default: all)\n");
+	printf("	[-i iterations] (number of shrinks, default: %lu)\n",
+		nr_iter);
+	printf("	[-n entries] (number of entries, default: %lu)\n",
+		nr_entries);
+	printf("	[-r readers] (number of lookup threads, default: %u)\n",
+		nr_readers);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct cds_lfht_mm_type *mm;
+	struct rcu_gp_stats stats_begin, stats_end;
+	unsigned long long *count_reader, tot_reads = 0;
+	unsigned long long nr_gp = 0, total_ns = 0;
+	struct test_node *snode;
+	struct cds_lfht_iter ht_iter;
+	pthread_t *tid_reader;
+	unsigned long iter, key, size;
+	uint64_t start, elapsed;
+	void *tret;
+	int i, err;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-')
+			continue;
+		switch (argv[i][1]) {
+		case 'B':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			backend = argv[++i];
+			break;
+		case 'M':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			max_order = atoi(argv[++i]);
+			break;
+		case 'o':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			shrink_orders = atoi(argv[++i]);
+			break;
+		case 'i':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			nr_iter = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'n':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			nr_entries = strtoul(argv[++i], NULL, 0);
+			break;
+		case 'r':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			nr_readers = atoi(argv[++i]);
+			break;
+		case 'h':
+			show_usage(argc, argv);
+			return 0;
+		}
+	}
+
+	if (!strcmp(backend, "order")) {
+		mm = &cds_lfht_mm_order;
+	} else if (!strcmp(backend, "chunk")) {
+		mm = &cds_lfht_mm_chunk;
+	} else if (!strcmp(backend, "mmap")) {
+		mm = &cds_lfht_mm_mmap;
+	} else if (!strcmp(backend, "compact")) {
+		mm = &cds_lfht_mm_mmap_compact;
+	} else {
+		printf("Unknown backend %s.\n", backend);
+		show_usage(argc, argv);
+		return -1;
+	}
+	if (max_order < 1 || max_order >= CAA_BITS_PER_LONG - 1) {
+		printf("Invalid maximum order %u.\n", max_order);
+		return -1;
+	}
+	if (!shrink_orders || shrink_orders > max_order)
+		shrink_orders = max_order;
+	if (!nr_entries) {
+		printf("Please specify at least one entry.\n");
+		return -1;
+	}
+
+	rcu_register_thread();
+
+	test_ht = _cds_lfht_new(1, 1, 1UL << max_order, 0, mm,
+			&rcu_flavor, NULL);
+	if (!test_ht) {
+		printf("Error allocating hash table.\n");
+		rcu_unregister_thread();
+		return -1;
+	}
+	for (key = 0; key < nr_entries; key++) {
+		snode = calloc(1, sizeof(*snode));
+		if (!snode) {
+			perror("calloc");
+			exit(-1);
+		}
+		snode->key = key;
+		rcu_read_lock();
+		cds_lfht_add(test_ht, hash_key(key), &snode->node);
+		rcu_read_unlock();
+	}
+
+	tid_reader = calloc(nr_readers, sizeof(*tid_reader));
+	count_reader = calloc(nr_readers, sizeof(*count_reader));
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_create(&tid_reader[i], NULL, thr_reader,
+				     &count_reader[i]);
+		if (err != 0)
+			exit(1);
+	}
+
+	cmm_smp_mb();
+
+	test_go = 1;
+
+	for (iter = 0; iter < nr_iter; iter++) {
+		cds_lfht_resize(test_ht, 1UL << max_order);
+		size = table_size(test_ht);
+		rcu_get_gp_stats(&stats_begin);
+		start = urcu_hist_now();
+		cds_lfht_resize(test_ht, size >> shrink_orders);
+		elapsed = urcu_hist_now() - start;
+		rcu_get_gp_stats(&stats_end);
+		assert(table_size(test_ht) == (size >> shrink_orders ? : 1));
+		urcu_hist_record(&shrink_hist, elapsed);
+		total_ns += elapsed;
+		nr_gp += stats_end.nr_gp - stats_begin.nr_gp;
+	}
+
+	test_stop = 1;
+
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_join(tid_reader[i], &tret);
+		if (err != 0)
+			exit(1);
+		tot_reads += count_reader[i];
+	}
+
+	printf("SUMMARY %-25s backend %-5s max_order %2u shrink_orders %2u "
+		"nr_readers %3u nr_entries %8lu nr_shrinks %8lu "
+		"nr_reads %12llu shrink_avg_us %10.1f\n",
+		argv[0], backend, max_order, shrink_orders, nr_readers,
+		nr_entries, nr_iter, tot_reads,
+		nr_iter ? (double) total_ns / nr_iter / 1000 : 0);
+	urcu_hist_print("shrink", &shrink_hist);
+	printf("GPSTATS nr_gp %12llu gp_per_shrink %8.3f\n",
+		nr_gp, nr_iter ? (double) nr_gp / nr_iter : 0);
+
+	/* Readers are gone: entries can be freed right after removal. */
+	rcu_read_lock();
+	cds_lfht_for_each_entry(test_ht, &ht_iter, snode, node) {
+		err = cds_lfht_del(test_ht, &snode->node);
+		assert(!err);
+		free(snode);
+	}
+	rcu_read_unlock();
+	if (cds_lfht_destroy(test_ht, NULL))
+		printf("Error destroying hash table.\n");
+	rcu_unregister_thread();
+	free(tid_reader);
+	free(count_reader);
+	return 0;
+}
@@ -61,6 +61,7 @@ void test_hash_unique_sigusr2_handler(int signo)
 void *test_hash_unique_thr_reader(void *_count)
 {
 	unsigned long long *count = _count;
+	struct urcu_perf_thread perf;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
@@ -75,6 +76,7 @@ void *test_hash_unique_thr_reader(void *_count)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &read_perf);
 
 	for (;;) {
 		struct lfht_test_node *node;
@@ -105,6 +107,7 @@ void *test_hash_unique_thr_reader(void *_count)
 		if (caa_unlikely((URCU_TLS(nr_reads) & ((1 << 10) - 1)) == 0))
 			rcu_quiescent_state();
 	}
+	urcu_perf_thread_end(&perf, &read_perf);
 
 	rcu_unregister_thread();
 
@@ -121,15 +124,20 @@ void *test_hash_unique_thr_reader(void *_count)
 void *test_hash_unique_thr_writer(void *_count)
 {
 	struct lfht_test_node *node;
+	struct urcu_perf_thread perf;
 	struct cds_lfht_node *ret_node;
 	struct cds_lfht_iter iter;
 	struct wr_count *count = _count;
+	struct urcu_hist *hist = NULL;
 	int ret;
 	int loc_add_unique;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
 	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
 
 	set_affinity();
@@ -140,17 +148,23 @@ void *test_hash_unique_thr_writer(void *_count)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &write_perf);
 
 	for (;;) {
+		int sample = urcu_hist_sample(hist_period, URCU_TLS(nr_writes));
+		uint64_t start = 0;
+
 		/*
 		 * add unique/add replace with new node key from range.
 		 */
 		if (1 || (addremove == AR_ADD || add_only)
 				|| (addremove == AR_RANDOM && rand_r(&URCU_TLS(rand_lookup)) & 1)) {
-			node = malloc(sizeof(struct lfht_test_node));
+			node = test_node_alloc();
 			lfht_test_node_init(node,
 				(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % write_pool_size) + write_pool_offset),
 				sizeof(void *));
+			if (sample)
+				start = urcu_hist_now();
 			rcu_read_lock();
 			loc_add_unique = rand_r(&URCU_TLS(rand_lookup)) & 1;
 			if (loc_add_unique) {
@@ -169,17 +183,18 @@ void *test_hash_unique_thr_writer(void *_count)
 #endif //0
 			}
 			rcu_read_unlock();
+			if (sample)
+				urcu_hist_record(hist, urcu_hist_now() - start);
 			if (loc_add_unique) {
 				if (ret_node != &node->node) {
-					free(node);
+					test_node_free(node);
 					URCU_TLS(nr_addexist)++;
 				} else {
 					URCU_TLS(nr_add)++;
 				}
 			} else {
 				if (ret_node) {
-					call_rcu(&to_test_node(ret_node)->head,
-							free_node_cb);
+					test_node_free_rcu(to_test_node(ret_node));
 					URCU_TLS(nr_addexist)++;
 				} else {
 					URCU_TLS(nr_add)++;
@@ -195,7 +210,7 @@ void *test_hash_unique_thr_writer(void *_count)
 			rcu_read_unlock();
 			if (ret == 0) {
 				node = cds_lfht_iter_get_test_node(&iter);
-				call_rcu(&node->head, free_node_cb);
+				test_node_free_rcu(node);
 				URCU_TLS(nr_del)++;
 			} else
 				URCU_TLS(nr_delnoent)++;
@@ -220,9 +235,15 @@ void *test_hash_unique_thr_writer(void *_count)
 		if (caa_unlikely((URCU_TLS(nr_writes) & ((1 << 10) - 1)) == 0))
 			rcu_quiescent_state();
 	}
+	urcu_perf_thread_end(&perf, &write_perf);
 
 	rcu_unregister_thread();
 
+	if (hist) {
+		urcu_hist_merge(&add_hist, hist);
+		free(hist);
+	}
+
 	printf_verbose("thread_end %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 	printf_verbose("info tid %lu: nr_add %lu, nr_addexist %lu, nr_del %lu, "
@@ -257,7 +278,7 @@ int test_hash_unique_populate_hash(void)
 	}
 
 	while (URCU_TLS(nr_add) < init_populate) {
-		node = malloc(sizeof(struct lfht_test_node));
+		node = test_node_alloc();
 		lfht_test_node_init(node,
 			(void *)(((unsigned long) rand_r(&URCU_TLS(rand_lookup)) % init_pool_size) + init_pool_offset),
 			sizeof(void *));
@@ -267,7 +288,7 @@ int test_hash_unique_populate_hash(void)
 				test_match, node->key, &node->node);
 		rcu_read_unlock();
 		if (ret_node) {
-			call_rcu(&to_test_node(ret_node)->head, free_node_cb);
+			test_node_free_rcu(to_test_node(ret_node));
 			URCU_TLS(nr_addexist)++;
 		} else {
 			URCU_TLS(nr_add)++;
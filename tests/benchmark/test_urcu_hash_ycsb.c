@@ -0,0 +1,623 @@
+/*
+ * test_urcu_hash_ycsb.c
+ *
+ * Userspace RCU library - test program
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * YCSB-style workloads (Cooper et al., "Benchmarking Cloud Serving
+ * Systems with YCSB", SoCC 2010).
+ *
+ * Writer threads are YCSB clients running the whole operation mix of
+ * the selected workload. Reader threads only run its read part (reads,
+ * or scans for workload E), adding read load without changing the
+ * number of keys.
+ *
+ * Keys are key_size bytes long, derived from a key number. Values are
+ * value_size bytes, stored after the key in the node. Updates never
+ * modify a published node: they publish a new copy with
+ * cds_lfht_add_replace() and free the old one after a grace period.
+ * Scans have no key order in a hash table: they walk the table from
+ * the first key in hash order, touching scan length nodes.
+ */
+
+#include <math.h>
+#include "test_urcu_hash.h"
+
+#define YCSB_DEFAULT_RECORD_COUNT	100000
+#define YCSB_ZIPFIAN_THETA		0.99
+#define YCSB_HOTSPOT_DATA_FRACTION	0.2
+#define YCSB_HOTSPOT_OPN_FRACTION	0.8
+#define YCSB_MAX_SCAN_LEN		100
+#define YCSB_MAX_KEY_SIZE		256
+
+enum ycsb_dist {
+	YCSB_DIST_DEFAULT = 0,
+	YCSB_DIST_UNIFORM,
+	YCSB_DIST_ZIPFIAN,
+	YCSB_DIST_LATEST,
+	YCSB_DIST_HOTSPOT,
+};
+
+/* Operation mix, in percent. */
+struct ycsb_workload {
+	const char *name;
+	unsigned int read, update, insert, scan, rmw;
+	enum ycsb_dist dist;
+};
+
+static const struct ycsb_workload ycsb_workloads[] = {
+	{ "a", 50, 50, 0, 0, 0, YCSB_DIST_ZIPFIAN },	/* update heavy */
+	{ "b", 95, 5, 0, 0, 0, YCSB_DIST_ZIPFIAN },	/* read mostly */
+	{ "c", 100, 0, 0, 0, 0, YCSB_DIST_ZIPFIAN },	/* read only */
+	{ "d", 95, 0, 5, 0, 0, YCSB_DIST_LATEST },	/* read latest */
+	{ "e", 0, 0, 5, 95, 0, YCSB_DIST_ZIPFIAN },	/* short ranges */
+	{ "f", 50, 0, 0, 0, 50, YCSB_DIST_ZIPFIAN },	/* read-modify-write */
+};
+
+static const char *ycsb_dist_names[] = {
+	[YCSB_DIST_DEFAULT] = "default",
+	[YCSB_DIST_UNIFORM] = "uniform",
+	[YCSB_DIST_ZIPFIAN] = "zipfian",
+	[YCSB_DIST_LATEST] = "latest",
+	[YCSB_DIST_HOTSPOT] = "hotspot",
+};
+
+enum ycsb_op {
+	YCSB_OP_READ,
+	YCSB_OP_UPDATE,
+	YCSB_OP_INSERT,
+	YCSB_OP_SCAN,
+	YCSB_OP_RMW,
+};
+
+static const struct ycsb_workload *workload = &ycsb_workloads[0];
+static enum ycsb_dist dist;
+
+unsigned long key_size = sizeof(uint64_t);
+unsigned long value_size = 100;
+
+static unsigned long record_count;
+/* Next key number to insert; keys below it may be present. */
+static unsigned long insert_key;
+
+/* Zipfian generator state over record_count items (Gray et al.). */
+static double zipf_zetan, zipf_alpha, zipf_eta, zipf_half_pow_theta;
+
+int test_hash_ycsb_set_workload(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < CAA_ARRAY_SIZE(ycsb_workloads); i++) {
+		if (!strcmp(name, ycsb_workloads[i].name)) {
+			workload = &ycsb_workloads[i];
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int test_hash_ycsb_set_dist(const char *name)
+{
+	unsigned int i;
+
+	for (i = YCSB_DIST_UNIFORM; i < CAA_ARRAY_SIZE(ycsb_dist_names); i++) {
+		if (!strcmp(name, ycsb_dist_names[i])) {
+			dist = i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* Keys are hashed as arrays of 32-bit words holding a 64-bit number. */
+int test_hash_ycsb_set_key_size(unsigned long size)
+{
+	if (size < sizeof(uint64_t) || size > YCSB_MAX_KEY_SIZE
+			|| size % sizeof(uint32_t)) {
+		printf("Error: key size must be a multiple of %zu between "
+			"%zu and %d bytes.\n", sizeof(uint32_t),
+			sizeof(uint64_t), YCSB_MAX_KEY_SIZE);
+		return -1;
+	}
+	key_size = size;
+	return 0;
+}
+
+void test_hash_ycsb_sigusr1_handler(int signo)
+{
+	/* Nothing to toggle: the workload fixes the operation mix. */
+}
+
+static
+double rand_double(void)
+{
+	return (double) rand_r(&URCU_TLS(rand_lookup)) / ((double) RAND_MAX + 1.0);
+}
+
+static
+unsigned long rand_range(unsigned long n)
+{
+	return (unsigned long) (rand_double() * n);
+}
+
+static
+double zeta(unsigned long n, double theta)
+{
+	double sum = 0;
+	unsigned long i;
+
+	for (i = 1; i <= n; i++)
+		sum += 1.0 / pow((double) i, theta);
+	return sum;
+}
+
+static
+void zipf_init(unsigned long n, double theta)
+{
+	double zeta2 = zeta(2, theta);
+
+	zipf_zetan = zeta(n, theta);
+	zipf_alpha = 1.0 / (1.0 - theta);
+	zipf_eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zipf_zetan);
+	zipf_half_pow_theta = 1.0 + pow(0.5, theta);
+}
+
+/* Rank in [0, record_count), rank 0 being the most popular. */
+static
+unsigned long zipf_next(void)
+{
+	double u = rand_double(), uz = u * zipf_zetan;
+	unsigned long rank;
+
+	if (uz < 1.0)
+		return 0;
+	if (uz < zipf_half_pow_theta)
+		return 1;
+	rank = (unsigned long) (record_count
+		* pow(zipf_eta * u - zipf_eta + 1.0, zipf_alpha));
+	return rank < record_count ? rank : record_count - 1;
+}
+
+/* FNV-1a, spreading popular ranks over the key space. */
+static
+unsigned long scramble(unsigned long v)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(uint64_t); i++) {
+		h ^= (v >> (i * 8)) & 0xff;
+		h *= 0x100000001b3ULL;
+	}
+	return (unsigned long) h;
+}
+
+static
+unsigned long next_key(void)
+{
+	unsigned long last, rank, hot;
+
+	switch (dist) {
+	case YCSB_DIST_UNIFORM:
+		return rand_range(record_count);
+	case YCSB_DIST_LATEST:
+		last = uatomic_read(&insert_key);
+		rank = zipf_next();
+		if (rank >= last)
+			rank = last - 1;
+		return last - 1 - rank;
+	case YCSB_DIST_HOTSPOT:
+		hot = (unsigned long) (record_count * YCSB_HOTSPOT_DATA_FRACTION);
+		if (rand_double() < YCSB_HOTSPOT_OPN_FRACTION)
+			return rand_range(hot);
+		return hot + rand_range(record_count - hot);
+	case YCSB_DIST_ZIPFIAN:
+	default:
+		return scramble(zipf_next()) % record_count;
+	}
+}
+
+static
+enum ycsb_op next_op(int read_only)
+{
+	unsigned int r;
+
+	if (read_only)
+		return workload->scan ? YCSB_OP_SCAN : YCSB_OP_READ;
+	r = rand_range(100);
+	if (r < workload->read)
+		return YCSB_OP_READ;
+	r -= workload->read;
+	if (r < workload->update)
+		return YCSB_OP_UPDATE;
+	r -= workload->update;
+	if (r < workload->insert)
+		return YCSB_OP_INSERT;
+	r -= workload->insert;
+	if (r < workload->scan)
+		return YCSB_OP_SCAN;
+	return YCSB_OP_RMW;
+}
+
+/* Key bytes: the key number, followed by a filler derived from it. */
+static
+void make_key(unsigned char *buf, unsigned long nr)
+{
+	uint64_t v = nr;
+
+	memcpy(buf, &v, sizeof(v));
+	memset(buf + sizeof(v), (int) (nr & 0xff), key_size - sizeof(v));
+}
+
+static
+unsigned long ycsb_hash(const unsigned char *key)
+{
+	if (nr_hash_chains) {
+		uint64_t v;
+
+		memcpy(&v, key, sizeof(v));
+		return v % nr_hash_chains;
+	}
+	return hash_u32((const uint32_t *) key, key_size / sizeof(uint32_t),
+			TEST_HASH_SEED);
+}
+
+static
+int ycsb_match(struct cds_lfht_node *node, const void *key)
+{
+	struct lfht_test_node *test_node = to_test_node(node);
+
+	return !memcmp(test_node->key, key, key_size);
+}
+
+static
+unsigned char *node_value(struct lfht_test_node *node)
+{
+	return node->payload + key_size;
+}
+
+static
+struct lfht_test_node *ycsb_node_alloc(const unsigned char *key)
+{
+	struct lfht_test_node *node;
+
+	node = test_node_alloc();
+	memcpy(node->payload, key, key_size);
+	lfht_test_node_init(node, node->payload, key_size);
+	return node;
+}
+
+/* Touch every cache line of the value, as a client reading it would. */
+static
+unsigned long read_value(struct lfht_test_node *node)
+{
+	const unsigned char *value = node_value(node);
+	unsigned long i, sum = 0;
+
+	for (i = 0; i < value_size; i += CAA_CACHE_LINE_SIZE)
+		sum += CMM_LOAD_SHARED(value[i]);
+	return sum;
+}
+
+static
+void ycsb_read(const unsigned char *key)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+
+	rcu_read_lock();
+	cds_lfht_lookup(test_ht, ycsb_hash(key), ycsb_match, key, &iter);
+	node = cds_lfht_iter_get_node(&iter);
+	if (node) {
+		(void) read_value(to_test_node(node));
+		URCU_TLS(lookup_ok)++;
+	} else {
+		URCU_TLS(lookup_fail)++;
+	}
+	rcu_read_unlock();
+}
+
+static
+void ycsb_scan(const unsigned char *key)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	unsigned long len;
+
+	len = 1 + rand_range(YCSB_MAX_SCAN_LEN);
+	rcu_read_lock();
+	cds_lfht_lookup(test_ht, ycsb_hash(key), ycsb_match, key, &iter);
+	node = cds_lfht_iter_get_node(&iter);
+	if (!node) {
+		URCU_TLS(lookup_fail)++;
+	} else {
+		URCU_TLS(lookup_ok)++;
+		while (node && len--) {
+			(void) read_value(to_test_node(node));
+			cds_lfht_next(test_ht, &iter);
+			node = cds_lfht_iter_get_node(&iter);
+		}
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Publish a new copy of the key. With rmw, the new value is derived
+ * from the current one, read within the same read-side critical
+ * section.
+ */
+static
+void ycsb_write(const unsigned char *key, int rmw)
+{
+	struct lfht_test_node *node;
+	struct cds_lfht_node *ret_node;
+	unsigned long hash = ycsb_hash(key);
+
+	node = ycsb_node_alloc(key);
+	rcu_read_lock();
+	if (rmw) {
+		struct cds_lfht_iter iter;
+		struct cds_lfht_node *old;
+
+		cds_lfht_lookup(test_ht, hash, ycsb_match, key, &iter);
+		old = cds_lfht_iter_get_node(&iter);
+		if (old) {
+			memcpy(node_value(node), node_value(to_test_node(old)),
+				value_size);
+			node_value(node)[0]++;
+		} else {
+			memset(node_value(node), 0, value_size);
+		}
+	} else {
+		memset(node_value(node), (int) URCU_TLS(nr_writes), value_size);
+	}
+	ret_node = cds_lfht_add_replace(test_ht, hash, ycsb_match, key,
+			&node->node);
+	rcu_read_unlock();
+	if (ret_node) {
+		test_node_free_rcu(to_test_node(ret_node));
+		URCU_TLS(nr_addexist)++;
+	} else {
+		URCU_TLS(nr_add)++;
+	}
+}
+
+static
+void ycsb_insert(void)
+{
+	unsigned char key[YCSB_MAX_KEY_SIZE] __attribute__((aligned(sizeof(uint64_t))));
+	struct lfht_test_node *node;
+	struct cds_lfht_node *ret_node;
+
+	make_key(key, uatomic_add_return(&insert_key, 1) - 1);
+	node = ycsb_node_alloc(key);
+	memset(node_value(node), 0, value_size);
+	rcu_read_lock();
+	ret_node = cds_lfht_add_unique(test_ht, ycsb_hash(key), ycsb_match,
+			key, &node->node);
+	rcu_read_unlock();
+	if (ret_node != &node->node) {
+		test_node_free(node);
+		URCU_TLS(nr_addexist)++;
+	} else {
+		URCU_TLS(nr_add)++;
+	}
+}
+
+/*
+ * Run one operation. Return 1 for reads and scans, 0 for updates.
+ */
+static
+int ycsb_op(int read_only, struct urcu_hist *hist_read,
+		struct urcu_hist *hist_write, int sample)
+{
+	unsigned char key[YCSB_MAX_KEY_SIZE] __attribute__((aligned(sizeof(uint64_t))));
+	enum ycsb_op op = next_op(read_only);
+	uint64_t start = 0;
+
+	if (op != YCSB_OP_INSERT)
+		make_key(key, next_key());
+	if (sample)
+		start = urcu_hist_now();
+	switch (op) {
+	case YCSB_OP_READ:
+		ycsb_read(key);
+		break;
+	case YCSB_OP_SCAN:
+		ycsb_scan(key);
+		break;
+	case YCSB_OP_UPDATE:
+		ycsb_write(key, 0);
+		break;
+	case YCSB_OP_RMW:
+		ycsb_write(key, 1);
+		break;
+	case YCSB_OP_INSERT:
+		ycsb_insert();
+		break;
+	}
+	if (op == YCSB_OP_READ || op == YCSB_OP_SCAN) {
+		if (sample)
+			urcu_hist_record(hist_read, urcu_hist_now() - start);
+		return 1;
+	}
+	if (sample)
+		urcu_hist_record(hist_write, urcu_hist_now() - start);
+	return 0;
+}
+
+void *test_hash_ycsb_thr_reader(void *_count)
+{
+	unsigned long long *count = _count;
+	struct urcu_perf_thread perf;
+	struct urcu_hist *hist = NULL;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
+	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
+
+	set_affinity();
+
+	rcu_register_thread();
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &read_perf);
+
+	for (;;) {
+		(void) ycsb_op(1, hist, NULL,
+			urcu_hist_sample(hist_period, URCU_TLS(nr_reads)));
+		rcu_debug_yield_read();
+		if (caa_unlikely(rduration))
+			loop_sleep(rduration);
+		URCU_TLS(nr_reads)++;
+		if (caa_unlikely(!test_duration_read()))
+			break;
+		if (caa_unlikely((URCU_TLS(nr_reads) & ((1 << 10) - 1)) == 0))
+			rcu_quiescent_state();
+	}
+	urcu_perf_thread_end(&perf, &read_perf);
+
+	rcu_unregister_thread();
+
+	if (hist) {
+		urcu_hist_merge(&lookup_hist, hist);
+		free(hist);
+	}
+
+	*count = URCU_TLS(nr_reads);
+	printf_verbose("thread_end %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+	printf_verbose("read tid : %lx, lookupfail %lu, lookupok %lu\n",
+			urcu_get_thread_id(),
+			URCU_TLS(lookup_fail),
+			URCU_TLS(lookup_ok));
+	return ((void*)1);
+
+}
+
+void *test_hash_ycsb_thr_writer(void *_count)
+{
+	struct wr_count *count = _count;
+	struct urcu_perf_thread perf;
+	struct urcu_hist *hist_read = NULL, *hist_write = NULL;
+	unsigned long nr_ops = 0;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+
+	if (hist_period) {
+		hist_read = urcu_hist_alloc();
+		hist_write = urcu_hist_alloc();
+	}
+
+	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
+
+	set_affinity();
+
+	rcu_register_thread();
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &write_perf);
+
+	for (;;) {
+		if (ycsb_op(0, hist_read, hist_write,
+				urcu_hist_sample(hist_period, nr_ops)))
+			URCU_TLS(nr_reads)++;
+		else
+			URCU_TLS(nr_writes)++;
+		nr_ops++;
+		if (caa_unlikely(!test_duration_write()))
+			break;
+		if (caa_unlikely(wdelay))
+			loop_sleep(wdelay);
+		if (caa_unlikely((nr_ops & ((1 << 10) - 1)) == 0))
+			rcu_quiescent_state();
+	}
+	urcu_perf_thread_end(&perf, &write_perf);
+
+	rcu_unregister_thread();
+
+	if (hist_period) {
+		urcu_hist_merge(&lookup_hist, hist_read);
+		urcu_hist_merge(&add_hist, hist_write);
+		free(hist_read);
+		free(hist_write);
+	}
+
+	printf_verbose("thread_end %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+	printf_verbose("info tid %lu: nr_add %lu, nr_addexist %lu, "
+			"lookupfail %lu, lookupok %lu\n", urcu_get_thread_id(),
+			URCU_TLS(nr_add),
+			URCU_TLS(nr_addexist),
+			URCU_TLS(lookup_fail),
+			URCU_TLS(lookup_ok));
+	count->update_ops = URCU_TLS(nr_writes);
+	count->read_ops = URCU_TLS(nr_reads);
+	count->add = URCU_TLS(nr_add);
+	count->add_exist = URCU_TLS(nr_addexist);
+	count->remove = 0;
+	return ((void*)2);
+}
+
+int test_hash_ycsb_populate_hash(void)
+{
+	unsigned char key[YCSB_MAX_KEY_SIZE] __attribute__((aligned(sizeof(uint64_t))));
+	struct lfht_test_node *node;
+	struct cds_lfht_node *ret_node;
+
+	if (!init_populate)
+		init_populate = YCSB_DEFAULT_RECORD_COUNT;
+	record_count = init_populate;
+	insert_key = record_count;
+	if (!dist)
+		dist = workload->dist;
+
+	printf("Starting YCSB workload %s: %lu records, %s distribution, "
+		"key %lu bytes, value %lu bytes\n",
+		workload->name, record_count, ycsb_dist_names[dist],
+		key_size, value_size);
+
+	zipf_init(record_count, YCSB_ZIPFIAN_THETA);
+
+	URCU_TLS(rand_lookup) = urcu_get_thread_id() ^ time(NULL);
+
+	while (URCU_TLS(nr_add) < record_count) {
+		make_key(key, URCU_TLS(nr_add));
+		node = ycsb_node_alloc(key);
+		memset(node_value(node), 0, value_size);
+		rcu_read_lock();
+		ret_node = cds_lfht_add_unique(test_ht, ycsb_hash(key),
+				ycsb_match, key, &node->node);
+		rcu_read_unlock();
+		assert(ret_node == &node->node);
+		URCU_TLS(nr_add)++;
+		URCU_TLS(nr_writes)++;
+	}
+	return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * test_urcu_hazptr.c
+ *
+ * Userspace RCU library - test program, hazard pointers versus RCU
+ * read-side cost
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <urcu/arch.h>
+#include <urcu/tls-compat.h>
+#include "cpuset.h"
+#include "thread-id.h"
+#include <../common/debug-yield.h>
+
+/* hardcoded number of CPUs */
+#define NR_CPUS 16384
+
+#ifndef DYNAMIC_LINK_TEST
+#define _LGPL_SOURCE
+#endif
+#include <urcu.h>
+#include <urcu/hazptr.h>
+
+/*
+ * Reader modes:
+ * - rcu: the reference is held within a RCU read-side critical section,
+ * - hp: the reference is held by a hazard pointer, set with
+ *       cds_hp_protect(), without RCU read-side critical section,
+ * - rcu_hp: the object is found within a RCU read-side critical
+ *       section and handed over to a hazard pointer with
+ *       cds_hp_protect_rcu(); the reference is then held outside of the
+ *       critical section.
+ */
+enum test_mode {
+	TEST_MODE_RCU,
+	TEST_MODE_HP,
+	TEST_MODE_RCU_HP,
+};
+
+static const char *test_mode_str[] = {
+	[TEST_MODE_RCU] = "rcu",
+	[TEST_MODE_HP] = "hp",
+	[TEST_MODE_RCU_HP] = "rcu_hp",
+};
+
+static enum test_mode test_mode = TEST_MODE_RCU;
+
+struct test_obj {
+	int value;
+	struct cds_hp_head hp_head;
+};
+
+static volatile int test_go, test_stop;
+
+static unsigned long wdelay;
+
+static struct test_obj *test_rcu_pointer;
+
+static struct cds_hp_domain *test_hp_domain;
+
+static unsigned long duration;
+
+/* read-side C.S. duration, in loops */
+static unsigned long rduration;
+
+/* write-side C.S. duration, in loops */
+static unsigned long wduration;
+
+static inline void loop_sleep(unsigned long loops)
+{
+	while (loops-- != 0)
+		caa_cpu_relax();
+}
+
+static int verbose_mode;
+
+#define printf_verbose(fmt, args...)		\
+	do {					\
+		if (verbose_mode)		\
+			printf(fmt, args);	\
+	} while (0)
+
+static unsigned int cpu_affinities[NR_CPUS];
+static unsigned int next_aff = 0;
+static int use_affinity = 0;
+
+pthread_mutex_t affinity_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void set_affinity(void)
+{
+#if HAVE_SCHED_SETAFFINITY
+	cpu_set_t mask;
+	int cpu, ret;
+#endif /* HAVE_SCHED_SETAFFINITY */
+
+	if (!use_affinity)
+		return;
+
+#if HAVE_SCHED_SETAFFINITY
+	ret = pthread_mutex_lock(&affinity_mutex);
+	if (ret) {
+		perror("Error in pthread mutex lock");
+		exit(-1);
+	}
+	cpu = cpu_affinities[next_aff++];
+	ret = pthread_mutex_unlock(&affinity_mutex);
+	if (ret) {
+		perror("Error in pthread mutex unlock");
+		exit(-1);
+	}
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+#if SCHED_SETAFFINITY_ARGS == 2
+	sched_setaffinity(0, &mask);
+#else
+	sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+#endif /* HAVE_SCHED_SETAFFINITY */
+}
+
+/*
+ * returns 0 if test should end.
+ */
+static int test_duration_write(void)
+{
+	return !test_stop;
+}
+
+static int test_duration_read(void)
+{
+	return !test_stop;
+}
+
+static DEFINE_URCU_TLS(unsigned long long, nr_writes);
+static DEFINE_URCU_TLS(unsigned long long, nr_reads);
+
+static unsigned int nr_readers;
+static unsigned int nr_writers;
+
+pthread_mutex_t rcu_copy_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void rcu_copy_mutex_lock(void)
+{
+	int ret;
+	ret = pthread_mutex_lock(&rcu_copy_mutex);
+	if (ret) {
+		perror("Error in pthread mutex lock");
+		exit(-1);
+	}
+}
+
+void rcu_copy_mutex_unlock(void)
+{
+	int ret;
+
+	ret = pthread_mutex_unlock(&rcu_copy_mutex);
+	if (ret) {
+		perror("Error in pthread mutex unlock");
+		exit(-1);
+	}
+}
+
+void *thr_reader(void *_count)
+{
+	unsigned long long *count = _count;
+	struct cds_hp_record *rec = NULL;
+	struct test_obj *local_ptr;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+
+	set_affinity();
+
+	rcu_register_thread();
+	assert(!rcu_read_ongoing());
+	if (test_mode != TEST_MODE_RCU) {
+		rec = cds_hp_record_acquire(test_hp_domain);
+		assert(rec);
+	}
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+
+	for (;;) {
+		switch (test_mode) {
+		case TEST_MODE_RCU:
+			rcu_read_lock();
+			local_ptr = rcu_dereference(test_rcu_pointer);
+			rcu_debug_yield_read();
+			if (local_ptr)
+				assert(local_ptr->value == 8);
+			if (caa_unlikely(rduration))
+				loop_sleep(rduration);
+			rcu_read_unlock();
+			break;
+		case TEST_MODE_HP:
+			local_ptr = cds_hp_protect(rec, 0,
+					(void **) &test_rcu_pointer);
+			if (local_ptr)
+				assert(local_ptr->value == 8);
+			if (caa_unlikely(rduration))
+				loop_sleep(rduration);
+			cds_hp_clear(rec, 0);
+			break;
+		case TEST_MODE_RCU_HP:
+			rcu_read_lock();
+			local_ptr = rcu_dereference(test_rcu_pointer);
+			cds_hp_protect_rcu(rec, 0, local_ptr);
+			rcu_read_unlock();
+			if (local_ptr)
+				assert(local_ptr->value == 8);
+			if (caa_unlikely(rduration))
+				loop_sleep(rduration);
+			cds_hp_clear(rec, 0);
+			break;
+		}
+		URCU_TLS(nr_reads)++;
+		if (caa_unlikely(!test_duration_read()))
+			break;
+	}
+
+	if (rec)
+		cds_hp_record_release(rec);
+	rcu_unregister_thread();
+
+	*count = URCU_TLS(nr_reads);
+	printf_verbose("thread_end %s, tid %lu\n",
+			"reader", urcu_get_thread_id());
+	return ((void*)1);
+
+}
+
+static void free_obj_hp(struct cds_hp_head *head)
+{
+	struct test_obj *obj = caa_container_of(head, struct test_obj, hp_head);
+
+	obj->value = 0;
+	free(obj);
+}
+
+static void free_obj_rcu(struct rcu_head *head)
+{
+	struct test_obj *obj = caa_container_of(head, struct test_obj,
+			hp_head.rcu);
+
+	obj->value = 0;
+	free(obj);
+}
+
+void *thr_writer(void *_count)
+{
+	unsigned long long *count = _count;
+	struct test_obj *new, *old;
+
+	printf_verbose("thread_begin %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+
+	set_affinity();
+
+	rcu_register_thread();
+
+	while (!test_go)
+	{
+	}
+	cmm_smp_mb();
+
+	for (;;) {
+		new = malloc(sizeof(*new));
+		assert(new);
+		new->value = 8;
+		old = rcu_xchg_pointer(&test_rcu_pointer, new);
+		if (caa_unlikely(wduration))
+			loop_sleep(wduration);
+		if (old) {
+			if (test_mode == TEST_MODE_RCU)
+				call_rcu(&old->hp_head.rcu, free_obj_rcu);
+			else
+				cds_hp_retire(test_hp_domain, &old->hp_head,
+					old, free_obj_hp);
+		}
+		URCU_TLS(nr_writes)++;
+		if (caa_unlikely(!test_duration_write()))
+			break;
+		if (caa_unlikely(wdelay))
+			loop_sleep(wdelay);
+	}
+
+	rcu_unregister_thread();
+
+	printf_verbose("thread_end %s, tid %lu\n",
+			"writer", urcu_get_thread_id());
+	*count = URCU_TLS(nr_writes);
+	return ((void*)2);
+}
+
+void show_usage(int argc, char **argv)
+{
+	printf("Usage : %s nr_readers nr_writers duration (s) <OPTIONS>\n",
+		argv[0]);
+	printf("OPTIONS:\n");
+	printf("	[-r] [-w] (yield reader and/or writer)\n");
+	printf("	[-d delay] (writer period (us))\n");
+	printf("	[-c duration] (reader C.S. duration (in loops))\n");
+	printf("	[-e duration] (writer C.S. duration (in loops))\n");
+	printf("	[-v] (verbose output)\n");
+	printf("	[-a cpu#] [-a cpu#]... (affinity)\n");
+	printf("	[-m rcu|hp|rcu_hp] (reader reference mode)\n");
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	int err;
+	pthread_t *tid_reader, *tid_writer;
+	void *tret;
+	unsigned long long *count_reader, *count_writer;
+	unsigned long long tot_reads = 0, tot_writes = 0;
+	int i, a;
+
+	if (argc < 4) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	err = sscanf(argv[1], "%u", &nr_readers);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	err = sscanf(argv[2], "%u", &nr_writers);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+	
+	err = sscanf(argv[3], "%lu", &duration);
+	if (err != 1) {
+		show_usage(argc, argv);
+		return -1;
+	}
+
+	for (i = 4; i < argc; i++) {
+		if (argv[i][0] != '-')
+			continue;
+		switch (argv[i][1]) {
+		case 'r':
+			rcu_debug_yield_enable(RCU_YIELD_READ);
+			break;
+		case 'w':
+			rcu_debug_yield_enable(RCU_YIELD_WRITE);
+			break;
+		case 'a':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			a = atoi(argv[++i]);
+			cpu_affinities[next_aff++] = a;
+			use_affinity = 1;
+			printf_verbose("Adding CPU %d affinity\n", a);
+			break;
+		case 'c':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			rduration = atol(argv[++i]);
+			break;
+		case 'd':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			wdelay = atol(argv[++i]);
+			break;
+		case 'e':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			wduration = atol(argv[++i]);
+			break;
+		case 'v':
+			verbose_mode = 1;
+			break;
+		case 'm':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			i++;
+			if (!strcmp(argv[i], "rcu"))
+				test_mode = TEST_MODE_RCU;
+			else if (!strcmp(argv[i], "hp"))
+				test_mode = TEST_MODE_HP;
+			else if (!strcmp(argv[i], "rcu_hp"))
+				test_mode = TEST_MODE_RCU_HP;
+			else {
+				show_usage(argc, argv);
+				return -1;
+			}
+			break;
+		}
+	}
+
+	test_hp_domain = cds_hp_domain_create();
+	if (!test_hp_domain)
+		exit(1);
+
+	printf_verbose("running test for %lu seconds, %u readers, %u writers.\n",
+		duration, nr_readers, nr_writers);
+	printf_verbose("Writer delay : %lu loops.\n", wdelay);
+	printf_verbose("Reader duration : %lu loops.\n", rduration);
+	printf_verbose("Reader mode : %s.\n", test_mode_str[test_mode]);
+	printf_verbose("thread %-6s, tid %lu\n",
+			"main", urcu_get_thread_id());
+
+	tid_reader = calloc(nr_readers, sizeof(*tid_reader));
+	tid_writer = calloc(nr_writers, sizeof(*tid_writer));
+	count_reader = calloc(nr_readers, sizeof(*count_reader));
+	count_writer = calloc(nr_writers, sizeof(*count_writer));
+
+	next_aff = 0;
+
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_create(&tid_reader[i], NULL, thr_reader,
+				     &count_reader[i]);
+		if (err != 0)
+			exit(1);
+	}
+	for (i = 0; i < nr_writers; i++) {
+		err = pthread_create(&tid_writer[i], NULL, thr_writer,
+				     &count_writer[i]);
+		if (err != 0)
+			exit(1);
+	}
+
+	cmm_smp_mb();
+
+	test_go = 1;
+
+	sleep(duration);
+
+	test_stop = 1;
+
+	for (i = 0; i < nr_readers; i++) {
+		err = pthread_join(tid_reader[i], &tret);
+		if (err != 0)
+			exit(1);
+		tot_reads += count_reader[i];
+	}
+	for (i = 0; i < nr_writers; i++) {
+		err = pthread_join(tid_writer[i], &tret);
+		if (err != 0)
+			exit(1);
+		tot_writes += count_writer[i];
+	}
+	
+	printf_verbose("total number of reads : %llu, writes %llu\n", tot_reads,
+	       tot_writes);
+	printf("SUMMARY %-25s testdur %4lu nr_readers %3u rdur %6lu wdur %6lu "
+		"nr_writers %3u "
+		"wdelay %6lu nr_reads %12llu nr_writes %12llu nr_ops %12llu "
+		"mode %s\n",
+		argv[0], duration, nr_readers, rduration, wduration,
+		nr_writers, wdelay, tot_reads, tot_writes,
+		tot_reads + tot_writes, test_mode_str[test_mode]);
+	rcu_barrier();
+	err = cds_hp_domain_destroy(test_hp_domain);
+	assert(!err);
+	free(test_rcu_pointer);
+	free(tid_reader);
+	free(tid_writer);
+	free(count_reader);
+	free(count_writer);
+	return 0;
+}
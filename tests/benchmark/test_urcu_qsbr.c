@@ -35,6 +35,8 @@
 #include <urcu/tls-compat.h>
 #include "cpuset.h"
 #include "thread-id.h"
+#include "histogram.h"
+#include "perf-counters.h"
 #include "../common/debug-yield.h"
 
 /* hardcoded number of CPUs */
@@ -53,6 +55,14 @@ static int *test_rcu_pointer;
 
 static unsigned long duration;
 
+/* latency sampling period (power of two), 0 to disable */
+static unsigned long hist_period;
+static struct urcu_hist read_hist, sync_hist;
+
+/* hardware counters, if URCU_BENCH_PERF is set */
+static struct urcu_perf_totals read_perf = URCU_PERF_TOTALS_INIT,
+	write_perf = URCU_PERF_TOTALS_INIT;
+
 /* read-side C.S. duration, in loops */
 static unsigned long rduration;
 
@@ -156,11 +166,16 @@ void rcu_copy_mutex_unlock(void)
 void *thr_reader(void *_count)
 {
 	unsigned long long *count = _count;
+	struct urcu_perf_thread perf;
 	int *local_ptr;
+	struct urcu_hist *hist = NULL;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
 
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
 	set_affinity();
 
 	rcu_register_thread();
@@ -174,8 +189,14 @@ void *thr_reader(void *_count)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &read_perf);
 
 	for (;;) {
+		int sample = urcu_hist_sample(hist_period, URCU_TLS(nr_reads));
+		uint64_t start = 0;
+
+		if (sample)
+			start = urcu_hist_now();
 		rcu_read_lock();
 		assert(rcu_read_ongoing());
 		local_ptr = rcu_dereference(test_rcu_pointer);
@@ -185,6 +206,8 @@ void *thr_reader(void *_count)
 		if (caa_unlikely(rduration))
 			loop_sleep(rduration);
 		rcu_read_unlock();
+		if (sample)
+			urcu_hist_record(hist, urcu_hist_now() - start);
 		URCU_TLS(nr_reads)++;
 		/* QS each 1024 reads */
 		if (caa_unlikely((URCU_TLS(nr_reads) & ((1 << 10) - 1)) == 0))
@@ -192,6 +215,7 @@ void *thr_reader(void *_count)
 		if (caa_unlikely(!test_duration_read()))
 			break;
 	}
+	urcu_perf_thread_end(&perf, &read_perf);
 
 	rcu_unregister_thread();
 
@@ -199,6 +223,11 @@ void *thr_reader(void *_count)
 	rcu_register_thread();
 	rcu_unregister_thread();
 
+	if (hist) {
+		urcu_hist_merge(&read_hist, hist);
+		free(hist);
+	}
+
 	*count = URCU_TLS(nr_reads);
 	printf_verbose("thread_end %s, tid %lu\n",
 			"reader", urcu_get_thread_id());
@@ -209,17 +238,23 @@ void *thr_reader(void *_count)
 void *thr_writer(void *_count)
 {
 	unsigned long long *count = _count;
+	struct urcu_perf_thread perf;
 	int *new, *old;
+	struct urcu_hist *hist = NULL;
 
 	printf_verbose("thread_begin %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
 
+	if (hist_period)
+		hist = urcu_hist_alloc();
+
 	set_affinity();
 
 	while (!test_go)
 	{
 	}
 	cmm_smp_mb();
+	urcu_perf_thread_begin(&perf, &write_perf);
 
 	for (;;) {
 		new = malloc(sizeof(int));
@@ -228,7 +263,15 @@ void *thr_writer(void *_count)
 		old = rcu_xchg_pointer(&test_rcu_pointer, new);
 		if (caa_unlikely(wduration))
 			loop_sleep(wduration);
-		synchronize_rcu();
+		if (hist) {
+			/* Grace periods are long enough to time each of them. */
+			uint64_t start = urcu_hist_now();
+
+			synchronize_rcu();
+			urcu_hist_record(hist, urcu_hist_now() - start);
+		} else {
+			synchronize_rcu();
+		}
 		if (old)
 			*old = 0;
 		free(old);
@@ -238,9 +281,14 @@ void *thr_writer(void *_count)
 		if (caa_unlikely(wdelay))
 			loop_sleep(wdelay);
 	}
+	urcu_perf_thread_end(&perf, &write_perf);
 
 	printf_verbose("thread_end %s, tid %lu\n",
 			"writer", urcu_get_thread_id());
+	if (hist) {
+		urcu_hist_merge(&sync_hist, hist);
+		free(hist);
+	}
 	*count = URCU_TLS(nr_writes);
 	return ((void*)2);
 }
@@ -256,6 +304,7 @@ void show_usage(int argc, char **argv)
 	printf("	[-e duration] (writer C.S. duration (in loops))\n");
 	printf("	[-v] (verbose output)\n");
 	printf("	[-a cpu#] [-a cpu#]... (affinity)\n");
+	printf("	[-H period] (latency histograms, sampling one read every period)\n");
 	printf("\n");
 }
 
@@ -335,6 +384,13 @@ int main(int argc, char **argv)
 		case 'v':
 			verbose_mode = 1;
 			break;
+		case 'H':
+			if (argc < i + 2) {
+				show_usage(argc, argv);
+				return -1;
+			}
+			hist_period = urcu_hist_parse_period(argv[++i]);
+			break;
 		}
 	}
 
@@ -352,6 +408,9 @@ int main(int argc, char **argv)
 
 	next_aff = 0;
 
+	urcu_perf_init(&read_perf);
+	urcu_perf_init(&write_perf);
+
 	for (i = 0; i < nr_readers; i++) {
 		err = pthread_create(&tid_reader[i], NULL, thr_reader,
 				     &count_reader[i]);
@@ -394,6 +453,12 @@ int main(int argc, char **argv)
 		argv[0], duration, nr_readers, rduration, wduration,
 		nr_writers, wdelay, tot_reads, tot_writes,
 		tot_reads + tot_writes);
+	urcu_perf_print("reader", &read_perf, nr_readers, tot_reads);
+	urcu_perf_print("writer", &write_perf, nr_writers, tot_writes);
+	if (hist_period) {
+		urcu_hist_print("read", &read_hist);
+		urcu_hist_print("synchronize_rcu", &sync_hist);
+	}
 	free(test_rcu_pointer);
 	free(tid_reader);
 	free(tid_writer);
@@ -0,0 +1,203 @@
+#ifndef _TEST_HISTOGRAM_H
+#define _TEST_HISTOGRAM_H
+
+/*
+ * histogram.h
+ *
+ * Userspace RCU library - log-linear latency histograms for benchmarks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Latencies (in nanoseconds) are recorded into per-thread histograms
+ * with HDR-style log-linear buckets: each power of two range is split
+ * in URCU_HIST_SUB_BUCKETS linear buckets, which bounds the relative
+ * error of reported percentiles to about 3%. Per-thread histograms are
+ * merged into a shared one when threads exit.
+ *
+ * Only one operation every "period" (a power of two) is timed, so the
+ * cost of reading the clock is amortized over the other operations.
+ * Timing uses CLOCK_MONOTONIC, whose vDSO read costs a few tens of
+ * nanoseconds: latencies below that are dominated by the clock itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <urcu/compiler.h>
+#include <urcu/uatomic.h>
+
+#define URCU_HIST_SUB_BITS	5
+#define URCU_HIST_SUB_BUCKETS	(1UL << URCU_HIST_SUB_BITS)
+/* Values below 2 * URCU_HIST_SUB_BUCKETS are recorded exactly. */
+#define URCU_HIST_NR_BUCKETS	((64 - URCU_HIST_SUB_BITS + 1) * URCU_HIST_SUB_BUCKETS)
+
+struct urcu_hist {
+	unsigned long count;
+	unsigned long max;
+	unsigned long buckets[URCU_HIST_NR_BUCKETS];
+};
+
+static inline
+uint64_t urcu_hist_now(void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Return the sampling period for the "-H" option argument, rounded up
+ * to a power of two. 0 disables sampling.
+ */
+static inline
+unsigned long urcu_hist_parse_period(const char *arg)
+{
+	unsigned long period = strtoul(arg, NULL, 0), p;
+
+	if (!period)
+		return 0;
+	for (p = 1; p < period; p <<= 1)
+		;
+	return p;
+}
+
+/*
+ * Non-zero if the operation numbered nr_ops must be timed.
+ */
+static inline
+int urcu_hist_sample(unsigned long period, unsigned long long nr_ops)
+{
+	return caa_unlikely(period) && !(nr_ops & (period - 1));
+}
+
+static inline
+struct urcu_hist *urcu_hist_alloc(void)
+{
+	struct urcu_hist *h;
+
+	h = calloc(1, sizeof(*h));
+	if (!h) {
+		perror("calloc");
+		exit(-1);
+	}
+	return h;
+}
+
+static inline
+unsigned int urcu_hist_index(uint64_t value)
+{
+	unsigned int shift;
+
+	if (value < 2 * URCU_HIST_SUB_BUCKETS)
+		return value;
+	shift = 63 - __builtin_clzll(value) - URCU_HIST_SUB_BITS;
+	return (shift + 1) * URCU_HIST_SUB_BUCKETS
+		+ (value >> shift) - URCU_HIST_SUB_BUCKETS;
+}
+
+/* Highest value recorded in bucket index. */
+static inline
+uint64_t urcu_hist_bucket_value(unsigned int index)
+{
+	unsigned int shift;
+
+	if (index < 2 * URCU_HIST_SUB_BUCKETS)
+		return index;
+	shift = index / URCU_HIST_SUB_BUCKETS - 1;
+	return (((uint64_t) (index % URCU_HIST_SUB_BUCKETS
+			+ URCU_HIST_SUB_BUCKETS) + 1) << shift) - 1;
+}
+
+static inline
+void urcu_hist_record(struct urcu_hist *h, uint64_t value)
+{
+	h->buckets[urcu_hist_index(value)]++;
+	h->count++;
+	if (value > h->max)
+		h->max = value;
+}
+
+/*
+ * Add src into dst. Several threads can merge into the same dst
+ * concurrently.
+ */
+static inline
+void urcu_hist_merge(struct urcu_hist *dst, const struct urcu_hist *src)
+{
+	unsigned long max, old;
+	unsigned int i;
+
+	for (i = 0; i < URCU_HIST_NR_BUCKETS; i++) {
+		if (src->buckets[i])
+			uatomic_add(&dst->buckets[i], src->buckets[i]);
+	}
+	uatomic_add(&dst->count, src->count);
+	max = uatomic_read(&dst->max);
+	while (src->max > max) {
+		old = uatomic_cmpxchg(&dst->max, max, src->max);
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+/*
+ * Value below which fraction "ratio" of the samples fall, rounded up
+ * to the highest value of its bucket.
+ */
+static inline
+uint64_t urcu_hist_percentile(const struct urcu_hist *h, double ratio)
+{
+	unsigned long target, sum = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+	target = (unsigned long) (ratio * h->count);
+	if (target < ratio * h->count)
+		target++;
+	if (!target)
+		target = 1;
+	for (i = 0; i < URCU_HIST_NR_BUCKETS; i++) {
+		sum += h->buckets[i];
+		if (sum >= target)
+			break;
+	}
+	if (urcu_hist_bucket_value(i) > h->max)
+		return h->max;
+	return urcu_hist_bucket_value(i);
+}
+
+/*
+ * Print one "LATENCY" line per operation type, next to the SUMMARY
+ * line of the benchmark. Values are in nanoseconds.
+ */
+static inline
+void urcu_hist_print(const char *op, const struct urcu_hist *h)
+{
+	printf("LATENCY %-25s samples %12lu p50 %10llu p99 %10llu "
+		"p99.9 %10llu max %10lu\n",
+		op, h->count,
+		(unsigned long long) urcu_hist_percentile(h, 0.50),
+		(unsigned long long) urcu_hist_percentile(h, 0.99),
+		(unsigned long long) urcu_hist_percentile(h, 0.999),
+		h->max);
+}
+
+#endif /* _TEST_HISTOGRAM_H */
@@ -0,0 +1,75 @@
+#ifndef _LFHT_TEST_NODE_H
+#define _LFHT_TEST_NODE_H
+
+/*
+ * lfht-test-node.h
+ *
+ * Userspace RCU library - node, hash and match functions shared by the
+ * cds_lfht tests
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <urcu/compiler.h>
+#include <urcu/rculfhash.h>
+
+/*
+ * Node keyed by an unsigned long. Tests needing more data per node
+ * embed it as the "tnode" member of their own node type.
+ * Include after the RCU flavor.
+ */
+struct test_node {
+	struct cds_lfht_node node;
+	unsigned long key;
+	struct rcu_head head;
+};
+
+static inline
+struct test_node *to_test_node(struct cds_lfht_node *node)
+{
+	return caa_container_of(node, struct test_node, node);
+}
+
+static inline
+unsigned long hash_key(unsigned long key)
+{
+	uint64_t h = key;
+
+	/* 64-bit finalizer of MurmurHash3. */
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (unsigned long) h;
+}
+
+/* Match function for cds_lfht_lookup(), key points to an unsigned long. */
+static inline
+int match_key(struct cds_lfht_node *node, const void *key)
+{
+	return to_test_node(node)->key == *(const unsigned long *) key;
+}
+
+/* call_rcu() callback freeing a node allocated with malloc(). */
+static inline
+void free_node_cb(struct rcu_head *head)
+{
+	free(caa_container_of(head, struct test_node, head));
+}
+
+#endif /* _LFHT_TEST_NODE_H */
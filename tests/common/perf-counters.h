@@ -0,0 +1,224 @@
+#ifndef _TEST_PERF_COUNTERS_H
+#define _TEST_PERF_COUNTERS_H
+
+/*
+ * perf-counters.h
+ *
+ * Userspace RCU library - per-thread hardware counters for benchmarks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * When the URCU_BENCH_PERF environment variable is set, benchmark
+ * threads count cycles, instructions, last-level cache misses, dTLB
+ * misses and branch misses around their measured loop with
+ * perf_event_open(2). Counts of all threads of a role (readers or
+ * writers) are summed, and reported per operation on a "PERF" line
+ * next to the SUMMARY line.
+ *
+ * Counters which cannot be opened (no PMU in VMs or containers,
+ * perf_event_paranoid, non-Linux systems) are reported as "n/a"; the
+ * benchmark itself runs unchanged. Counters multiplexed by the kernel
+ * are scaled by their enabled/running time ratio.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+enum urcu_perf_counter {
+	URCU_PERF_CYCLES,
+	URCU_PERF_INSTRUCTIONS,
+	URCU_PERF_LLC_MISSES,
+	URCU_PERF_DTLB_MISSES,
+	URCU_PERF_BRANCH_MISSES,
+	URCU_PERF_NR_COUNTERS,
+};
+
+static const char * const urcu_perf_names[URCU_PERF_NR_COUNTERS] = {
+	[URCU_PERF_CYCLES] = "cycles",
+	[URCU_PERF_INSTRUCTIONS] = "instructions",
+	[URCU_PERF_LLC_MISSES] = "llc_misses",
+	[URCU_PERF_DTLB_MISSES] = "dtlb_misses",
+	[URCU_PERF_BRANCH_MISSES] = "branch_misses",
+};
+
+/* Sum over the threads of a role. */
+struct urcu_perf_totals {
+	pthread_mutex_t lock;
+	int enabled;
+	uint64_t value[URCU_PERF_NR_COUNTERS];
+	unsigned int nr_threads[URCU_PERF_NR_COUNTERS];	/* with counter */
+};
+
+#define URCU_PERF_TOTALS_INIT	{ .lock = PTHREAD_MUTEX_INITIALIZER }
+
+struct urcu_perf_thread {
+	int fd[URCU_PERF_NR_COUNTERS];
+};
+
+static inline
+void urcu_perf_init(struct urcu_perf_totals *totals)
+{
+	totals->enabled = getenv("URCU_BENCH_PERF") != NULL;
+}
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+
+static inline
+void urcu_perf_attr(enum urcu_perf_counter counter,
+		struct perf_event_attr *attr)
+{
+	memset(attr, 0, sizeof(*attr));
+	attr->size = sizeof(*attr);
+	attr->exclude_kernel = 1;
+	attr->exclude_hv = 1;
+	attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+			| PERF_FORMAT_TOTAL_TIME_RUNNING;
+	switch (counter) {
+	case URCU_PERF_CYCLES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case URCU_PERF_INSTRUCTIONS:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case URCU_PERF_LLC_MISSES:
+		attr->type = PERF_TYPE_HW_CACHE;
+		attr->config = PERF_COUNT_HW_CACHE_LL
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case URCU_PERF_DTLB_MISSES:
+		attr->type = PERF_TYPE_HW_CACHE;
+		attr->config = PERF_COUNT_HW_CACHE_DTLB
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case URCU_PERF_BRANCH_MISSES:
+	default:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	}
+}
+
+/*
+ * Start counting for the calling thread. Counters which cannot be
+ * opened are skipped.
+ */
+static inline
+void urcu_perf_thread_begin(struct urcu_perf_thread *pt,
+		const struct urcu_perf_totals *totals)
+{
+	struct perf_event_attr attr;
+	int i;
+
+	for (i = 0; i < URCU_PERF_NR_COUNTERS; i++) {
+		pt->fd[i] = -1;
+		if (!totals->enabled)
+			continue;
+		urcu_perf_attr(i, &attr);
+		pt->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+}
+
+/*
+ * Stop counting for the calling thread and add its counts to totals.
+ */
+static inline
+void urcu_perf_thread_end(struct urcu_perf_thread *pt,
+		struct urcu_perf_totals *totals)
+{
+	uint64_t buf[3];	/* value, time enabled, time running */
+	uint64_t value[URCU_PERF_NR_COUNTERS];
+	int valid[URCU_PERF_NR_COUNTERS];
+	int i;
+
+	for (i = 0; i < URCU_PERF_NR_COUNTERS; i++) {
+		valid[i] = 0;
+		if (pt->fd[i] < 0)
+			continue;
+		(void) ioctl(pt->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(pt->fd[i], buf, sizeof(buf)) == sizeof(buf)
+				&& buf[2]) {
+			value[i] = buf[2] < buf[1] ?
+				(uint64_t) ((double) buf[0] * buf[1] / buf[2]) :
+				buf[0];
+			valid[i] = 1;
+		}
+		(void) close(pt->fd[i]);
+	}
+	pthread_mutex_lock(&totals->lock);
+	for (i = 0; i < URCU_PERF_NR_COUNTERS; i++) {
+		if (!valid[i])
+			continue;
+		totals->value[i] += value[i];
+		totals->nr_threads[i]++;
+	}
+	pthread_mutex_unlock(&totals->lock);
+}
+
+#else /* HAVE_LINUX_PERF_EVENT_H */
+
+static inline
+void urcu_perf_thread_begin(struct urcu_perf_thread *pt,
+		const struct urcu_perf_totals *totals)
+{
+}
+
+static inline
+void urcu_perf_thread_end(struct urcu_perf_thread *pt,
+		struct urcu_perf_totals *totals)
+{
+}
+
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+
+/*
+ * Print the counts per operation of a role, if counting was requested.
+ * Counters unavailable in any thread of the role are reported as n/a.
+ */
+static inline
+void urcu_perf_print(const char *role, const struct urcu_perf_totals *totals,
+		unsigned int nr_threads, unsigned long long nr_ops)
+{
+	int i;
+
+	if (!totals->enabled || !nr_threads)
+		return;
+	printf("PERF %-6s", role);
+	for (i = 0; i < URCU_PERF_NR_COUNTERS; i++) {
+		if (totals->nr_threads[i] != nr_threads || !nr_ops)
+			printf(" %s/op %8s", urcu_perf_names[i], "n/a");
+		else
+			printf(" %s/op %8.2f", urcu_perf_names[i],
+				(double) totals->value[i] / nr_ops);
+	}
+	printf("\n");
+}
+
+#endif /* _TEST_PERF_COUNTERS_H */
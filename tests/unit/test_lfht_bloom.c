@@ -0,0 +1,269 @@
+/*
+ * test_lfht_bloom.c
+ *
+ * Userspace RCU library - test the hash table Bloom filter
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+#include "rculfhash-internal.h"
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+#define NR_KEYS		20000
+/* Keys from ABSENT_BASE on are never added. */
+#define ABSENT_BASE	(1UL << 24)
+#define NR_PROBES	100000
+#define BITS_PER_NODE	10
+/* Expected rate is about 1% at 10 bits per node; allow for blocking. */
+#define MAX_FP_PERCENT	5
+/* Buckets of the fixed-size table, nodes it holds, and their turnover. */
+#define FIXED_SIZE	1024
+#define FIXED_NODES	1000
+#define NR_CHURN	50000
+
+static struct cds_lfht *ht;
+static volatile int test_stop;
+
+static void add_key(unsigned long key)
+{
+	struct test_node *tnode;
+
+	tnode = malloc(sizeof(*tnode));
+	if (!tnode)
+		abort();
+	cds_lfht_node_init(&tnode->node);
+	tnode->key = key;
+	rcu_read_lock();
+	cds_lfht_add(ht, hash_key(key), &tnode->node);
+	rcu_read_unlock();
+}
+
+static int has_key(unsigned long key)
+{
+	struct cds_lfht_iter iter;
+	int found;
+
+	rcu_read_lock();
+	cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+	found = cds_lfht_iter_get_node(&iter) != NULL;
+	rcu_read_unlock();
+	return found;
+}
+
+/* Number of keys in [first, first + nr) with the given stride found. */
+static unsigned long nr_found(unsigned long first, unsigned long nr,
+		unsigned long stride)
+{
+	unsigned long i, found = 0;
+
+	for (i = 0; i < nr; i++)
+		found += has_key(first + i * stride);
+	return found;
+}
+
+/* Percentage of keys in [first, first + nr) passing the filter. */
+static unsigned long fp_percent(unsigned long first, unsigned long nr,
+		unsigned long stride)
+{
+	struct cds_lfht_bloom *bloom;
+	unsigned long i, pass = 0;
+
+	rcu_read_lock();
+	bloom = rcu_dereference(ht->bloom);
+	for (i = 0; i < nr; i++)
+		pass += cds_lfht_bloom_test(bloom, hash_key(first + i * stride));
+	rcu_read_unlock();
+	return pass * 100 / nr;
+}
+
+static void del_keys(unsigned long first, unsigned long nr,
+		unsigned long stride)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	unsigned long i, key;
+
+	for (i = 0; i < nr; i++) {
+		key = first + i * stride;
+		rcu_read_lock();
+		cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+		node = cds_lfht_iter_get_node(&iter);
+		if (node && !cds_lfht_del(ht, node))
+			call_rcu(&caa_container_of(node, struct test_node,
+					node)->head, free_node_cb);
+		rcu_read_unlock();
+	}
+}
+
+static void resize_done(struct cds_lfht *table, unsigned long size,
+		void *priv)
+{
+	uatomic_set((int *) priv, 1);
+}
+
+/*
+ * Wait for the work queued on the resize worker, which runs in order,
+ * by queueing a resize to the current size.
+ */
+static void flush_resize_worker(unsigned long size)
+{
+	int done = 0;
+
+	if (cds_lfht_resize_async(ht, size, resize_done, &done))
+		abort();
+	while (!uatomic_read(&done))
+		(void) poll(NULL, 0, 1);
+}
+
+/* Add keys and look each one up right away, while the table resizes. */
+static void *thr_adder(void *arg)
+{
+	unsigned long key, missing = 0;
+
+	rcu_register_thread();
+	for (key = NR_KEYS; key < 2 * NR_KEYS; key++) {
+		add_key(key);
+		if (!has_key(key))
+			missing++;
+	}
+	test_stop = 1;
+	rcu_unregister_thread();
+	return (void *) missing;
+}
+
+/* Look up the first keys while the table resizes. */
+static void *thr_reader(void *arg)
+{
+	unsigned long key = 0, missing = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		if (!has_key(key))
+			missing++;
+		key = (key + 1) % NR_KEYS;
+	}
+	rcu_unregister_thread();
+	return (void *) missing;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t adder, reader;
+	void *adder_ret, *reader_ret;
+	unsigned long i, fp;
+
+	plan_tests(13);
+
+	rcu_register_thread();
+
+	ht = cds_lfht_new(1, 1, 0, 0, NULL);
+	if (!ht)
+		return -1;
+
+	ok(cds_lfht_bloom_enable(ht, 0, 0) == -EINVAL
+		&& cds_lfht_bloom_enable(ht, 65, 0) == -EINVAL
+		&& cds_lfht_bloom_enable(ht, BITS_PER_NODE, 17) == -EINVAL
+		&& !ht->bloom, "invalid parameters");
+	ok(!cds_lfht_bloom_enable(ht, BITS_PER_NODE, 0) && ht->bloom
+		&& ht->bloom->nr_hashes == BITS_PER_NODE * 69 / 100,
+		"enable with the default number of hash functions");
+
+	for (i = 0; i < NR_KEYS; i++)
+		add_key(i);
+	ok(nr_found(0, NR_KEYS, 1) == NR_KEYS,
+		"every key added after enable is found");
+	ok(!nr_found(ABSENT_BASE, NR_PROBES, 1), "absent keys are not found");
+
+	/* Resizing resizes the filter to the number of nodes. */
+	cds_lfht_resize(ht, 1UL << 15);
+	fp = fp_percent(ABSENT_BASE, NR_PROBES, 1);
+	ok(fp <= MAX_FP_PERCENT && nr_found(0, NR_KEYS, 1) == NR_KEYS,
+		"false positive rate after resize (%lu%%)", fp);
+
+	/* Rebuilding on resize drops the bits of removed nodes. */
+	del_keys(0, NR_KEYS / 2, 2);
+	cds_lfht_resize(ht, 1UL << 13);
+	fp = fp_percent(0, NR_KEYS / 2, 2);
+	ok(fp <= MAX_FP_PERCENT && nr_found(1, NR_KEYS / 2, 2) == NR_KEYS / 2
+		&& !nr_found(0, NR_KEYS / 2, 2),
+		"removed keys are forgotten on resize (%lu%%)", fp);
+	for (i = 0; i < NR_KEYS; i += 2)
+		add_key(i);
+
+	if (pthread_create(&adder, NULL, thr_adder, NULL)
+			|| pthread_create(&reader, NULL, thr_reader, NULL))
+		return -1;
+	for (i = 0; !test_stop; i++)
+		cds_lfht_resize(ht, 1UL << (4 + i % 12));
+	if (pthread_join(adder, &adder_ret) || pthread_join(reader, &reader_ret))
+		return -1;
+	ok(!adder_ret && !reader_ret && i > 0,
+		"no key missed during %lu concurrent resizes", i);
+	ok(nr_found(0, 2 * NR_KEYS, 1) == 2 * NR_KEYS,
+		"every key found after concurrent adds");
+
+	ok(!cds_lfht_bloom_enable(ht, 2 * BITS_PER_NODE, 4)
+		&& ht->bloom->nr_hashes == 4
+		&& nr_found(0, 2 * NR_KEYS, 1) == 2 * NR_KEYS,
+		"enable again with other parameters");
+
+	cds_lfht_bloom_disable(ht);
+	ok(!ht->bloom && nr_found(0, 2 * NR_KEYS, 1) == 2 * NR_KEYS
+		&& !nr_found(ABSENT_BASE, NR_PROBES, 1),
+		"lookups after disable");
+
+	del_keys(0, 2 * NR_KEYS, 1);
+	ok(!cds_lfht_bloom_enable(ht, BITS_PER_NODE, 0)
+		&& !cds_lfht_destroy(ht, NULL), "destroy with a filter");
+
+	/*
+	 * Fixed-size table: removals queue rebuilds of the filter, which
+	 * no resize rebuilds. The nodes turn over 50 times.
+	 */
+	ht = cds_lfht_new(FIXED_SIZE, FIXED_SIZE, FIXED_SIZE, 0, NULL);
+	if (!ht || cds_lfht_bloom_enable(ht, BITS_PER_NODE, 0))
+		return -1;
+	for (i = 0; i < FIXED_NODES; i++)
+		add_key(i);
+	for (i = 0; i < NR_CHURN; i++) {
+		del_keys(i, 1, 1);
+		add_key(i + FIXED_NODES);
+	}
+	flush_resize_worker(FIXED_SIZE);
+	ok(nr_found(NR_CHURN, FIXED_NODES, 1) == FIXED_NODES
+		&& !nr_found(0, NR_CHURN, 1),
+		"lookups after removals on a fixed-size table");
+	fp = fp_percent(ABSENT_BASE, NR_PROBES, 1);
+	ok(fp <= MAX_FP_PERCENT && fp_percent(0, NR_CHURN, 1) <= MAX_FP_PERCENT,
+		"removals do not fill the filter up (%lu%%)", fp);
+	del_keys(NR_CHURN, FIXED_NODES, 1);
+	if (cds_lfht_destroy(ht, NULL))
+		return -1;
+
+	rcu_unregister_thread();
+	return exit_status();
+}
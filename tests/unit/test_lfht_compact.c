@@ -0,0 +1,200 @@
+/*
+ * test_lfht_compact.c
+ *
+ * Userspace RCU library - test the compact bucket node backend of the
+ * RCU lock-free hash table
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+#include "rculfhash-internal.h"
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+#define NR_KEYS		10000
+#define MAX_BUCKETS	(1UL << 16)
+#define NR_RESIZES	20
+
+static struct cds_lfht *ht;
+static volatile int test_stop;
+
+static void add_key(unsigned long key)
+{
+	struct test_node *tnode;
+
+	tnode = malloc(sizeof(*tnode));
+	if (!tnode)
+		abort();
+	cds_lfht_node_init(&tnode->node);
+	tnode->key = key;
+	rcu_read_lock();
+	cds_lfht_add(ht, hash_key(key), &tnode->node);
+	rcu_read_unlock();
+}
+
+/* Call with rcu_read_lock held. */
+static struct test_node *lookup(unsigned long key)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+
+	cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+	node = cds_lfht_iter_get_node(&iter);
+	return node ? to_test_node(node) : NULL;
+}
+
+/* Number of keys in [first, last) found in the table. */
+static unsigned long nr_found(unsigned long first, unsigned long last)
+{
+	unsigned long key, nr = 0;
+
+	rcu_read_lock();
+	for (key = first; key < last; key++)
+		if (lookup(key))
+			nr++;
+	rcu_read_unlock();
+	return nr;
+}
+
+static unsigned long count(void)
+{
+	unsigned long nr;
+	long before, after;
+
+	rcu_read_lock();
+	cds_lfht_count_nodes(ht, &before, &nr, &after);
+	rcu_read_unlock();
+	return nr;
+}
+
+/* Delete the keys in [first, last), return the number deleted. */
+static unsigned long del_keys(unsigned long first, unsigned long last)
+{
+	struct test_node *tnode;
+	unsigned long key, nr = 0;
+
+	rcu_read_lock();
+	for (key = first; key < last; key++) {
+		tnode = lookup(key);
+		if (tnode && !cds_lfht_del(ht, &tnode->node)) {
+			call_rcu(&tnode->head, free_node_cb);
+			nr++;
+		}
+	}
+	rcu_read_unlock();
+	return nr;
+}
+
+/* Keys below NR_KEYS / 2 stay in the table while it is resized. */
+static void *thr_reader(void *arg)
+{
+	unsigned long key = 0, missing = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		if (!lookup(key))
+			missing++;
+		rcu_read_unlock();
+		key = (key + 1) % (NR_KEYS / 2);
+	}
+	rcu_unregister_thread();
+	return (void *) missing;
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_lfht_node *node, *ret_node;
+	struct test_node *tnode, dup;
+	unsigned long i, key;
+	pthread_t reader;
+	void *tret;
+
+	plan_tests(10);
+
+	rcu_register_thread();
+
+	ok(sizeof(struct cds_lfht_compact_bucket) == 8,
+		"compact bucket nodes take 8 bytes");
+
+	ht = _cds_lfht_new(1, 1, MAX_BUCKETS, 0, &cds_lfht_mm_mmap_compact,
+			&rcu_flavor, NULL);
+	if (!ht)
+		return -1;
+
+	for (i = 0; i < NR_KEYS; i++)
+		add_key(i);
+	ok(nr_found(0, NR_KEYS) == NR_KEYS && count() == NR_KEYS,
+		"add and lookup");
+	ok(!nr_found(NR_KEYS, 2 * NR_KEYS), "absent keys are not found");
+
+	/* Unique add and replace. */
+	key = 42;
+	cds_lfht_node_init(&dup.node);
+	dup.key = key;
+	rcu_read_lock();
+	ret_node = cds_lfht_add_unique(ht, hash_key(key), match_key, &key,
+			&dup.node);
+	ok(ret_node != &dup.node && to_test_node(ret_node)->key == key,
+		"add_unique returns the existing node");
+	node = cds_lfht_add_replace(ht, hash_key(key), match_key, &key,
+			&dup.node);
+	ok(node == ret_node && lookup(key) == &dup,
+		"add_replace replaces the existing node");
+	rcu_read_unlock();
+	call_rcu(&to_test_node(node)->head, free_node_cb);
+
+	/* Resize up and down, with a reader looking up the lower keys. */
+	ok(del_keys(NR_KEYS / 2, NR_KEYS) == NR_KEYS / 2
+		&& nr_found(0, NR_KEYS) == NR_KEYS / 2,
+		"delete");
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		return -1;
+	for (i = 0; i < NR_RESIZES; i++)
+		cds_lfht_resize(ht, i & 1 ? 1 : MAX_BUCKETS);
+	cds_lfht_resize(ht, 1UL << 12);
+	test_stop = 1;
+	if (pthread_join(reader, &tret))
+		return -1;
+	ok(!tret, "readers find every key while the table is resized");
+	ok(nr_found(0, NR_KEYS) == NR_KEYS / 2 && count() == NR_KEYS / 2,
+		"resize keeps the nodes");
+
+	for (i = NR_KEYS / 2; i < NR_KEYS; i++)
+		add_key(i);
+	ok(nr_found(0, NR_KEYS) == NR_KEYS, "add after resize");
+
+	/* dup is not allocated: remove it before freeing the others. */
+	rcu_read_lock();
+	tnode = lookup(key);
+	if (tnode == &dup)
+		cds_lfht_del(ht, &dup.node);
+	rcu_read_unlock();
+	del_keys(0, NR_KEYS);
+	ok(!cds_lfht_destroy(ht, NULL), "destroy");
+
+	rcu_barrier();
+	rcu_unregister_thread();
+	return exit_status();
+}
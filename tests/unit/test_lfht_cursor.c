@@ -0,0 +1,196 @@
+/*
+ * test_lfht_cursor.c
+ *
+ * Userspace RCU library - test hash table traversal cursors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+/* Stable keys share their hash value four by four. */
+#define NR_STABLE	4096
+#define DUP_SHIFT	2
+#define NR_TRANSIENT	1024
+
+static struct cds_lfht *ht;
+static struct test_node stable[NR_STABLE];
+static unsigned int seen[NR_STABLE];
+static volatile int test_stop, gp_done;
+
+static unsigned long stable_hash(unsigned long key)
+{
+	return hash_key(key >> DUP_SHIFT);
+}
+
+/*
+ * Scan the table with a cursor, counting visits of stable nodes.
+ * Returns the number of nodes visited, or -1 if a stable node was seen
+ * twice.
+ */
+static long scan(unsigned long batch, int slow)
+{
+	struct cds_lfht_cursor cursor;
+	struct test_node *tnode;
+	long nr = 0;
+	int dup = 0;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry_cursor(ht, &cursor, batch, tnode, node) {
+		if (tnode->key < NR_STABLE && seen[tnode->key]++)
+			dup = 1;
+		nr++;
+		/* Let concurrent threads run while we are between yields. */
+		if (slow && !(nr & 15))
+			sched_yield();
+	}
+	rcu_read_unlock();
+	return dup ? -1 : nr;
+}
+
+static int all_seen_once(void)
+{
+	unsigned long i;
+	int ret = 1;
+
+	for (i = 0; i < NR_STABLE; i++) {
+		if (seen[i] != 1)
+			ret = 0;
+		seen[i] = 0;
+	}
+	return ret;
+}
+
+static void *thr_sync(void *arg)
+{
+	rcu_register_thread();
+	synchronize_rcu();
+	gp_done = 1;
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/* Add and remove transient nodes, and resize the table back and forth. */
+static void *thr_mutate(void *arg)
+{
+	struct cds_lfht_iter iter;
+	struct test_node *tnode;
+	unsigned long i, round = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		for (i = 0; i < NR_TRANSIENT; i++) {
+			tnode = calloc(1, sizeof(*tnode));
+			if (!tnode)
+				abort();
+			tnode->key = NR_STABLE + i;
+			rcu_read_lock();
+			cds_lfht_add(ht, hash_key(tnode->key), &tnode->node);
+			rcu_read_unlock();
+		}
+		cds_lfht_resize(ht, (round++ & 1) ? 1UL << 4 : 1UL << 12);
+		rcu_read_lock();
+		cds_lfht_for_each_entry(ht, &iter, tnode, node) {
+			if (tnode->key < NR_STABLE)
+				continue;
+			if (!cds_lfht_del(ht, &tnode->node))
+				call_rcu(&tnode->head, free_node_cb);
+		}
+		rcu_read_unlock();
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_lfht_cursor cursor;
+	pthread_t tid;
+	unsigned long i;
+	long nr;
+
+	plan_tests(8);
+
+	rcu_register_thread();
+
+	ht = cds_lfht_new(1, 1, 1UL << 16, 0, NULL);
+	if (!ht)
+		return -1;
+
+	rcu_read_lock();
+	cds_lfht_cursor_first(ht, &cursor, 1);
+	ok(!cds_lfht_cursor_get_node(&cursor), "empty table");
+	rcu_read_unlock();
+
+	for (i = 0; i < NR_STABLE; i++) {
+		stable[i].key = i;
+		rcu_read_lock();
+		cds_lfht_add(ht, stable_hash(i), &stable[i].node);
+		rcu_read_unlock();
+	}
+	cds_lfht_resize(ht, 1UL << 10);
+
+	nr = scan(0, 0);
+	ok(nr == NR_STABLE && all_seen_once(), "scan without yields");
+	nr = scan(1, 0);
+	ok(nr == NR_STABLE && all_seen_once(),
+		"yield every node, duplicates seen once");
+	nr = scan(7, 0);
+	ok(nr == NR_STABLE && all_seen_once(), "yield every 7 nodes");
+
+	if (pthread_create(&tid, NULL, thr_sync, NULL))
+		return -1;
+	nr = scan(16, 1);
+	ok(gp_done && nr == NR_STABLE && all_seen_once(),
+		"grace period completes during a scan");
+	if (pthread_join(tid, NULL))
+		return -1;
+
+	if (pthread_create(&tid, NULL, thr_mutate, NULL))
+		return -1;
+	for (i = 0; i < 10; i++) {
+		nr = scan(3, 1);
+		if (nr < 0 || !all_seen_once())
+			break;
+	}
+	ok(i == 10, "stable nodes seen once under adds, removals and resizes");
+	test_stop = 1;
+	if (pthread_join(tid, NULL))
+		return -1;
+	rcu_barrier();
+
+	rcu_read_lock();
+	for (i = 0; i < NR_STABLE; i++)
+		(void) cds_lfht_del(ht, &stable[i].node);
+	rcu_read_unlock();
+	nr = scan(5, 0);
+	ok(nr == 0, "empty after removals");
+	ok(!cds_lfht_destroy(ht, NULL), "destroy");
+
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,229 @@
+/*
+ * test_lfht_replica.c
+ *
+ * Userspace RCU library - test the NUMA-replicated hash table
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash-replica.h>
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+/* More replicas than the test machine likely has NUMA nodes. */
+#define NR_REPLICAS	4
+#define NR_KEYS		1024
+#define NR_REPLACE	200
+
+struct replica_node {
+	struct test_node tnode;
+	unsigned long value;
+	int numa_node;
+};
+
+static struct cds_lfht_replica *map;
+static unsigned long nr_copies, nr_frees;
+static int fail_copy = -1;
+static volatile int test_stop;
+
+static struct cds_lfht_node *copy_node(struct cds_lfht_node *node,
+		int numa_node, void *priv)
+{
+	struct replica_node *rnode = caa_container_of(node,
+			struct replica_node, tnode.node);
+	struct replica_node *copy;
+
+	if (numa_node == fail_copy)
+		return NULL;
+	copy = malloc(sizeof(*copy));
+	if (!copy)
+		return NULL;
+	*copy = *rnode;
+	cds_lfht_node_init(&copy->tnode.node);
+	copy->numa_node = numa_node;
+	uatomic_inc(&nr_copies);
+	return &copy->tnode.node;
+}
+
+static void free_node(struct cds_lfht_node *node, void *priv)
+{
+	free(caa_container_of(node, struct replica_node, tnode.node));
+	uatomic_inc(&nr_frees);
+}
+
+/* Value of key in a replica, 0 if absent. Call with rcu_read_lock held. */
+static unsigned long replica_value(struct cds_lfht *ht, unsigned long key,
+		int *numa_node)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	struct replica_node *rnode;
+
+	cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+	node = cds_lfht_iter_get_node(&iter);
+	if (!node)
+		return 0;
+	rnode = caa_container_of(node, struct replica_node, tnode.node);
+	if (numa_node)
+		*numa_node = rnode->numa_node;
+	return rnode->value;
+}
+
+/* Number of replicas in which key has the given value. */
+static unsigned long nr_replicas_with(unsigned long key, unsigned long value)
+{
+	unsigned long i, nr = 0;
+	int numa_node = -1;
+
+	rcu_read_lock();
+	for (i = 0; i < NR_REPLICAS; i++) {
+		if (replica_value(cds_lfht_replica_get(map, i), key,
+				&numa_node) == value && numa_node == (int) i)
+			nr++;
+	}
+	rcu_read_unlock();
+	return nr;
+}
+
+/* Look up key 0 while it is being replaced: it must never be missing. */
+static void *thr_reader(void *arg)
+{
+	struct cds_lfht_iter iter;
+	unsigned long key = 0;
+	long missing = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		cds_lfht_replica_lookup(map, hash_key(key), match_key, &key,
+				&iter);
+		if (!cds_lfht_iter_get_node(&iter))
+			missing++;
+		rcu_read_unlock();
+	}
+	rcu_unregister_thread();
+	return (void *) missing;
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_lfht_iter iter;
+	struct replica_node proto;
+	unsigned long i, key, nr_ok;
+	pthread_t tid;
+	void *tret;
+	int ret = 0;
+
+	plan_tests(12);
+
+	rcu_register_thread();
+
+	ok(!cds_lfht_replica_new(NR_REPLICAS, 1, 1, 0, 0, NULL, free_node,
+			NULL, NULL), "copy hook is required");
+	map = cds_lfht_replica_new(0, 1, 1, 0, 0, copy_node, free_node,
+			NULL, NULL);
+	ok(map && cds_lfht_replica_nr_replicas(map) >= 1
+			&& !cds_lfht_replica_destroy(map, NULL),
+		"one replica per NUMA node by default");
+
+	map = cds_lfht_replica_new(NR_REPLICAS, 1, 1, 0,
+			CDS_LFHT_AUTO_RESIZE, copy_node, free_node, NULL, NULL);
+	if (!map)
+		return -1;
+
+	for (i = 0; i < NR_KEYS; i++) {
+		proto.tnode.key = i;
+		proto.value = i + 1;
+		if (cds_lfht_replica_add_unique(map, hash_key(i), match_key,
+				&proto.tnode.key, &proto.tnode.node))
+			ret = -1;
+	}
+	for (i = 0, nr_ok = 0; i < NR_KEYS; i++)
+		if (nr_replicas_with(i, i + 1) == NR_REPLICAS)
+			nr_ok++;
+	ok(!ret && nr_ok == NR_KEYS && nr_copies == NR_KEYS * NR_REPLICAS,
+		"every replica holds its own copy of every key");
+
+	proto.tnode.key = 42;
+	proto.value = 0;
+	ok(cds_lfht_replica_add_unique(map, hash_key(42), match_key,
+			&proto.tnode.key, &proto.tnode.node) == -EEXIST
+		&& nr_replicas_with(42, 43) == NR_REPLICAS,
+		"add unique of an existing key");
+
+	key = 7;
+	rcu_read_lock();
+	cds_lfht_replica_lookup(map, hash_key(key), match_key, &key, &iter);
+	ok(cds_lfht_iter_get_node(&iter) && replica_value(
+			cds_lfht_replica_local(map), key, NULL) == 8,
+		"lookup in the local replica");
+	rcu_read_unlock();
+
+	proto.tnode.key = 7;
+	proto.value = 1000;
+	ok(!cds_lfht_replica_add_replace(map, hash_key(7), match_key,
+			&proto.tnode.key, &proto.tnode.node)
+		&& nr_replicas_with(7, 1000) == NR_REPLICAS
+		&& nr_frees == NR_REPLICAS,
+		"replace in every replica, release the old copies");
+
+	fail_copy = NR_REPLICAS - 1;
+	proto.value = 2000;
+	ok(cds_lfht_replica_add_replace(map, hash_key(7), match_key,
+			&proto.tnode.key, &proto.tnode.node) == -ENOMEM
+		&& nr_replicas_with(7, 1000) == NR_REPLICAS
+		&& nr_frees == 2 * NR_REPLICAS - 1,
+		"failed copy leaves every replica unchanged");
+	fail_copy = -1;
+
+	ok(!cds_lfht_replica_del(map, hash_key(7), match_key, &key)
+		&& !nr_replicas_with(7, 1000)
+		&& nr_frees == 3 * NR_REPLICAS - 1,
+		"delete from every replica");
+	ok(cds_lfht_replica_del(map, hash_key(7), match_key, &key) == -ENOENT,
+		"delete of a missing key");
+
+	if (pthread_create(&tid, NULL, thr_reader, NULL))
+		return -1;
+	proto.tnode.key = 0;
+	for (i = 0; i < NR_REPLACE; i++) {
+		proto.value = i;
+		if (cds_lfht_replica_add_replace(map, hash_key(0), match_key,
+				&proto.tnode.key, &proto.tnode.node))
+			ret = -1;
+	}
+	test_stop = 1;
+	if (pthread_join(tid, &tret))
+		return -1;
+	ok(!ret && !tret && nr_replicas_with(0, NR_REPLACE - 1) == NR_REPLICAS,
+		"replacements never hide the key from readers");
+
+	ok(nr_copies - nr_frees == (NR_KEYS - 1) * NR_REPLICAS,
+		"copies in use match the replica contents");
+	ok(!cds_lfht_replica_destroy(map, NULL) && nr_copies == nr_frees,
+		"destroy releases the remaining copies");
+
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,211 @@
+/*
+ * test_lfht_resize_async.c
+ *
+ * Userspace RCU library - test asynchronous hash table resize
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <poll.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash.h>
+#include "rculfhash-internal.h"
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+#define NR_KEYS		1000
+#define RESERVE_NODES	(1UL << 14)
+/* Wait at most 10s for background resizes. */
+#define WAIT_LOOPS	1000
+
+struct done_count {
+	unsigned long nr;
+	unsigned long size;
+};
+
+static void del_node(struct cds_lfht *ht, struct cds_lfht_node *node)
+{
+	if (!cds_lfht_del(ht, node))
+		call_rcu(&caa_container_of(node, struct test_node,
+				node)->head, free_node_cb);
+}
+
+static void resize_done(struct cds_lfht *ht, unsigned long size, void *priv)
+{
+	struct done_count *done = priv;
+
+	CMM_STORE_SHARED(done->size, size);
+	cmm_smp_wmb();
+	uatomic_inc(&done->nr);
+}
+
+/* Wait for nr resizes to be done, return the size after the last. */
+static unsigned long wait_done(struct done_count *done, unsigned long nr)
+{
+	int i;
+
+	for (i = 0; i < WAIT_LOOPS && uatomic_read(&done->nr) < nr; i++)
+		(void) poll(NULL, 0, 10);
+	cmm_smp_rmb();
+	return uatomic_read(&done->nr) == nr ? CMM_LOAD_SHARED(done->size) : 0;
+}
+
+static int wait_size(struct cds_lfht *ht, unsigned long size)
+{
+	int i;
+
+	for (i = 0; i < WAIT_LOOPS && CMM_LOAD_SHARED(ht->size) != size; i++)
+		(void) poll(NULL, 0, 10);
+	return CMM_LOAD_SHARED(ht->size) == size;
+}
+
+static void add_keys(struct cds_lfht *ht, unsigned long first,
+		unsigned long last)
+{
+	struct test_node *tnode;
+	unsigned long key;
+
+	for (key = first; key < last; key++) {
+		tnode = malloc(sizeof(*tnode));
+		if (!tnode)
+			abort();
+		cds_lfht_node_init(&tnode->node);
+		tnode->key = key;
+		rcu_read_lock();
+		cds_lfht_add(ht, hash_key(key), &tnode->node);
+		rcu_read_unlock();
+	}
+}
+
+static unsigned long nr_found(struct cds_lfht *ht, unsigned long first,
+		unsigned long last)
+{
+	struct cds_lfht_iter iter;
+	unsigned long key, nr = 0;
+
+	rcu_read_lock();
+	for (key = first; key < last; key++) {
+		cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+		if (cds_lfht_iter_get_node(&iter))
+			nr++;
+	}
+	rcu_read_unlock();
+	return nr;
+}
+
+static void del_keys(struct cds_lfht *ht, unsigned long first,
+		unsigned long last)
+{
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *node;
+	unsigned long key;
+
+	rcu_read_lock();
+	for (key = first; key < last; key++) {
+		cds_lfht_lookup(ht, hash_key(key), match_key, &key, &iter);
+		node = cds_lfht_iter_get_node(&iter);
+		if (node)
+			del_node(ht, node);
+	}
+	rcu_read_unlock();
+}
+
+static void free_all(struct cds_lfht *ht)
+{
+	struct cds_lfht_iter iter;
+	struct test_node *tnode;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(ht, &iter, tnode, node)
+		del_node(ht, &tnode->node);
+	rcu_read_unlock();
+}
+
+int main(int argc, char **argv)
+{
+	struct done_count done = { 0, 0 };
+	struct cds_lfht *ht;
+	int ret;
+
+	plan_tests(9);
+
+	rcu_register_thread();
+
+	/* Table without automatic resize, hence without resize worker. */
+	ht = cds_lfht_new(1, 1, 0, 0, NULL);
+	if (!ht)
+		return -1;
+	add_keys(ht, 0, NR_KEYS);
+	ok(!cds_lfht_resize_async(ht, 1UL << 10, resize_done, &done)
+		&& wait_done(&done, 1) == 1UL << 10
+		&& nr_found(ht, 0, NR_KEYS) == NR_KEYS,
+		"grow a table without automatic resize");
+
+	rcu_read_lock();
+	ret = cds_lfht_resize_async(ht, 3000, resize_done, &done);
+	rcu_read_unlock();
+	ok(!ret && wait_done(&done, 2) == 1UL << 12,
+		"resize from a read-side critical section, to a power of 2");
+
+	ok(!cds_lfht_resize_async(ht, 1, resize_done, &done)
+		&& wait_done(&done, 3) == 1
+		&& nr_found(ht, 0, NR_KEYS) == NR_KEYS,
+		"shrink");
+
+	ok(!cds_lfht_reserve(ht, RESERVE_NODES)
+		&& wait_size(ht, RESERVE_NODES)
+		&& ht->reserve_size == RESERVE_NODES,
+		"reserve grows the table");
+	ok(!cds_lfht_reserve(ht, 1) && CMM_LOAD_SHARED(ht->size)
+			== RESERVE_NODES
+		&& !cds_lfht_reserve(ht, 0) && !ht->reserve_size,
+		"reserve never shrinks, and can be cancelled");
+
+	/* Destroy waits for the queued resizes. */
+	free_all(ht);
+	ret = cds_lfht_resize_async(ht, 1UL << 16, resize_done, &done);
+	ok(!ret && !cds_lfht_destroy(ht, NULL)
+		&& uatomic_read(&done.nr) == 4, "destroy with a queued resize");
+
+	ht = cds_lfht_new(1, 1, 0,
+		CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	if (!ht)
+		return -1;
+	ok(!cds_lfht_reserve(ht, RESERVE_NODES)
+		&& wait_size(ht, RESERVE_NODES),
+		"reserve grows an automatically resized table");
+	/* Enough deletes to make automatic resize shrink an empty table. */
+	add_keys(ht, 0, 4 * NR_KEYS);
+	del_keys(ht, 0, 4 * NR_KEYS);
+	(void) poll(NULL, 0, 100);
+	ok(wait_size(ht, RESERVE_NODES),
+		"no automatic shrink while the table is not used");
+	add_keys(ht, 4 * NR_KEYS, 4 * NR_KEYS + 4 * RESERVE_NODES);
+	ok(!CMM_LOAD_SHARED(ht->reserve_size)
+		&& nr_found(ht, 4 * NR_KEYS, 4 * NR_KEYS + 4 * RESERVE_NODES)
+			== 4 * RESERVE_NODES,
+		"the reservation ends once the table holds the nodes");
+	free_all(ht);
+	(void) cds_lfht_destroy(ht, NULL);
+
+	rcu_unregister_thread();
+	return exit_status();
+}
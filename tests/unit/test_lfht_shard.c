@@ -0,0 +1,185 @@
+/*
+ * test_lfht_shard.c
+ *
+ * Userspace RCU library - test the sharded hash table
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash-shard.h>
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+#define SHARD_ORDER	4
+#define NR_SHARDS	(1UL << SHARD_ORDER)
+#define NR_KEYS		8192
+
+static struct test_node nodes[NR_KEYS], replace_node, dup_node;
+
+static struct cds_lfht_node *lookup(struct cds_lfht_shard *map,
+		unsigned long key)
+{
+	struct cds_lfht_shard_iter iter;
+
+	cds_lfht_shard_lookup(map, hash_key(key), match_key, &key, &iter);
+	return cds_lfht_shard_iter_get_node(&iter);
+}
+
+/* 32-bit hash value, as given by jhash-like functions. */
+static unsigned long hash_key32(unsigned long key)
+{
+	return (uint32_t) hash_key(key);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long per_shard[NR_SHARDS] = { 0 };
+	struct cds_lfht_shard_stats stats;
+	struct cds_lfht_shard_iter iter;
+	struct cds_lfht_iter shard_iter;
+	struct cds_lfht_node *node;
+	struct cds_lfht_shard *map;
+	unsigned long i, key, count, nr = 0, nr_found = 0, nr_routed = 0;
+	long before, after;
+	int ret = 0;
+
+	plan_tests(13);
+
+	rcu_register_thread();
+
+	ok(!cds_lfht_shard_new(CAA_BITS_PER_LONG, 1, 1, 0, 0, NULL),
+		"shard order too large");
+	map = cds_lfht_shard_new(SHARD_ORDER, 1, 1, 0,
+			CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	if (!map)
+		return -1;
+
+	rcu_read_lock();
+	for (i = 0; i < NR_KEYS; i++) {
+		nodes[i].key = i;
+		if (cds_lfht_shard_add_unique(map, hash_key(i), match_key,
+				&nodes[i].key, &nodes[i].node) != &nodes[i].node)
+			ret = -1;
+	}
+	ok(!ret, "add unique keys");
+	dup_node.key = 42;
+	ok(cds_lfht_shard_add_unique(map, hash_key(42), match_key,
+			&dup_node.key, &dup_node.node) == &nodes[42].node,
+		"add unique returns the existing node");
+
+	for (i = 0; i < NR_KEYS; i++) {
+		if (lookup(map, i) == &nodes[i].node)
+			nr_found++;
+		key = i;
+		cds_lfht_lookup(cds_lfht_shard_get(map, hash_key(i)),
+				hash_key(i), match_key, &key, &shard_iter);
+		if (cds_lfht_iter_get_node(&shard_iter) == &nodes[i].node)
+			nr_routed++;
+	}
+	ok(nr_found == NR_KEYS && nr_routed == NR_KEYS,
+		"lookups find every key in its shard");
+
+	cds_lfht_shard_for_each(map, &iter, node) {
+		per_shard[iter.index]++;
+		nr++;
+	}
+	for (i = 0; i < NR_SHARDS; i++)
+		if (!per_shard[i])
+			break;
+	ok(nr == NR_KEYS && i == NR_SHARDS,
+		"traversal visits all keys, spread over all shards");
+
+	cds_lfht_shard_count_nodes(map, &before, &count, &after);
+	ok(count == NR_KEYS, "count nodes (%lu)", count);
+	rcu_read_unlock();
+
+	/* Let the shard resizes requested by the adds complete. */
+	for (i = 0; i < 5000; i++) {
+		cds_lfht_shard_get_stats(map, &stats);
+		if (stats.min_shard_buckets > 1)
+			break;
+		usleep(1000);
+	}
+	ok(stats.nr_shards == NR_SHARDS && stats.min_shard_buckets > 1
+			&& stats.nr_buckets >= stats.max_shard_buckets,
+		"every shard resized on its own (%lu to %lu buckets)",
+		stats.min_shard_buckets, stats.max_shard_buckets);
+
+	ok(cds_lfht_shard_destroy(map, NULL) == -EPERM,
+		"destroy refuses a non-empty table");
+
+	rcu_read_lock();
+	replace_node.key = 7;
+	ok(cds_lfht_shard_add_replace(map, hash_key(7), match_key,
+			&replace_node.key, &replace_node.node) == &nodes[7].node
+		&& lookup(map, 7) == &replace_node.node,
+		"add replace");
+
+	ret = 0;
+	for (i = 0; i < NR_KEYS; i++) {
+		node = i == 7 ? &replace_node.node : &nodes[i].node;
+		if (cds_lfht_shard_del(map, node))
+			ret = -1;
+	}
+	ok(!ret && cds_lfht_shard_del(map, &nodes[0].node) == -ENOENT,
+		"delete from the shard of each node");
+	cds_lfht_shard_first(map, &iter);
+	ok(!cds_lfht_shard_iter_get_node(&iter), "empty after deletes");
+	rcu_read_unlock();
+
+	ok(!cds_lfht_shard_destroy(map, NULL), "destroy");
+
+	/* The nodes may be reused once no reader sees them anymore. */
+	synchronize_rcu();
+	map = cds_lfht_shard_new(SHARD_ORDER, 1, 1, 0, 0, NULL);
+	if (!map)
+		return -1;
+	memset(per_shard, 0, sizeof(per_shard));
+	nr_found = 0;
+	rcu_read_lock();
+	for (i = 0; i < NR_KEYS; i++)
+		cds_lfht_shard_add(map, hash_key32(i), &nodes[i].node);
+	for (i = 0; i < NR_KEYS; i++) {
+		key = i;
+		cds_lfht_shard_lookup(map, hash_key32(i), match_key, &key,
+				&iter);
+		if (cds_lfht_shard_iter_get_node(&iter) == &nodes[i].node) {
+			per_shard[iter.index]++;
+			nr_found++;
+		}
+	}
+	for (i = 0; i < NR_SHARDS; i++)
+		if (per_shard[i] < NR_KEYS / NR_SHARDS / 2)
+			break;
+	ok(nr_found == NR_KEYS && i == NR_SHARDS,
+		"32-bit hash values spread over all shards");
+	for (i = 0; i < NR_KEYS; i++)
+		(void) cds_lfht_shard_del(map, &nodes[i].node);
+	rcu_read_unlock();
+	if (cds_lfht_shard_destroy(map, NULL))
+		return -1;
+
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,273 @@
+/*
+ * test_lfht_snapshot.c
+ *
+ * Userspace RCU library - test hash table snapshots
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rculfhash-snapshot.h>
+
+#include "lfht-test-node.h"
+#include "tap.h"
+
+/* Keys share their hash value two by two. */
+#define NR_KEYS		20000
+#define DUP_SHIFT	1
+#define NR_EXTRA	1000
+/* Larger than the snapshot write buffer. */
+#define BLOB_KEY	1234
+#define BLOB_LEN	100000
+
+struct blob_node {
+	struct test_node tnode;
+	unsigned long blob_len;
+	char blob[];
+};
+
+static unsigned long nr_alloc, fail_after = ~0UL;
+
+/* Keys share their hash value two by two. */
+static unsigned long dup_hash(unsigned long key)
+{
+	return hash_key(key >> DUP_SHIFT);
+}
+
+static struct blob_node *alloc_node(unsigned long key, unsigned long blob_len)
+{
+	struct blob_node *bnode;
+
+	bnode = calloc(1, sizeof(*bnode) + blob_len);
+	if (!bnode)
+		abort();
+	bnode->tnode.key = key;
+	bnode->blob_len = blob_len;
+	memset(bnode->blob, (int) (key & 0xff), blob_len);
+	return bnode;
+}
+
+/* Serialized node: key, then blob. */
+static long serialize(struct cds_lfht_node *node, void *buf, size_t len,
+		void *priv)
+{
+	struct blob_node *bnode = caa_container_of(node, struct blob_node,
+			tnode.node);
+	size_t needed = sizeof(bnode->tnode.key) + bnode->blob_len;
+
+	if (needed > len)
+		return needed;
+	memcpy(buf, &bnode->tnode.key, sizeof(bnode->tnode.key));
+	memcpy((char *) buf + sizeof(bnode->tnode.key), bnode->blob,
+		bnode->blob_len);
+	return needed;
+}
+
+static struct cds_lfht_node *deserialize(unsigned long hash, const void *buf,
+		size_t len, void *priv)
+{
+	struct blob_node *bnode;
+	unsigned long key;
+
+	if (nr_alloc++ >= fail_after || len < sizeof(key))
+		return NULL;
+	memcpy(&key, buf, sizeof(key));
+	if (hash != dup_hash(key))
+		abort();
+	bnode = alloc_node(key, len - sizeof(key));
+	memcpy(bnode->blob, (const char *) buf + sizeof(key), bnode->blob_len);
+	return &bnode->tnode.node;
+}
+
+static void add_keys(struct cds_lfht *ht, unsigned long first,
+		unsigned long last)
+{
+	struct blob_node *bnode;
+	unsigned long key;
+
+	for (key = first; key < last; key++) {
+		bnode = alloc_node(key, key == BLOB_KEY ? BLOB_LEN : key % 16);
+		rcu_read_lock();
+		cds_lfht_add(ht, dup_hash(key), &bnode->tnode.node);
+		rcu_read_unlock();
+	}
+}
+
+/* Number of keys in [first, last) found in ht with their content. */
+static unsigned long nr_found(struct cds_lfht *ht, unsigned long first,
+		unsigned long last)
+{
+	struct cds_lfht_iter iter;
+	struct blob_node *bnode;
+	unsigned long key, nr = 0, blob_len;
+
+	rcu_read_lock();
+	for (key = first; key < last; key++) {
+		cds_lfht_lookup(ht, dup_hash(key), match_key, &key, &iter);
+		if (!cds_lfht_iter_get_node(&iter))
+			continue;
+		bnode = caa_container_of(cds_lfht_iter_get_node(&iter),
+				struct blob_node, tnode.node);
+		blob_len = key == BLOB_KEY ? BLOB_LEN : key % 16;
+		if (bnode->blob_len == blob_len && (!blob_len
+				|| bnode->blob[blob_len - 1] == (char) key))
+			nr++;
+	}
+	rcu_read_unlock();
+	return nr;
+}
+
+/* Check that both tables hold the same keys, in the same order. */
+static int same_order(struct cds_lfht *a, struct cds_lfht *b)
+{
+	struct cds_lfht_iter iter_a, iter_b;
+	struct blob_node *na, *nb;
+	int ret = 1;
+
+	rcu_read_lock();
+	cds_lfht_first(a, &iter_a);
+	cds_lfht_first(b, &iter_b);
+	while (cds_lfht_iter_get_node(&iter_a)
+			&& cds_lfht_iter_get_node(&iter_b)) {
+		na = caa_container_of(cds_lfht_iter_get_node(&iter_a),
+				struct blob_node, tnode.node);
+		nb = caa_container_of(cds_lfht_iter_get_node(&iter_b),
+				struct blob_node, tnode.node);
+		if (na->tnode.key != nb->tnode.key)
+			ret = 0;
+		cds_lfht_next(a, &iter_a);
+		cds_lfht_next(b, &iter_b);
+	}
+	if (cds_lfht_iter_get_node(&iter_a) || cds_lfht_iter_get_node(&iter_b))
+		ret = 0;
+	rcu_read_unlock();
+	return ret;
+}
+
+static unsigned long count(struct cds_lfht *ht)
+{
+	long before, after;
+	unsigned long nr;
+
+	rcu_read_lock();
+	cds_lfht_count_nodes(ht, &before, &nr, &after);
+	rcu_read_unlock();
+	return nr;
+}
+
+static void free_all(struct cds_lfht *ht)
+{
+	struct cds_lfht_iter iter;
+	struct blob_node *bnode;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(ht, &iter, bnode, tnode.node) {
+		if (!cds_lfht_del(ht, &bnode->tnode.node))
+			free(bnode);
+	}
+	rcu_read_unlock();
+}
+
+static int new_file(void)
+{
+	char path[] = "/tmp/test_lfht_snapshot.XXXXXX";
+	int fd;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		abort();
+	unlink(path);
+	return fd;
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_lfht *src, *dst;
+	int fd, fd_extra, fd_bad;
+	long ret;
+
+	plan_tests(10);
+
+	rcu_register_thread();
+
+	src = cds_lfht_new(1, 1, 0, 0, NULL);
+	dst = cds_lfht_new(1, 1, 0, 0, NULL);
+	if (!src || !dst)
+		return -1;
+
+	fd = new_file();
+	ok(cds_lfht_snapshot_save(src, fd, 0, serialize, NULL) == 0
+		&& cds_lfht_snapshot_load(dst, fd, deserialize, NULL) == 0
+		&& !count(dst), "empty snapshot");
+
+	add_keys(src, 0, NR_KEYS);
+	cds_lfht_resize(src, 1UL << 12);
+	ret = cds_lfht_snapshot_save(src, fd, 100, serialize, NULL);
+	ok(ret == NR_KEYS, "save (%ld nodes)", ret);
+
+	ret = cds_lfht_snapshot_load(dst, fd, deserialize, NULL);
+	ok(ret == NR_KEYS && count(dst) == NR_KEYS
+		&& nr_found(dst, 0, NR_KEYS) == NR_KEYS,
+		"load finds every key and its value");
+	ok(same_order(src, dst), "loaded table has the traversal order of the saved one");
+	cds_lfht_resize(dst, 1UL << 4);
+	ok(nr_found(dst, 0, NR_KEYS) == NR_KEYS, "loaded table can shrink");
+
+	/* Merge a snapshot of other keys into the loaded table. */
+	free_all(src);
+	add_keys(src, NR_KEYS, NR_KEYS + NR_EXTRA);
+	fd_extra = new_file();
+	ok(cds_lfht_snapshot_save(src, fd_extra, 0, serialize, NULL)
+			== NR_EXTRA
+		&& cds_lfht_snapshot_load(dst, fd_extra, deserialize, NULL)
+			== NR_EXTRA
+		&& count(dst) == NR_KEYS + NR_EXTRA
+		&& nr_found(dst, 0, NR_KEYS + NR_EXTRA) == NR_KEYS + NR_EXTRA,
+		"load into a non-empty table");
+	free_all(dst);
+
+	fail_after = nr_alloc + 10;
+	ok(cds_lfht_snapshot_load(dst, fd, deserialize, NULL) == -ENOMEM
+		&& count(dst) == 10, "deserialize failure");
+	fail_after = ~0UL;
+	free_all(dst);
+
+	fd_bad = new_file();
+	ok(write(fd_bad, "not a snapshot file, at all!", 28) == 28
+		&& cds_lfht_snapshot_load(dst, fd_bad, deserialize, NULL)
+			== -EINVAL, "bad magic");
+	ok(!ftruncate(fd, 4096)
+		&& cds_lfht_snapshot_load(dst, fd, deserialize, NULL)
+			== -EINVAL, "truncated file");
+	free_all(dst);
+	free_all(src);
+
+	ok(!cds_lfht_destroy(src, NULL) && !cds_lfht_destroy(dst, NULL),
+		"destroy");
+	close(fd);
+	close(fd_extra);
+	close(fd_bad);
+
+	rcu_unregister_thread();
+	return exit_status();
+}
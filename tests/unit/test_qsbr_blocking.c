@@ -0,0 +1,276 @@
+/*
+ * test_qsbr_blocking.c
+ *
+ * Userspace RCU library - test the QSBR blocking-call wrappers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#define _LGPL_SOURCE
+#include <urcu-qsbr.h>
+#include <urcu-qsbr-blocking.h>
+#include <urcu/futex.h>
+
+#include "tap.h"
+
+/*
+ * Timeouts of the blocking calls, in ms: a thread which would stay
+ * online while blocking delays the grace period until it times out.
+ */
+#define BLOCK_MS	2000
+#define WAKE_DELAY_MS	50
+
+#ifdef __linux__
+#define NR_EPOLL_TESTS	2
+#else
+#define NR_EPOLL_TESTS	0
+#endif
+
+static int pipefd[2];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int cond_flag;
+static int32_t futex_word;
+static int gp_done;
+
+static void sleep_ms(long ms)
+{
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+
+	(void) nanosleep(&ts, NULL);
+}
+
+static void abs_timeout(struct timespec *ts, long ms)
+{
+	clock_gettime(CLOCK_REALTIME, ts);
+	ts->tv_sec += ms / 1000;
+	ts->tv_nsec += (ms % 1000) * 1000000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static void wake_pipe(void)
+{
+	char c = 0;
+
+	if (write(pipefd[1], &c, 1) != 1)
+		abort();
+}
+
+static void wake_cond(void)
+{
+	pthread_mutex_lock(&lock);
+	cond_flag = 1;
+	pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+static void wake_futex(void)
+{
+	uatomic_set(&futex_word, 1);
+	if (futex_async(&futex_word, FUTEX_WAKE, 1, NULL, NULL, 0) < 0)
+		abort();
+}
+
+static void wake_none(void)
+{
+}
+
+/*
+ * Once the main thread blocks, wait for a grace period, then wake the
+ * main thread up: the grace period completes first only if the main
+ * thread went offline.
+ */
+static void *thr_waker(void *arg)
+{
+	void (*wake)(void) = (void (*)(void)) arg;
+
+	sleep_ms(WAKE_DELAY_MS);
+	synchronize_rcu();
+	uatomic_set(&gp_done, 1);
+	wake();
+	return NULL;
+}
+
+static pthread_t start_waker(void (*wake)(void))
+{
+	pthread_t tid;
+
+	uatomic_set(&gp_done, 0);
+	if (pthread_create(&tid, NULL, thr_waker, (void *) wake))
+		abort();
+	return tid;
+}
+
+/* Offline, in case the grace period still waits for this thread. */
+static void join_waker(pthread_t tid)
+{
+	rcu_thread_offline();
+	if (pthread_join(tid, NULL))
+		abort();
+	rcu_thread_online();
+}
+
+static void drain_pipe(void)
+{
+	char c;
+
+	if (read(pipefd[0], &c, 1) != 1)
+		abort();
+}
+
+int main(int argc, char **argv)
+{
+	struct pollfd pfd;
+#ifdef __linux__
+	struct epoll_event ev;
+	int epfd;
+#endif
+	struct timespec ts;
+	pthread_t tid;
+	char c;
+	int ret, gp;
+
+	plan_tests(12 + NR_EPOLL_TESTS);
+
+	rcu_register_thread();
+	if (pipe(pipefd))
+		return -1;
+	pfd.fd = pipefd[0];
+	pfd.events = POLLIN;
+
+	ok(rcu_qsbr_poll(&pfd, 1, 0) == 0, "poll without timeout");
+	wake_pipe();
+	ok(rcu_qsbr_poll(&pfd, 1, BLOCK_MS) == 1 && rcu_read_ongoing(),
+		"ready poll returns online");
+	drain_pipe();
+
+	tid = start_waker(wake_pipe);
+	ret = rcu_qsbr_poll(&pfd, 1, BLOCK_MS);
+	gp = uatomic_read(&gp_done);
+	join_waker(tid);
+	ok(ret == 1 && gp && rcu_read_ongoing(),
+		"grace period completes while poll blocks");
+	drain_pipe();
+
+#ifdef __linux__
+	epfd = epoll_create(1);
+	if (epfd < 0)
+		return -1;
+	ev.events = EPOLLIN;
+	ev.data.fd = pipefd[0];
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &ev))
+		return -1;
+	wake_pipe();
+	ok(rcu_qsbr_epoll_wait(epfd, &ev, 1, BLOCK_MS) == 1
+		&& ev.data.fd == pipefd[0], "ready epoll_wait");
+	drain_pipe();
+
+	tid = start_waker(wake_pipe);
+	ret = rcu_qsbr_epoll_wait(epfd, &ev, 1, BLOCK_MS);
+	gp = uatomic_read(&gp_done);
+	join_waker(tid);
+	ok(ret == 1 && gp && rcu_read_ongoing(),
+		"grace period completes while epoll_wait blocks");
+	drain_pipe();
+	close(epfd);
+#endif
+
+	tid = start_waker(wake_pipe);
+	ret = rcu_qsbr_read(pipefd[0], &c, 1);
+	gp = uatomic_read(&gp_done);
+	join_waker(tid);
+	ok(ret == 1 && gp && rcu_read_ongoing(),
+		"grace period completes while read blocks");
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 0;
+	ok(!rcu_qsbr_nanosleep(&ts, NULL), "zero nanosleep");
+	tid = start_waker(wake_none);
+	ts.tv_nsec = 10 * WAKE_DELAY_MS * 1000000;
+	ret = rcu_qsbr_nanosleep(&ts, NULL);
+	gp = uatomic_read(&gp_done);
+	join_waker(tid);
+	ok(!ret && gp && rcu_read_ongoing(),
+		"grace period completes while sleeping");
+
+	pthread_mutex_lock(&lock);
+	tid = start_waker(wake_cond);
+	while (!cond_flag)
+		ret = rcu_qsbr_cond_wait(&cond, &lock);
+	gp = uatomic_read(&gp_done);
+	cond_flag = 0;
+	pthread_mutex_unlock(&lock);
+	join_waker(tid);
+	ok(!ret && gp && rcu_read_ongoing(),
+		"grace period completes while waiting on a condition");
+
+	abs_timeout(&ts, BLOCK_MS);
+	pthread_mutex_lock(&lock);
+	tid = start_waker(wake_cond);
+	ret = 0;
+	while (!cond_flag && !ret)
+		ret = rcu_qsbr_cond_timedwait(&cond, &lock, &ts);
+	gp = uatomic_read(&gp_done);
+	cond_flag = 0;
+	pthread_mutex_unlock(&lock);
+	join_waker(tid);
+	ok(!ret && gp, "grace period completes during a timed wait");
+
+	ok(rcu_qsbr_futex_wait(&futex_word, 1, NULL) == -1 && errno == EAGAIN,
+		"futex wait on a changed value returns at once");
+	tid = start_waker(wake_futex);
+	ts.tv_sec = BLOCK_MS / 1000;
+	ts.tv_nsec = 0;
+	while (!uatomic_read(&futex_word)) {
+		ret = rcu_qsbr_futex_wait(&futex_word, 0, &ts);
+		if (ret && errno != EAGAIN && errno != EINTR)
+			break;
+	}
+	gp = uatomic_read(&gp_done);
+	join_waker(tid);
+	ok(uatomic_read(&futex_word) && gp && rcu_read_ongoing(),
+		"grace period completes during a futex wait");
+
+	/* An offline thread stays offline. */
+	rcu_thread_offline();
+	wake_pipe();
+	ret = rcu_qsbr_read(pipefd[0], &c, 1);
+	ok(ret == 1 && !rcu_read_ongoing(), "offline thread stays offline");
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000000;
+	ret = rcu_qsbr_nanosleep(&ts, NULL);
+	ok(!ret && !rcu_read_ongoing(), "offline thread sleeps offline");
+	rcu_thread_online();
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,225 @@
+/*
+ * test_rcuarena.c
+ *
+ * Userspace RCU library - test the RCU generation arena allocator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rcuarena.h>
+
+#include "tap.h"
+
+#define REGION_SIZE	4096
+#define NR_OBJS		10000
+#define NR_THREADS	4
+#define NR_THREAD_OBJS	20000
+#define NR_GENERATIONS	50
+#define GEN_LEN		1000
+
+/* Generation of a list, whose nodes all come from its arena. */
+struct gen_node {
+	struct gen_node *next;
+	unsigned long gen;
+};
+
+struct generation {
+	struct cds_arena *arena;
+	struct gen_node *head;
+	unsigned long gen;
+};
+
+static struct cds_arena *shared_arena;
+static struct generation *cur_gen;
+static unsigned long nr_released;
+static volatile int test_stop;
+
+/* Each thread fills its objects with its number, then checks them. */
+static void *thr_alloc(void *arg)
+{
+	unsigned long id = (unsigned long) arg, i, bad = 0;
+	unsigned char **objs;
+
+	objs = malloc(NR_THREAD_OBJS * sizeof(*objs));
+	if (!objs)
+		abort();
+	for (i = 0; i < NR_THREAD_OBJS; i++) {
+		objs[i] = cds_arena_alloc(shared_arena, 1 + i % 40, 0);
+		if (!objs[i])
+			abort();
+		memset(objs[i], (int) id, 1 + i % 40);
+	}
+	for (i = 0; i < NR_THREAD_OBJS; i++)
+		if (objs[i][0] != id || objs[i][i % 40] != id)
+			bad++;
+	free(objs);
+	return (void *) bad;
+}
+
+/* Walk the current generation: every node must belong to it. */
+static void *thr_reader(void *arg)
+{
+	struct generation *gen;
+	struct gen_node *node;
+	unsigned long bad = 0;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		gen = rcu_dereference(cur_gen);
+		for (node = rcu_dereference(gen->head); node;
+				node = rcu_dereference(node->next))
+			if (node->gen != gen->gen)
+				bad++;
+		rcu_read_unlock();
+	}
+	rcu_unregister_thread();
+	return (void *) bad;
+}
+
+static struct generation *build_generation(unsigned long nr)
+{
+	struct cds_arena *arena;
+	struct generation *gen;
+	struct gen_node *node;
+	unsigned long i;
+
+	arena = cds_arena_create(0);
+	if (!arena)
+		abort();
+	gen = cds_arena_alloc(arena, sizeof(*gen), 0);
+	if (!gen)
+		abort();
+	gen->arena = arena;
+	gen->head = NULL;
+	gen->gen = nr;
+	for (i = 0; i < GEN_LEN; i++) {
+		node = cds_arena_alloc(arena, sizeof(*node), 0);
+		if (!node)
+			abort();
+		node->gen = nr;
+		node->next = gen->head;
+		gen->head = node;
+	}
+	return gen;
+}
+
+/* Poison the generation, so that readers would notice an early release. */
+static void release_generation(struct cds_arena *arena, void *priv)
+{
+	struct generation *gen = priv;
+	struct gen_node *node;
+
+	for (node = gen->head; node; node = node->next)
+		node->gen = ~0UL;
+	gen->gen = ~1UL;
+	uatomic_inc(&nr_released);
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_arena_stats stats;
+	struct generation *old;
+	struct cds_arena *arena;
+	pthread_t tid[NR_THREADS], reader;
+	unsigned long i, bad = 0;
+	char *small, *big;
+	void *tret;
+
+	plan_tests(10);
+
+	rcu_register_thread();
+
+	arena = cds_arena_create(REGION_SIZE);
+	if (!arena)
+		return -1;
+	cds_arena_get_stats(arena, &stats);
+	ok(!stats.nr_objects && !stats.nr_regions,
+		"no region until the first allocation");
+	ok(!cds_arena_alloc(arena, 8, 3), "alignment must be a power of 2");
+	ok(!cds_arena_alloc(arena, SIZE_MAX - 64, 64)
+		&& !cds_arena_alloc(arena, SIZE_MAX - 4096, 0),
+		"sizes overflowing a region are rejected");
+
+	for (i = 0; i < NR_OBJS; i++) {
+		small = cds_arena_alloc(arena, 1 + i % 100, 1UL << (i % 7));
+		if (!small || ((uintptr_t) small & ((1UL << (i % 7)) - 1)))
+			bad++;
+	}
+	cds_arena_get_stats(arena, &stats);
+	ok(!bad && stats.nr_objects == NR_OBJS
+		&& stats.bytes_used <= stats.bytes_reserved
+		&& stats.bytes_reserved == stats.nr_regions * REGION_SIZE,
+		"aligned allocations (%lu objects, %lu regions)",
+		stats.nr_objects, stats.nr_regions);
+
+	small = cds_arena_alloc(arena, 16, 0);
+	big = cds_arena_alloc(arena, 4 * REGION_SIZE, 4096);
+	ok(big && !((uintptr_t) big & 4095)
+		&& cds_arena_alloc(arena, 16, 0) == small + 16,
+		"large objects get their own region");
+	memset(big, 0, 4 * REGION_SIZE);
+	cds_arena_destroy(arena);
+
+	shared_arena = cds_arena_create(REGION_SIZE);
+	if (!shared_arena)
+		return -1;
+	for (i = 0; i < NR_THREADS; i++)
+		if (pthread_create(&tid[i], NULL, thr_alloc, (void *) (i + 1)))
+			return -1;
+	for (i = 0; i < NR_THREADS; i++) {
+		if (pthread_join(tid[i], &tret))
+			return -1;
+		bad += (unsigned long) tret;
+	}
+	cds_arena_get_stats(shared_arena, &stats);
+	ok(!bad && stats.nr_objects == NR_THREADS * NR_THREAD_OBJS,
+		"concurrent allocations do not overlap");
+	cds_arena_destroy(shared_arena);
+
+	/* Replace generations while a reader walks them. */
+	cur_gen = build_generation(0);
+	if (pthread_create(&reader, NULL, thr_reader, NULL))
+		return -1;
+	for (i = 1; i <= NR_GENERATIONS; i++) {
+		old = rcu_xchg_pointer(&cur_gen, build_generation(i));
+		cds_arena_retire(old->arena, release_generation, old);
+	}
+	test_stop = 1;
+	if (pthread_join(reader, &tret))
+		return -1;
+	ok(!tret, "readers never see a released generation");
+
+	rcu_barrier();
+	ok(nr_released == NR_GENERATIONS,
+		"one release per retired generation");
+	cds_arena_get_stats(cur_gen->arena, &stats);
+	ok(stats.nr_objects == GEN_LEN + 1 && stats.nr_regions == 1,
+		"one region per generation (%lu bytes used)", stats.bytes_used);
+	cds_arena_retire(cur_gen->arena, NULL, NULL);
+	rcu_barrier();
+	ok(nr_released == NR_GENERATIONS, "retire without release callback");
+
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,194 @@
+/*
+ * test_rcuarray.c
+ *
+ * Userspace RCU library - test the RCU copy-on-write array
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/rcuarray.h>
+
+#include "tap.h"
+
+#define NR_HOOKS	10
+#define NR_UPDATES	2000
+#define NR_READERS	2
+
+struct hook {
+	unsigned long id;
+	unsigned long check;		/* ~id */
+};
+
+static struct cds_rcu_array *array;
+static volatile int test_stop;
+
+static int match_id(const void *elem, const void *key)
+{
+	return ((const struct hook *) elem)->id == *(const unsigned long *) key;
+}
+
+static int add_hook(unsigned long id)
+{
+	struct hook hook = { id, ~id };
+
+	return cds_rcu_array_add(array, &hook);
+}
+
+/* Check the snapshot holds the ids first, first + 1, ..., last - 1. */
+static int check_ids(struct cds_rcu_array_snap *snap, unsigned long first,
+		unsigned long last)
+{
+	struct hook *hook;
+	unsigned long id = first;
+
+	cds_rcu_array_for_each(snap, hook) {
+		if (hook->id != id || hook->check != ~id)
+			return 0;
+		id++;
+	}
+	return id == last;
+}
+
+/* Snapshots must always hold consecutive ids. */
+static void *thr_reader(void *arg)
+{
+	struct cds_rcu_array_snap *snap;
+	struct hook *hook;
+	unsigned long bad = 0, id;
+
+	rcu_register_thread();
+	while (!test_stop) {
+		rcu_read_lock();
+		snap = cds_rcu_array_read(array);
+		if (snap->nr) {
+			hook = cds_rcu_array_get(array, snap, 0);
+			id = hook->id;
+			if (!check_ids(snap, id, id + snap->nr))
+				bad++;
+		}
+		rcu_read_unlock();
+	}
+	rcu_unregister_thread();
+	return (void *) bad;
+}
+
+int main(int argc, char **argv)
+{
+	struct cds_rcu_array_update update;
+	struct cds_rcu_array_snap *snap;
+	struct hook hook;
+	pthread_t tid[NR_READERS];
+	unsigned long i, id, bad = 0;
+	void *tret;
+	int ret = 0;
+
+	plan_tests(9);
+
+	rcu_register_thread();
+
+	ok(!cds_rcu_array_create(0), "elements cannot be empty");
+	array = cds_rcu_array_create(sizeof(struct hook));
+	if (!array)
+		return -1;
+	rcu_read_lock();
+	ok(!cds_rcu_array_read(array)->nr, "new array is empty");
+	rcu_read_unlock();
+
+	for (i = 0; i < NR_HOOKS; i++)
+		ret |= add_hook(i);
+	rcu_read_lock();
+	ok(!ret && check_ids(cds_rcu_array_read(array), 0, NR_HOOKS),
+		"add appends");
+	rcu_read_unlock();
+
+	id = 0;
+	ok(!cds_rcu_array_del(array, match_id, &id)
+		&& cds_rcu_array_del(array, match_id, &id) == -ENOENT,
+		"delete");
+
+	/* A snapshot is not affected by later updates. */
+	rcu_read_lock();
+	snap = cds_rcu_array_read(array);
+	ret = add_hook(NR_HOOKS);
+	ok(!ret && check_ids(snap, 1, NR_HOOKS)
+		&& check_ids(cds_rcu_array_read(array), 1, NR_HOOKS + 1),
+		"snapshots are immutable");
+	rcu_read_unlock();
+
+	/* Batch: rotate the array, publishing a single copy. */
+	ret = cds_rcu_array_update_begin(array, &update);
+	hook.id = NR_HOOKS + 1;
+	hook.check = ~hook.id;
+	ret |= cds_rcu_array_update_insert(&update, update.copy->nr, &hook);
+	cds_rcu_array_update_remove(&update, 0);
+	rcu_read_lock();
+	ok(!ret && check_ids(update.copy, 2, NR_HOOKS + 2)
+		&& check_ids(cds_rcu_array_read(array), 1, NR_HOOKS + 1),
+		"batched updates are private until commit");
+	rcu_read_unlock();
+	cds_rcu_array_update_commit(&update);
+
+	ret = cds_rcu_array_update_begin(array, &update);
+	cds_rcu_array_update_remove(&update, 0);
+	cds_rcu_array_update_abort(&update);
+	rcu_read_lock();
+	ok(!ret && check_ids(cds_rcu_array_read(array), 2, NR_HOOKS + 2),
+		"commit publishes, abort drops");
+	rcu_read_unlock();
+
+	/* Slide a window of ids while readers check each snapshot. */
+	for (i = 0; i < NR_READERS; i++)
+		if (pthread_create(&tid[i], NULL, thr_reader, NULL))
+			return -1;
+	for (i = 0; i < NR_UPDATES; i++) {
+		if (cds_rcu_array_update_begin(array, &update))
+			return -1;
+		hook.id = NR_HOOKS + 2 + i;
+		hook.check = ~hook.id;
+		if (cds_rcu_array_update_insert(&update, update.copy->nr,
+				&hook))
+			return -1;
+		if (i & 1) {
+			cds_rcu_array_update_remove(&update, 0);
+			cds_rcu_array_update_remove(&update, 0);
+		}
+		cds_rcu_array_update_commit(&update);
+	}
+	test_stop = 1;
+	for (i = 0; i < NR_READERS; i++) {
+		if (pthread_join(tid[i], &tret))
+			return -1;
+		bad += (unsigned long) tret;
+	}
+	rcu_read_lock();
+	snap = cds_rcu_array_read(array);
+	ok(!bad && check_ids(snap, 2 + NR_UPDATES, NR_HOOKS + 2 + NR_UPDATES),
+		"readers only see consistent snapshots");
+	rcu_read_unlock();
+
+	rcu_barrier();
+	cds_rcu_array_destroy(array);
+	ok(1, "destroy");
+
+	rcu_unregister_thread();
+	return exit_status();
+}
@@ -0,0 +1,142 @@
+/*
+ * test_read_profile.c
+ *
+ * Userspace RCU library - test the read-side critical section profiler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#define RCU_READ_PROFILE
+#include <urcu.h>
+#include <urcu/read-profile.h>
+
+#include "tap.h"
+
+#define NR_SECTIONS	1000
+#define SLOW_US		5000
+#define NR_THREADS	100
+
+static void short_sections(unsigned long nr)
+{
+	while (nr--) {
+		rcu_read_lock();
+		rcu_read_unlock();
+	}
+}
+
+static void *thr_reader(void *arg)
+{
+	rcu_register_thread();
+	short_sections(NR_SECTIONS);
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/* Number of dump lines containing str. */
+static int dump_count(const char *str)
+{
+	char line[512];
+	FILE *fp;
+	int found = 0;
+
+	fp = tmpfile();
+	if (!fp)
+		return 0;
+	urcu_read_profile_dump(fp);
+	rewind(fp);
+	while (fgets(line, sizeof(line), fp))
+		if (strstr(line, str))
+			found++;
+	fclose(fp);
+	return found;
+}
+
+static int dump_has(const char *str)
+{
+	return dump_count(str) > 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct urcu_read_profile_summary summary;
+	pthread_t tid;
+	int i;
+
+	plan_tests(10);
+
+	rcu_register_thread();
+
+	short_sections(NR_SECTIONS);
+	urcu_read_profile_get(&summary);
+	ok(summary.nr_samples == 0, "no samples while disabled");
+
+	ok(urcu_read_profile_enable(3, 0) == -EINVAL,
+		"period must be a power of two");
+
+	ok(!urcu_read_profile_enable(1, SLOW_US / 2 * 1000ULL),
+		"enable every section with a threshold");
+	short_sections(NR_SECTIONS);
+	rcu_read_lock();
+	rcu_read_lock();
+	usleep(SLOW_US);
+	rcu_read_unlock();
+	rcu_read_unlock();
+	urcu_read_profile_get(&summary);
+	ok(summary.nr_samples == NR_SECTIONS + 1,
+		"one sample per outermost section (%llu)",
+		(unsigned long long) summary.nr_samples);
+	ok(summary.nr_slow == 1 && summary.max_ns >= SLOW_US * 1000ULL,
+		"slow section over the threshold recorded");
+	ok(dump_has("SLOWSECTION") && dump_has("READPROFILE all"),
+		"dump reports histograms and slow sections");
+
+	urcu_read_profile_reset();
+	ok(!urcu_read_profile_enable(4, 0), "enable one section out of 4");
+	short_sections(NR_SECTIONS);
+	urcu_read_profile_get(&summary);
+	ok(summary.nr_samples == NR_SECTIONS / 4 && summary.nr_slow == 0,
+		"sampling period honored (%llu)",
+		(unsigned long long) summary.nr_samples);
+
+	if (pthread_create(&tid, NULL, thr_reader, NULL) || pthread_join(tid, NULL))
+		return -1;
+	urcu_read_profile_get(&summary);
+	ok(summary.nr_threads == 2 && summary.nr_samples == NR_SECTIONS / 2,
+		"per-thread histograms merged (%u threads)",
+		summary.nr_threads);
+
+	/* Histograms of exited threads are folded, not kept per thread. */
+	for (i = 0; i < NR_THREADS; i++)
+		if (pthread_create(&tid, NULL, thr_reader, NULL)
+				|| pthread_join(tid, NULL))
+			return -1;
+	urcu_read_profile_get(&summary);
+	ok(summary.nr_threads == NR_THREADS + 2
+		&& summary.nr_samples == (NR_THREADS + 2) * (NR_SECTIONS / 4)
+		&& dump_count("READPROFILE thread-") == 1
+		&& dump_count("READPROFILE exited-101") == 1,
+		"exited threads folded (%u threads)", summary.nr_threads);
+	urcu_read_profile_disable();
+
+	rcu_unregister_thread();
+	return exit_status();
+}
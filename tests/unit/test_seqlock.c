@@ -0,0 +1,169 @@
+/*
+ * test_seqlock.c
+ *
+ * Userspace RCU library - test sequence locks and latches
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define _LGPL_SOURCE
+#include <urcu.h>
+#include <urcu/seqlock.h>
+
+#include "tap.h"
+
+#define NR_READERS	4
+#define NR_WRITES	100000
+
+/* Invariant checked by readers: b == ~a, c == a + 1. */
+struct triple {
+	unsigned long a, b, c;
+};
+
+static struct cds_seqlock seqlock = CDS_SEQLOCK_INIT;
+static struct triple seqlock_data;
+
+static struct cds_seqlatch latch = CDS_SEQLATCH_INIT;
+static struct triple latch_data[2];
+
+static int test_stop;
+static unsigned long nr_inconsistent, nr_reads;
+
+static void triple_write(struct triple *t, unsigned long v)
+{
+	CMM_STORE_SHARED(t->a, v);
+	CMM_STORE_SHARED(t->b, ~v);
+	CMM_STORE_SHARED(t->c, v + 1);
+}
+
+static int triple_check(const struct triple *t)
+{
+	unsigned long a, b, c;
+
+	a = CMM_LOAD_SHARED(t->a);
+	b = CMM_LOAD_SHARED(t->b);
+	c = CMM_LOAD_SHARED(t->c);
+	return b == ~a && c == a + 1;
+}
+
+static void *thr_reader(void *arg)
+{
+	unsigned long seq, reads = 0, bad = 0;
+	int use_latch = *(int *) arg;
+
+	rcu_register_thread();
+	while (!CMM_LOAD_SHARED(test_stop)) {
+		int consistent;
+
+		/* Sequence reads nest within RCU read-side sections. */
+		rcu_read_lock();
+		if (use_latch) {
+			do {
+				seq = cds_seqlatch_read_begin(&latch);
+				consistent = triple_check(
+					&latch_data[cds_seqlatch_read_index(seq)]);
+			} while (cds_seqlatch_read_retry(&latch, seq));
+		} else {
+			do {
+				seq = cds_seqlock_read_begin(&seqlock);
+				consistent = triple_check(&seqlock_data);
+			} while (cds_seqlock_read_retry(&seqlock, seq));
+		}
+		rcu_read_unlock();
+		if (!consistent)
+			bad++;
+		reads++;
+	}
+	rcu_unregister_thread();
+	uatomic_add(&nr_inconsistent, bad);
+	uatomic_add(&nr_reads, reads);
+	return NULL;
+}
+
+static void run_test(int use_latch)
+{
+	pthread_t tid[NR_READERS];
+	unsigned long i;
+	int ret;
+
+	CMM_STORE_SHARED(test_stop, 0);
+	nr_inconsistent = 0;
+	nr_reads = 0;
+	for (i = 0; i < NR_READERS; i++) {
+		ret = pthread_create(&tid[i], NULL, thr_reader, &use_latch);
+		if (ret)
+			abort();
+	}
+	for (i = 1; i <= NR_WRITES; i++) {
+		if (use_latch) {
+			cds_seqlatch_write_flip(&latch);
+			triple_write(&latch_data[0], i);
+			cds_seqlatch_write_flip(&latch);
+			triple_write(&latch_data[1], i);
+		} else {
+			cds_seqlock_write_lock(&seqlock);
+			triple_write(&seqlock_data, i);
+			cds_seqlock_write_unlock(&seqlock);
+		}
+		/* Grace periods are allowed outside write sections. */
+		if (!(i % 10000))
+			synchronize_rcu();
+	}
+	CMM_STORE_SHARED(test_stop, 1);
+	for (i = 0; i < NR_READERS; i++) {
+		ret = pthread_join(tid[i], NULL);
+		if (ret)
+			abort();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long seq;
+
+	plan_tests(5);
+
+	triple_write(&seqlock_data, 0);
+	triple_write(&latch_data[0], 0);
+	triple_write(&latch_data[1], 0);
+
+	seq = cds_seqlock_read_begin(&seqlock);
+	ok(!cds_seqlock_read_retry(&seqlock, seq),
+		"seqlock read without writer does not retry");
+
+	run_test(0);
+	ok(nr_inconsistent == 0,
+		"seqlock readers observe consistent values (%lu reads)",
+		nr_reads);
+
+	seq = cds_seqlatch_read_begin(&latch);
+	cds_seqlatch_write_flip(&latch);
+	ok(cds_seqlatch_read_retry(&latch, seq),
+		"seqlatch read concurrent with flip retries");
+	cds_seqlatch_write_flip(&latch);
+
+	run_test(1);
+	ok(nr_inconsistent == 0,
+		"seqlatch readers observe consistent values (%lu reads)",
+		nr_reads);
+	ok(cds_seqlatch_read_index(cds_seqlatch_read_begin(&latch)) == 0,
+		"seqlatch readers use first copy when idle");
+
+	cds_seqlock_destroy(&seqlock);
+	return exit_status();
+}
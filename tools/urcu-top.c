@@ -0,0 +1,266 @@
+/*
+ * urcu-top.c
+ *
+ * Userspace RCU library - display the live statistics of a process
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Map the statistics region published by a process started with
+ * URCU_STATS_SHM set (see urcu/stats.h) read-only, and periodically
+ * print its counters. Rates are computed over the refresh interval.
+ * The process is never stopped nor synchronized with: counters may be
+ * slightly inconsistent with each other.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <urcu/stats.h>
+
+static const char *flavor_names[URCU_STATS_NR_FLAVORS] = {
+	[URCU_STATS_FLAVOR_MEMB] = "memb",
+	[URCU_STATS_FLAVOR_MB] = "mb",
+	[URCU_STATS_FLAVOR_SIGNAL] = "signal",
+	[URCU_STATS_FLAVOR_QSBR] = "qsbr",
+	[URCU_STATS_FLAVOR_BP] = "bp",
+};
+
+static
+const char *flavor_name(int32_t flavor)
+{
+	if (flavor < 0 || flavor >= URCU_STATS_NR_FLAVORS)
+		return "-";
+	return flavor_names[flavor];
+}
+
+static
+double rate(uint64_t cur, uint64_t prev, double interval)
+{
+	if (cur < prev || interval <= 0)
+		return 0;
+	return (double) (cur - prev) / interval;
+}
+
+static
+void print_flavors(const struct urcu_stats *cur, const struct urcu_stats *prev,
+		double interval)
+{
+	int i;
+
+	printf("%-8s %8s %10s %10s %10s %10s %10s %10s %10s\n",
+		"FLAVOR", "THREADS", "GP/s", "SHARED/s", "WAIT/s",
+		"LAST_us", "AVG_us", "MAX_us", "DEFER");
+	for (i = 0; i < URCU_STATS_NR_FLAVORS; i++) {
+		const struct urcu_stats_flavor *fc = &cur->flavor[i];
+		const struct urcu_stats_flavor *fp = &prev->flavor[i];
+		uint64_t nr_gp = fc->nr_gp - fp->nr_gp;
+		double avg = 0;
+
+		if (!fc->active)
+			continue;
+		if (fc->nr_gp > fp->nr_gp && fc->gp_total_ns >= fp->gp_total_ns)
+			avg = (double) (fc->gp_total_ns - fp->gp_total_ns)
+				/ nr_gp / 1000;
+		printf("%-8s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10llu\n",
+			flavor_names[i], (unsigned long long) fc->nr_threads,
+			rate(fc->nr_gp, fp->nr_gp, interval),
+			rate(fc->nr_gp_shared, fp->nr_gp_shared, interval),
+			rate(fc->nr_wait, fp->nr_wait, interval),
+			(double) fc->gp_last_ns / 1000, avg,
+			(double) fc->gp_max_ns / 1000,
+			(unsigned long long) fc->defer_fill);
+	}
+}
+
+static
+void print_call_rcu(const struct urcu_stats *cur, const struct urcu_stats *prev,
+		double interval)
+{
+	int i, header = 0;
+
+	for (i = 0; i < URCU_STATS_NR_CALL_RCU; i++) {
+		const struct urcu_stats_call_rcu *cc = &cur->call_rcu[i];
+		const struct urcu_stats_call_rcu *cp = &prev->call_rcu[i];
+
+		if (cc->state != URCU_STATS_SLOT_USED)
+			continue;
+		if (!header) {
+			printf("\n%-8s %-8s %6s %12s %12s %12s\n",
+				"CALL_RCU", "FLAVOR", "CPU", "QLEN",
+				"INVOKED/s", "BATCHES/s");
+			header = 1;
+		}
+		printf("%-8d %-8s %6d %12llu %12.1f %12.1f\n",
+			i, flavor_name(cc->flavor), cc->cpu,
+			(unsigned long long) cc->qlen,
+			rate(cc->nr_invoked, cp->nr_invoked, interval),
+			rate(cc->nr_batches, cp->nr_batches, interval));
+	}
+}
+
+static
+void print_lfht(const struct urcu_stats *cur, const struct urcu_stats *prev,
+		double interval)
+{
+	int i, header = 0;
+
+	for (i = 0; i < URCU_STATS_NR_LFHT; i++) {
+		const struct urcu_stats_lfht *hc = &cur->lfht[i];
+		const struct urcu_stats_lfht *hp = &prev->lfht[i];
+
+		if (hc->state != URCU_STATS_SLOT_USED)
+			continue;
+		if (!header) {
+			printf("\n%-8s %12s %12s %12s %12s %10s %10s %10s\n",
+				"LFHT", "BUCKETS", "TARGET", "COUNT", "MAX",
+				"RESIZES", "RESIZE/s", "LAST_us");
+			header = 1;
+		}
+		printf("%-8d %12llu %12llu %12llu %12llu %10llu %10.1f %10.1f\n",
+			i, (unsigned long long) hc->size,
+			(unsigned long long) hc->resize_target,
+			(unsigned long long) hc->count,
+			(unsigned long long) hc->max_nr_buckets,
+			(unsigned long long) hc->nr_resize,
+			rate(hc->nr_resize, hp->nr_resize, interval),
+			(double) hc->resize_last_ns / 1000);
+	}
+}
+
+static
+void show_usage(char **argv)
+{
+	printf("Usage : %s [OPTIONS] pid|/name\n", argv[0]);
+	printf("OPTIONS:\n");
+	printf("	[-d seconds] (refresh interval, default: 1)\n");
+	printf("	[-n count] (number of refreshes, default: until the process exits)\n");
+	printf("	[-b] (batch mode: do not clear the screen between refreshes)\n");
+	printf("\n");
+	printf("The process must be started with %s=1 (object /urcu-stats-<pid>)\n",
+		URCU_STATS_ENV);
+	printf("or %s=/name.\n", URCU_STATS_ENV);
+}
+
+int main(int argc, char **argv)
+{
+	const struct urcu_stats *stats;
+	struct urcu_stats cur, prev;
+	char name[64];
+	double interval = 1;
+	long count = -1, iter;
+	int batch = !isatty(STDOUT_FILENO);
+	const char *target = NULL;
+	struct stat st;
+	int i, fd;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] != '-') {
+			target = argv[i];
+			continue;
+		}
+		switch (argv[i][1]) {
+		case 'd':
+			if (argc < i + 2) {
+				show_usage(argv);
+				return -1;
+			}
+			interval = atof(argv[++i]);
+			break;
+		case 'n':
+			if (argc < i + 2) {
+				show_usage(argv);
+				return -1;
+			}
+			count = atol(argv[++i]);
+			break;
+		case 'b':
+			batch = 1;
+			break;
+		case 'h':
+			show_usage(argv);
+			return 0;
+		default:
+			show_usage(argv);
+			return -1;
+		}
+	}
+	if (!target || interval <= 0) {
+		show_usage(argv);
+		return -1;
+	}
+	if (target[0] == '/')
+		snprintf(name, sizeof(name), "%s", target);
+	else
+		snprintf(name, sizeof(name), URCU_STATS_NAME_FMT, atoi(target));
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Error opening %s: %s\n", name, strerror(errno));
+		return 1;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(*stats)) {
+		fprintf(stderr, "Error: %s is not a liburcu statistics object.\n",
+			name);
+		close(fd);
+		return 1;
+	}
+	stats = mmap(NULL, sizeof(*stats), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (stats == MAP_FAILED) {
+		fprintf(stderr, "Error mapping %s: %s\n", name, strerror(errno));
+		return 1;
+	}
+	if (stats->magic != URCU_STATS_MAGIC
+			|| stats->version != URCU_STATS_VERSION
+			|| stats->size != sizeof(*stats)) {
+		fprintf(stderr, "Error: %s has an unknown layout (version %u, size %u), expected version %u, size %zu.\n",
+			name, stats->version, stats->size,
+			URCU_STATS_VERSION, sizeof(*stats));
+		return 1;
+	}
+
+	memcpy(&prev, stats, sizeof(prev));
+	for (iter = 0; count < 0 || iter < count; iter++) {
+		usleep((useconds_t) (interval * 1000000));
+		memcpy(&cur, stats, sizeof(cur));
+		if (!batch)
+			printf("\033[H\033[J");
+		printf("urcu-top - pid %lld (%s), interval %.1fs, workqueue backlog %llu\n\n",
+			(long long) cur.pid, name, interval,
+			(unsigned long long) cur.workqueue_qlen);
+		print_flavors(&cur, &prev, interval);
+		print_call_rcu(&cur, &prev, interval);
+		print_lfht(&cur, &prev, interval);
+		if (batch)
+			printf("\n");
+		fflush(stdout);
+		prev = cur;
+		if (kill((pid_t) cur.pid, 0) < 0 && errno == ESRCH) {
+			printf("Process %lld exited.\n", (long long) cur.pid);
+			break;
+		}
+	}
+	return 0;
+}